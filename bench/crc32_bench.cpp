@@ -0,0 +1,84 @@
+#include "crc32.hpp"
+
+#include <boost/crc.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Compare boost::crc_32_type with crc32_t's kernels over spans of a
+ * few sizes, from a typical book checksum input (about 200 bytes for
+ * ten levels a side) up to a few KB.
+ */
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+void report(std::string_view label, size_t size, size_t num_bytes,
+            clock_type::duration elapsed) {
+  const auto secs = std::chrono::duration<double>(elapsed).count();
+  std::cout << std::left << std::setw(12) << label << std::right
+            << std::setw(8) << size << " bytes" << std::fixed
+            << std::setprecision(1) << std::setw(12)
+            << (num_bytes / secs / 1e6) << " MB/s" << std::endl;
+}
+
+template <typename Crc>
+void run(std::string_view label, const std::string &input, size_t iterations,
+         Crc crc) {
+  uint32_t checksum = 0;
+  const auto begin = clock_type::now();
+  for (size_t iter = 0; iter < iterations; ++iter) {
+    checksum ^= crc(input);
+  }
+  const auto end = clock_type::now();
+  report(label, input.size(), input.size() * iterations, end - begin);
+  if (checksum == 0xffffffff) {
+    std::cerr << "unlikely checksum" << std::endl;
+  }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc > 2) {
+    std::cerr << "usage: " << argv[0] << " [iterations]" << std::endl;
+    return -1;
+  }
+  const size_t iterations = argc == 2 ? std::atol(argv[1]) : 1000000;
+
+  std::cout << "iterations: " << iterations << " clmul: "
+            << (kdr::crc32_t::have_clmul() ? "yes" : "no") << std::endl;
+
+  for (const size_t size : {64, 208, 1024, 4096}) {
+    auto input = std::string(size, '\0');
+    for (size_t idx = 0; idx < size; ++idx) {
+      input[idx] = char('0' + idx * 7 % 10);
+    }
+    run("boost", input, iterations, [](const std::string &bytes) {
+      boost::crc_32_type crc;
+      crc.process_bytes(bytes.data(), bytes.size());
+      return crc.checksum();
+    });
+    run("table", input, iterations, [](const std::string &bytes) {
+      return ~kdr::crc32_t::update_table(~uint32_t{0}, bytes.data(),
+                                         bytes.size());
+    });
+    if (kdr::crc32_t::have_clmul()) {
+      run("clmul", input, iterations, [](const std::string &bytes) {
+        return ~kdr::crc32_t::update_clmul(~uint32_t{0}, bytes.data(),
+                                           bytes.size());
+      });
+    }
+    run("crc32_t", input, iterations, [](const std::string &bytes) {
+      kdr::crc32_t crc;
+      crc.process_bytes(bytes);
+      return crc.checksum();
+    });
+  }
+}
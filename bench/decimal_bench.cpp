@@ -0,0 +1,109 @@
+#include "decimal.hpp"
+
+#include <simdjson.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Compare decimal_t's scalar parser with the dispatching constructor
+ * (which tries the SIMD path first) on the price and qty tokens of
+ * recorded book frames (one websocket frame per line, e.g.
+ * test/data/book_frames.ndjson).
+ */
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+std::vector<std::string> load_tokens(const std::string &path) {
+  std::ifstream in{path};
+  if (!in) {
+    throw std::runtime_error("cannot open: " + path);
+  }
+  auto result = std::vector<std::string>{};
+  simdjson::ondemand::parser parser;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    const auto frame = simdjson::padded_string{line};
+    simdjson::ondemand::document doc = parser.iterate(frame);
+    for (simdjson::ondemand::object book : doc["data"].get_array()) {
+      for (const auto *side : {"bids", "asks"}) {
+        for (simdjson::ondemand::object level : book[side].get_array()) {
+          for (const auto *field : {"price", "qty"}) {
+            result.emplace_back(
+                std::string_view{level[field].raw_json_token()});
+          }
+        }
+      }
+    }
+  }
+  return result;
+}
+
+void report(std::string_view label, size_t num_tokens,
+            clock_type::duration elapsed) {
+  const auto secs = std::chrono::duration<double>(elapsed).count();
+  std::cout << std::left << std::setw(24) << label << std::right << std::fixed
+            << std::setprecision(1) << std::setw(12)
+            << (num_tokens / secs / 1e6) << " Mtokens/s" << std::setw(10)
+            << (secs * 1e9 / num_tokens) << " ns/token" << std::endl;
+}
+
+template <typename Parse>
+void run(std::string_view label, const std::vector<std::string> &tokens,
+         size_t iterations, Parse parse) {
+  uint64_t checksum = 0;
+  const auto begin = clock_type::now();
+  for (size_t iter = 0; iter < iterations; ++iter) {
+    for (const auto &token : tokens) {
+      checksum += parse(token).mantissa();
+    }
+  }
+  const auto end = clock_type::now();
+  report(label, tokens.size() * iterations, end - begin);
+  if (checksum == 0) {
+    std::cerr << "warning: nothing parsed" << std::endl;
+  }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 2 || argc > 3) {
+    std::cerr << "usage: " << argv[0] << " <ndjson frames file> [iterations]"
+              << std::endl;
+    return -1;
+  }
+
+  try {
+    const auto tokens = load_tokens(argv[1]);
+    const size_t iterations = argc == 3 ? std::atol(argv[2]) : 1000;
+
+    size_t num_simd = 0;
+    for (const auto &token : tokens) {
+      auto value = kdr::decimal_t{};
+      num_simd += kdr::decimal_t::parse_simd(token, value) ? 1 : 0;
+    }
+    std::cout << "tokens: " << tokens.size() << " iterations: " << iterations
+              << " simd: " << (kdr::decimal_t::have_simd() ? "yes" : "no")
+              << " (" << num_simd << " tokens eligible)" << std::endl;
+
+    run("scalar", tokens, iterations, [](const std::string &token) {
+      return kdr::decimal_t::parse_scalar(token);
+    });
+    run("decimal_t(token)", tokens, iterations,
+        [](const std::string &token) { return kdr::decimal_t{token}; });
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what() << std::endl;
+    return -1;
+  }
+}
@@ -0,0 +1,123 @@
+#include "io.hpp"
+
+#include <arrow/api.h>
+#include <arrow/util/byte_size.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Compare parquet writer properties on a recorded book or trades file
+ * (e.g. one written by kdr_record): its rows are read into memory once
+ * and then written under each profile below, reporting the resulting
+ * file size and how fast it was written.
+ *
+ * Byte stream split only applies to int64 and decimal128 prices, so
+ * record the sample with --price_format to see its effect.
+ */
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct profile_t final {
+  std::string name;
+  kdr::pq::writer_properties_t properties;
+};
+
+kdr::pq::writer_properties_t compressed(std::string compression) {
+  auto result = kdr::pq::writer_properties_t{};
+  result.compression = std::move(compression);
+  return result;
+}
+
+std::vector<profile_t> profiles() {
+  auto encoded = kdr::pq::writer_properties_t{};
+  encoded.delta_encoding = true;
+  encoded.byte_stream_split = true;
+
+  auto result = std::vector<profile_t>{};
+  result.push_back({"snappy (default)", {}});
+  for (const auto *compression : {"none", "lz4", "zstd", "zstd:9"}) {
+    result.push_back({compression, compressed(compression)});
+  }
+  encoded.compression = "zstd";
+  result.push_back({"zstd delta/bss", encoded});
+  encoded.compression = "zstd:9";
+  result.push_back({"zstd:9 delta/bss", encoded});
+  encoded.dictionary = false;
+  result.push_back({"zstd:9 delta/bss nodict", encoded});
+  encoded.dictionary = true;
+  encoded.row_group_size = 256 * 1024;
+  result.push_back({"zstd:9 delta/bss 256k", encoded});
+  return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 2 || argc > 3) {
+    std::cerr << "usage: " << argv[0] << " <parquet file> [iterations]"
+              << std::endl;
+    return -1;
+  }
+
+  try {
+    const auto iterations = argc == 3 ? std::atol(argv[2]) : 5;
+    if (iterations <= 0) {
+      throw std::runtime_error{"iterations must be positive"};
+    }
+
+    auto reader = kdr::pq::reader_t{argv[1]};
+    const auto schema = reader.get_schema();
+    auto batches = std::vector<std::shared_ptr<arrow::RecordBatch>>{};
+    int64_t num_rows = 0;
+    int64_t num_bytes = 0;
+    for (const auto &maybe_batch : *reader.record_batch_reader()) {
+      const auto batch = maybe_batch.ValueOrDie();
+      num_rows += batch->num_rows();
+      num_bytes += arrow::util::TotalBufferSize(*batch);
+      batches.push_back(batch);
+    }
+
+    std::cout << "rows: " << num_rows << " in memory: " << std::fixed
+              << std::setprecision(1) << (num_bytes / 1e6)
+              << " MB iterations: " << iterations << std::endl;
+
+    const auto filename =
+        (std::filesystem::temp_directory_path() / "parquet_bench.pq")
+            .string();
+    for (const auto &profile : profiles()) {
+      const auto begin = clock_type::now();
+      for (long iter = 0; iter < iterations; ++iter) {
+        auto writer = kdr::pq::writer_t{filename, schema, profile.properties};
+        for (const auto &batch : batches) {
+          writer.write(*batch);
+        }
+      }
+      const auto end = clock_type::now();
+
+      const auto secs =
+          std::chrono::duration<double>(end - begin).count() / iterations;
+      const auto file_bytes = std::filesystem::file_size(filename);
+      std::cout << std::left << std::setw(26) << profile.name << std::right
+                << std::fixed << std::setprecision(1) << std::setw(10)
+                << (file_bytes / 1e6) << " MB" << std::setw(8)
+                << (double(num_bytes) / file_bytes) << "x" << std::setw(10)
+                << (num_bytes / secs / 1e6) << " MB/s" << std::setw(10)
+                << (num_rows / secs / 1e3) << " krows/s" << std::endl;
+      std::filesystem::remove(filename);
+    }
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what() << std::endl;
+    return -1;
+  }
+}
@@ -0,0 +1,117 @@
+#include "book.hpp"
+
+#include <simdjson.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Compare simdjson kernels on recorded book frames (one websocket
+ * frame per line, e.g. test/data/book_frames.ndjson).
+ *
+ * On Demand, which is what kdr uses, always runs the builtin kernel
+ * selected at compile time (see KDR_SIMDJSON_ARCH), so it is timed
+ * through book_t::from_json() exactly as the engine calls it. The DOM
+ * parser dispatches at runtime, so it is timed once per kernel the
+ * host supports to show what each would buy.
+ */
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+std::vector<simdjson::padded_string> load_frames(const std::string &path) {
+  std::ifstream in{path};
+  if (!in) {
+    throw std::runtime_error("cannot open: " + path);
+  }
+  auto result = std::vector<simdjson::padded_string>{};
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty()) {
+      result.emplace_back(line);
+    }
+  }
+  return result;
+}
+
+void report(std::string_view label, std::string_view kernel,
+            size_t num_frames, size_t num_bytes, clock_type::duration elapsed) {
+  const auto secs = std::chrono::duration<double>(elapsed).count();
+  std::cout << std::left << std::setw(24) << label << std::setw(12) << kernel
+            << std::right << std::fixed << std::setprecision(1)
+            << std::setw(12) << (num_frames / secs / 1e3) << " kframes/s"
+            << std::setw(10) << (num_bytes / secs / 1e6) << " MB/s"
+            << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 2 || argc > 3) {
+    std::cerr << "usage: " << argv[0] << " <ndjson frames file> [iterations]"
+              << std::endl;
+    return -1;
+  }
+
+  try {
+    const auto frames = load_frames(argv[1]);
+    const size_t iterations = argc == 3 ? std::atol(argv[2]) : 1000;
+
+    size_t frame_bytes = 0;
+    for (const auto &frame : frames) {
+      frame_bytes += frame.size();
+    }
+    const auto num_frames = frames.size() * iterations;
+    const auto num_bytes = frame_bytes * iterations;
+
+    std::cout << "frames: " << frames.size() << " iterations: " << iterations
+              << " builtin: " << simdjson::builtin_implementation()->name()
+              << std::endl;
+
+    {
+      simdjson::ondemand::parser parser;
+      size_t num_levels = 0;
+      const auto begin = clock_type::now();
+      for (size_t iter = 0; iter < iterations; ++iter) {
+        for (const auto &frame : frames) {
+          simdjson::ondemand::document doc = parser.iterate(frame);
+          const auto book = kdr::response::book_t::from_json(doc);
+          num_levels += book.bids().size() + book.asks().size();
+        }
+      }
+      const auto end = clock_type::now();
+      report("ondemand book_t", simdjson::builtin_implementation()->name(),
+             num_frames, num_bytes, end - begin);
+      if (num_levels == 0) {
+        std::cerr << "warning: no levels parsed" << std::endl;
+      }
+    }
+
+    for (const auto *impl : simdjson::get_available_implementations()) {
+      if (!impl->supported_by_runtime_system()) {
+        continue;
+      }
+      simdjson::get_active_implementation() = impl;
+      simdjson::dom::parser parser;
+      const auto begin = clock_type::now();
+      for (size_t iter = 0; iter < iterations; ++iter) {
+        for (const auto &frame : frames) {
+          if (parser.parse(frame).error() != simdjson::SUCCESS) {
+            throw std::runtime_error("dom parse failed");
+          }
+        }
+      }
+      const auto end = clock_type::now();
+      report("dom parse", impl->name(), num_frames, num_bytes, end - begin);
+    }
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what() << std::endl;
+    return -1;
+  }
+}
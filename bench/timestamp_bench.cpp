@@ -0,0 +1,95 @@
+#include "timestamp.hpp"
+
+#include <date/date.h>
+#include <date/tz.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * Compare timestamp_t's ISO 8601 parser and formatter with the
+ * date-library code they replaced (an istringstream and date::parse;
+ * date::make_zoned and date::format) on random timestamps from recent
+ * years.
+ */
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+using micros_t = std::chrono::microseconds;
+
+void report(std::string_view label, size_t num_items,
+            clock_type::duration elapsed) {
+  const auto secs = std::chrono::duration<double>(elapsed).count();
+  std::cout << std::left << std::setw(24) << label << std::right << std::fixed
+            << std::setprecision(1) << std::setw(12)
+            << (num_items / secs / 1e6) << " M/s" << std::setw(10)
+            << (secs * 1e9 / num_items) << " ns/item" << std::endl;
+}
+
+template <typename Input, typename Fn>
+void run(std::string_view label, const std::vector<Input> &inputs,
+         size_t iterations, Fn fn) {
+  uint64_t checksum = 0;
+  const auto begin = clock_type::now();
+  for (size_t iter = 0; iter < iterations; ++iter) {
+    for (const auto &input : inputs) {
+      checksum += fn(input);
+    }
+  }
+  const auto end = clock_type::now();
+  report(label, inputs.size() * iterations, end - begin);
+  if (checksum == 0) {
+    std::cerr << "warning: nothing done" << std::endl;
+  }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc > 2) {
+    std::cerr << "usage: " << argv[0] << " [iterations]" << std::endl;
+    return -1;
+  }
+  const size_t iterations = argc == 2 ? std::atol(argv[1]) : 100;
+
+  // 2020 through 2029.
+  auto rng = std::mt19937_64{42};
+  auto dist = std::uniform_int_distribution<int64_t>{1577836800000000,
+                                                     1893455999999999};
+  auto micros = std::vector<int64_t>(10000);
+  auto strs = std::vector<std::string>{};
+  for (auto &value : micros) {
+    value = dist(rng);
+    strs.push_back(kdr::timestamp_t::to_iso_8601(value));
+  }
+  std::cout << "timestamps: " << micros.size()
+            << " iterations: " << iterations << std::endl;
+
+  run("date::parse", strs, iterations, [](const std::string &str) {
+    std::istringstream ins{str};
+    date::sys_time<micros_t> tsp;
+    ins >> date::parse("%FT%TZ", tsp);
+    return tsp.time_since_epoch().count();
+  });
+  run("from_iso_8601", strs, iterations, [](const std::string &str) {
+    return kdr::timestamp_t::from_iso_8601(str);
+  });
+
+  run("date::format", micros, iterations, [](int64_t value) {
+    const auto tsp = std::chrono::system_clock::time_point{micros_t{value}};
+    std::ostringstream outs;
+    outs << date::format("%FT%TZ", date::make_zoned("GMT", tsp));
+    return outs.str().size();
+  });
+  run("to_chars", micros, iterations, [](int64_t value) {
+    kdr::timestamp_t::chars_t buffer;
+    return kdr::timestamp_t{value}.to_chars(buffer).size();
+  });
+}
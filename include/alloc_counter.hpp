@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+
+namespace kdr {
+
+/**
+ * Heap allocations and frees made so far by the calling thread,
+ * counted by the replacement global operator new and delete in
+ * alloc_hooks.cpp. An engine reports these for its processing
+ * thread, whose counts should stop rising with num_msgs once its
+ * books, buffers and builders have grown to steady state.
+ *
+ * The replacements live in the kdr_alloc_hooks object library rather
+ * than in libkdr, so that only binaries which link it (kdr_record and
+ * the tests) have their allocator replaced; elsewhere both counts stay
+ * at zero.
+ */
+size_t thread_allocs();
+size_t thread_frees();
+
+namespace detail {
+
+/** Called by the replacement operator new and delete. */
+void count_alloc() noexcept;
+void count_free() noexcept;
+
+} // namespace detail
+
+} // namespace kdr
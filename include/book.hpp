@@ -1,11 +1,13 @@
 #pragma once
 
 #include "header.hpp"
+#include "symbols.hpp"
 #include "types.hpp"
 
 #include <boost/json.hpp>
 #include <simdjson.h>
 
+#include <functional>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -13,6 +15,55 @@
 namespace kdr {
 namespace response {
 
+/**
+ * book_stream_t receives a book message piece by piece as
+ * book_t::stream_json() parses it, so that consumers can apply each
+ * level where it belongs without materializing a book_t.
+ *
+ * For each message: begin() with its header, symbol and the symbol's
+ * id (see model::symbol_table_t), which may return false to skip the
+ * rest of the message; then accept_bid()
+ * and accept_ask() once per level in the order received; then end()
+ * with the checksum and (for updates) the venue's timestamp.
+ *
+ * A message that fails part way, after begin() returned true, gets
+ * abort() in place of end(): consumers must then drop whatever they
+ * staged for it.
+ */
+struct book_stream_t final {
+  using begin_t = std::function<bool(const header_t &, symbol_id_t,
+                                     const std::string &symbol)>;
+  using accept_quote_t = std::function<void(const quote_t &)>;
+  using end_t = std::function<void(const std::string &symbol, uint64_t crc32,
+                                   timestamp_t timestamp)>;
+  using abort_t = std::function<void()>;
+
+  book_stream_t(const begin_t &begin, const accept_quote_t &accept_bid,
+                const accept_quote_t &accept_ask, const end_t &end,
+                const abort_t &abort = [] {})
+      : m_begin{begin}, m_accept_bid{accept_bid}, m_accept_ask{accept_ask},
+        m_end{end}, m_abort{abort} {}
+
+  bool begin(const header_t &header, symbol_id_t id,
+             const std::string &symbol) const {
+    return m_begin(header, id, symbol);
+  }
+  void accept_bid(const bid_t &bid) const { m_accept_bid(bid); }
+  void accept_ask(const ask_t &ask) const { m_accept_ask(ask); }
+  void end(const std::string &symbol, uint64_t crc32,
+           timestamp_t timestamp) const {
+    m_end(symbol, crc32, timestamp);
+  }
+  void abort() const { m_abort(); }
+
+private:
+  begin_t m_begin;
+  accept_quote_t m_accept_bid;
+  accept_quote_t m_accept_ask;
+  end_t m_end;
+  abort_t m_abort;
+};
+
 /**
  * https://docs.kraken.com/websockets-v2/#book
  */
@@ -30,10 +81,6 @@ struct book_t final {
   static const std::string_view c_symbol;
   static const std::string_view c_timestamp;
 
-  /** Field values */
-  static const std::string_view c_snapshot;
-  static const std::string_view c_update;
-
   book_t() = default;
   book_t(const header_t &header, const asks_t &asks, const bids_t &bids,
          uint64_t crc32, std::string symbol, timestamp_t timestamp);
@@ -45,7 +92,31 @@ struct book_t final {
   const std::string &symbol() const { return m_symbol; }
   timestamp_t timestamp() const { return m_timestamp; }
 
-  static book_t from_json(simdjson::ondemand::document &response);
+  /**
+   * A level-less book of type msg_type_gap. The venue never sends
+   * these: we record one for each subscribed symbol when the
+   * connection drops, so that readers know the updates which follow
+   * are not contiguous.
+   */
+  static book_t gap(std::string symbol, timestamp_t recv_tm);
+
+  /** recv_tm is the time at which the message was read off the wire. */
+  static book_t from_json(simdjson::ondemand::document &response,
+                          timestamp_t recv_tm = timestamp_t::now());
+
+  /**
+   * Parse a book message straight into `stream` in a single pass,
+   * looking its symbol's id up in `symbols` once. Unknown symbols and
+   * exceptions thrown by the stream propagate.
+   */
+  static void stream_json(simdjson::ondemand::document &response,
+                          timestamp_t recv_tm,
+                          const model::symbol_table_t &symbols,
+                          const book_stream_t &stream);
+
+  /** Replay this book through `stream`. */
+  void stream(const model::symbol_table_t &symbols,
+              const book_stream_t &stream) const;
 
   boost::json::object to_json_obj(integer_t price_precision,
                                   integer_t qty_precision) const;
@@ -1,19 +1,26 @@
 #pragma once
 
 #include "depth.hpp"
+#include "price_format.hpp"
 #include "types.hpp"
 
 #include <boost/json.hpp>
 #include <simdjson.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <stdexcept>
 #include <string>
 #include <unordered_set>
+#include <vector>
 
 namespace kdr {
 
 struct config_t final {
   using symbol_filter_t = std::unordered_set<std::string>;
+  using cpu_list_t = std::vector<int>;
+  using symbol_list_t = std::vector<std::string>;
+  using column_compression_t = std::vector<std::string>;
 
   static constexpr std::string_view c_book_depth = "book_depth";
   static constexpr std::string_view c_capture_book = "capture_book";
@@ -24,6 +31,41 @@ struct config_t final {
   static constexpr std::string_view c_parquet_dir = "parquet_dir";
   static constexpr std::string_view c_ping_interval_secs = "ping_interval_secs";
   static constexpr std::string_view c_enable_shmem = "enable_shmem";
+  static constexpr std::string_view c_io_thread = "io_thread";
+  static constexpr std::string_view c_num_shards = "num_shards";
+  static constexpr std::string_view c_cpu_affinity = "cpu_affinity";
+  static constexpr std::string_view c_reconnect = "reconnect";
+  static constexpr std::string_view c_subscribe_batch_size =
+      "subscribe_batch_size";
+  static constexpr std::string_view c_subscribe_max_in_flight =
+      "subscribe_max_in_flight";
+  static constexpr std::string_view c_subscribe_rate = "subscribe_rate";
+  static constexpr std::string_view c_subscribe_timeout_secs =
+      "subscribe_timeout_secs";
+  static constexpr std::string_view c_priority_pairs = "priority_pairs";
+  static constexpr std::string_view c_price_format = "price_format";
+  static constexpr std::string_view c_writer_queue_size = "writer_queue_size";
+  static constexpr std::string_view c_rotate_interval_secs =
+      "rotate_interval_secs";
+  static constexpr std::string_view c_rotate_size_mb = "rotate_size_mb";
+  static constexpr std::string_view c_partition_by_symbol =
+      "partition_by_symbol";
+  static constexpr std::string_view c_max_open_partitions =
+      "max_open_partitions";
+  static constexpr std::string_view c_parquet_compression =
+      "parquet_compression";
+  static constexpr std::string_view c_parquet_column_compression =
+      "parquet_column_compression";
+  static constexpr std::string_view c_parquet_dictionary =
+      "parquet_dictionary";
+  static constexpr std::string_view c_parquet_delta_encoding =
+      "parquet_delta_encoding";
+  static constexpr std::string_view c_parquet_byte_stream_split =
+      "parquet_byte_stream_split";
+  static constexpr std::string_view c_parquet_row_group_size =
+      "parquet_row_group_size";
+  static constexpr std::string_view c_parquet_data_page_size =
+      "parquet_data_page_size";
 
   config_t() {}
 
@@ -55,9 +97,128 @@ struct config_t final {
   bool capture_book() const { return m_capture_book; }
   bool capture_trades() const { return m_capture_trades; }
   bool enable_shmem() const { return m_enable_shmem; }
+  bool io_thread() const { return m_io_thread; }
+  size_t num_shards() const { return m_num_shards; }
+  const cpu_list_t &cpu_affinity() const { return m_cpu_affinity; }
+  bool reconnect() const { return m_reconnect; }
+  size_t subscribe_batch_size() const { return m_subscribe_batch_size; }
+  size_t subscribe_max_in_flight() const { return m_subscribe_max_in_flight; }
+  /** Subscribe requests per second, or zero for no limit. */
+  size_t subscribe_rate() const { return m_subscribe_rate; }
+  size_t subscribe_timeout_secs() const { return m_subscribe_timeout_secs; }
+  const symbol_list_t &priority_pairs() const { return m_priority_pairs; }
+  model::price_format_t price_format() const { return m_price_format; }
+  /**
+   * Finished parquet batches that may await the writer thread, or
+   * zero to write them inline on the processing thread.
+   */
+  size_t writer_queue_size() const { return m_writer_queue_size; }
+  /**
+   * Start new book and trades files on multiples of this many seconds
+   * and once a file reaches this many megabytes; zero for never.
+   */
+  size_t rotate_interval_secs() const { return m_rotate_interval_secs; }
+  size_t rotate_size_mb() const { return m_rotate_size_mb; }
+  /**
+   * Write book and trades files under a directory per symbol and
+   * date, keeping at most max_open_partitions files open per sink
+   * across shards (zero for one per pair).
+   */
+  bool partition_by_symbol() const { return m_partition_by_symbol; }
+  size_t max_open_partitions() const { return m_max_open_partitions; }
+  /**
+   * How book and trades files are encoded and compressed; see
+   * pq::writer_properties_t. Codecs are checked when the files are
+   * opened.
+   */
+  std::string parquet_compression() const { return m_parquet_compression; }
+  const column_compression_t &parquet_column_compression() const {
+    return m_parquet_column_compression;
+  }
+  bool parquet_dictionary() const { return m_parquet_dictionary; }
+  bool parquet_delta_encoding() const { return m_parquet_delta_encoding; }
+  bool parquet_byte_stream_split() const {
+    return m_parquet_byte_stream_split;
+  }
+  size_t parquet_row_group_size() const { return m_parquet_row_group_size; }
+  size_t parquet_data_page_size() const { return m_parquet_data_page_size; }
+
+  /**
+   * Options that postdate the constructor above are set individually
+   * so that call sites only mention what they care about.
+   */
+  void set_io_thread(bool io_thread) { m_io_thread = io_thread; }
+  void set_num_shards(size_t num_shards) {
+    m_num_shards = std::max(num_shards, size_t{1});
+  }
+  void set_cpu_affinity(cpu_list_t cpu_affinity) {
+    m_cpu_affinity = std::move(cpu_affinity);
+  }
+  void set_reconnect(bool reconnect) { m_reconnect = reconnect; }
+  void set_subscribe_batch_size(size_t batch_size) {
+    m_subscribe_batch_size = std::max(batch_size, size_t{1});
+  }
+  void set_subscribe_max_in_flight(size_t max_in_flight) {
+    m_subscribe_max_in_flight = std::max(max_in_flight, size_t{1});
+  }
+  void set_subscribe_rate(size_t rate) { m_subscribe_rate = rate; }
+  void set_subscribe_timeout_secs(size_t timeout_secs) {
+    m_subscribe_timeout_secs = timeout_secs;
+  }
+  void set_priority_pairs(symbol_list_t priority_pairs) {
+    m_priority_pairs = std::move(priority_pairs);
+  }
+  void set_price_format(model::price_format_t price_format) {
+    if (price_format == model::price_format_invalid) {
+      throw std::runtime_error(
+          "price_format must be one of {string, decimal128, int64}");
+    }
+    m_price_format = price_format;
+  }
+  void set_writer_queue_size(size_t queue_size) {
+    m_writer_queue_size = queue_size;
+  }
+  void set_rotate_interval_secs(size_t interval_secs) {
+    m_rotate_interval_secs = interval_secs;
+  }
+  void set_rotate_size_mb(size_t size_mb) { m_rotate_size_mb = size_mb; }
+  void set_partition_by_symbol(bool partition_by_symbol) {
+    m_partition_by_symbol = partition_by_symbol;
+  }
+  void set_max_open_partitions(size_t max_open) {
+    m_max_open_partitions = max_open;
+  }
+  void set_parquet_compression(std::string compression) {
+    m_parquet_compression = std::move(compression);
+  }
+  void set_parquet_column_compression(column_compression_t compression) {
+    m_parquet_column_compression = std::move(compression);
+  }
+  void set_parquet_dictionary(bool dictionary) {
+    m_parquet_dictionary = dictionary;
+  }
+  void set_parquet_delta_encoding(bool delta_encoding) {
+    m_parquet_delta_encoding = delta_encoding;
+  }
+  void set_parquet_byte_stream_split(bool byte_stream_split) {
+    m_parquet_byte_stream_split = byte_stream_split;
+  }
+  void set_parquet_row_group_size(size_t row_group_size) {
+    m_parquet_row_group_size = std::max(row_group_size, size_t{1});
+  }
+  void set_parquet_data_page_size(size_t data_page_size) {
+    m_parquet_data_page_size = std::max(data_page_size, size_t{1});
+  }
 
 private:
   static constexpr size_t c_default_ping_interval_secs = 30;
+  static constexpr size_t c_default_subscribe_batch_size = 128;
+  static constexpr size_t c_default_subscribe_max_in_flight = 8;
+  static constexpr size_t c_default_subscribe_timeout_secs = 10;
+  static constexpr size_t c_default_writer_queue_size = 8;
+  static constexpr size_t c_default_max_open_partitions = 128;
+  static constexpr size_t c_default_parquet_row_group_size = 64 * 1024;
+  static constexpr size_t c_default_parquet_data_page_size = 1024 * 1024;
 
   size_t m_ping_interval_secs = c_default_ping_interval_secs;
   std::string m_kraken_host = "ws.kraken.com";
@@ -68,6 +229,28 @@ private:
   bool m_capture_book = true;
   bool m_capture_trades = true;
   bool m_enable_shmem = false;
+  bool m_io_thread = false;
+  size_t m_num_shards = 1;
+  cpu_list_t m_cpu_affinity;
+  bool m_reconnect = true;
+  size_t m_subscribe_batch_size = c_default_subscribe_batch_size;
+  size_t m_subscribe_max_in_flight = c_default_subscribe_max_in_flight;
+  size_t m_subscribe_rate = 0;
+  size_t m_subscribe_timeout_secs = c_default_subscribe_timeout_secs;
+  symbol_list_t m_priority_pairs;
+  model::price_format_t m_price_format = model::price_format_string;
+  size_t m_writer_queue_size = c_default_writer_queue_size;
+  size_t m_rotate_interval_secs = 0;
+  size_t m_rotate_size_mb = 0;
+  bool m_partition_by_symbol = false;
+  size_t m_max_open_partitions = c_default_max_open_partitions;
+  std::string m_parquet_compression = "snappy";
+  column_compression_t m_parquet_column_compression;
+  bool m_parquet_dictionary = true;
+  bool m_parquet_delta_encoding = false;
+  bool m_parquet_byte_stream_split = false;
+  size_t m_parquet_row_group_size = c_default_parquet_row_group_size;
+  size_t m_parquet_data_page_size = c_default_parquet_data_page_size;
 };
 
 } // namespace kdr
@@ -20,8 +20,6 @@ static constexpr char c_app_name[] = "kdr";
 
 static constexpr size_t c_expected_cacheline_size = 64;
 
-static constexpr size_t c_subscription_batch_size = 128;
-
 /** Websocket protocol strings */
 static constexpr char c_request_channel[] = "channel";
 static constexpr char c_request_method[] = "method";
@@ -35,6 +33,9 @@ static constexpr char c_param_symbol[] = "symbol";
 static constexpr char c_response_data[] = "data";
 static constexpr char c_response_channel[] = "channel";
 static constexpr char c_response_method[] = "method";
+static constexpr char c_response_error[] = "error";
+static constexpr char c_response_result[] = "result";
+static constexpr char c_response_success[] = "success";
 
 static constexpr char c_channel_instrument[] = "instrument";
 static constexpr char c_channel_book[] = "book";
@@ -44,6 +45,7 @@ static constexpr char c_channel_heartbeat[] = "heartbeat";
 static constexpr char c_method_ping[] = "ping";
 static constexpr char c_method_pong[] = "pong";
 static constexpr char c_method_subscribe[] = "subscribe";
+static constexpr char c_method_unsubscribe[] = "unsubscribe";
 
 static constexpr char c_instrument_assets[] = "assets";
 static constexpr char c_instrument_pairs[] = "pairs";
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace kdr {
+
+/**
+ * crc32_t computes the same CRC-32 (IEEE 802.3, reflected) as
+ * boost::crc_32_type but over whole spans rather than a byte at a
+ * time. Spans of at least c_min_clmul_size bytes are folded with
+ * carry-less multiplication (PCLMULQDQ) where the CPU supports it,
+ * detected at runtime; the rest go through a slice-by-8 table.
+ */
+struct crc32_t final {
+  /** Shorter spans are quicker through the table. */
+  static constexpr size_t c_min_clmul_size = 64;
+
+  void process_bytes(const void *data, size_t size);
+  void process_bytes(std::string_view bytes) {
+    process_bytes(bytes.data(), bytes.size());
+  }
+
+  uint32_t checksum() const { return ~m_state; }
+
+  /**
+   * The kernels process_bytes() chooses between, exposed for tests
+   * and benchmarks. Both advance a raw (uninverted) CRC register;
+   * update_clmul() requires have_clmul() and a size that is a
+   * multiple of 16 and at least c_min_clmul_size.
+   */
+  static bool have_clmul();
+  static uint32_t update_table(uint32_t state, const void *data, size_t size);
+  static uint32_t update_clmul(uint32_t state, const void *data, size_t size);
+
+private:
+  uint32_t m_state = ~uint32_t{0};
+};
+
+} // namespace kdr
@@ -2,14 +2,25 @@
 
 #include "config.hpp"
 #include "metrics.hpp"
+#include "msg_slot.hpp"
 #include "refdata.hpp"
 #include "requests.hpp"
 #include "session.hpp"
+#include "shard.hpp"
 #include "sink.hpp"
+#include "subscriptions.hpp"
+#include "trades.hpp"
 
 #include <simdjson.h>
 
-#include <queue>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
 
 /**
  * engine_t is our central dispatcher for messages received from the
@@ -17,6 +28,38 @@
  * of whether or not we have subscribed to the pairs in the initial
  * instrument snapshot.
  *
+ * Messages are processed as they arrive; nothing polls. By default
+ * everything runs on the session's io_context. With the io_thread
+ * option, a dedicated thread owns the session and does nothing but
+ * read and timestamp frames, which it copies into an spsc ring; the
+ * thread calling run() drains the ring, parses and sinks messages,
+ * and runs the engine's timers on an io_context of its own. The
+ * reader posts a drain only when the ring goes from empty to
+ * non-empty, and each drain takes a batch sized to the backlog. A
+ * slow sink then delays the ring's consumer rather than the socket
+ * read.
+ *
+ * Book and trade subscriptions are paced by a
+ * subscription_scheduler_t, whose timer runs only while any are
+ * queued or awaiting acks.
+ *
+ * With num_shards > 1, several engines (each with its own session,
+ * io_context and thread) split the symbol universe between them.
+ * Shard 0 leads: it alone subscribes to the instrument channel and,
+ * on receipt of the snapshot, hands each follower the instrument
+ * response along with the symbols assigned to it by shard_of().
+ *
+ * When the session reconnects after a network error, the engine
+ * replays the book and trade subscriptions it had made (or queued)
+ * rather than starting from the instrument snapshot again, and the
+ * sinks stay open throughout. On disconnect it records a 'gap' book
+ * for each symbol whose book subscription was live, so that readers
+ * know the next snapshot is not contiguous with what came before.
+ *
+ * A book whose checksum fails is resynced on its own: the engine
+ * records a gap, unsubscribes and resubscribes that symbol with a
+ * snapshot, and drops its updates until the snapshot arrives.
+ *
  * As functionality expands, this will be broken into submodules.
  */
 namespace kdr {
@@ -26,62 +69,182 @@ struct engine_t final {
 
   using recv_cb_t = session_t::recv_cb_t;
 
+  /** `symbols` resolves each book message's symbol to its id. */
   engine_t(ssl_context_t &ssl_context, const config_t &config,
-           const sink_t &sink);
+           const model::symbol_table_t &symbols, const sink_t &sink,
+           shard_id_t shard = 0);
+
+  shard_id_t shard() const { return m_shard; }
+  bool leader() const { return m_shard == 0; }
+
+  /** Leader only; call before any engine starts processing. */
+  void add_follower(engine_t &follower) { m_followers.push_back(&follower); }
 
   const session_t &session() const { return m_session; }
   session_t &session() { return m_session; }
 
   void start_processing(const recv_cb_t &recv_cb);
+
+  /**
+   * Process until the session stops or `shutting_down` is set. In
+   * io_thread mode this spawns and joins the I/O thread.
+   */
+  void run(const std::atomic<bool> &shutting_down);
+
   bool keep_processing() const { return m_session.keep_processing(); }
   void stop_processing() {
     m_metrics_timer.cancel();
     m_ping_timer.cancel();
-    m_process_timer.cancel();
+    m_subscribe_timer.cancel();
     m_session.stop_processing();
   }
 
-  /** Return false to cease processing and shut down. */
-  bool handle_msg(msg_t);
+  /**
+   * Return false to cease processing and shut down. The message is
+   * parsed in place and must not outlive this call.
+   */
+  bool handle_msg(padded_msg_t, timestamp_t recv_tm);
 
 private:
   static constexpr auto c_metrics_interval_secs = 10;
-  static constexpr auto c_process_interval_micros = 30;
-  static constexpr size_t c_process_batch_size = 64;
+  static constexpr auto c_idle_wait_millis = 100;
+  static constexpr size_t c_ring_capacity = 1024;
+  static constexpr size_t c_min_drain_batch = 64;
 
   using doc_t = simdjson::ondemand::document;
   using error_code = boost::beast::error_code;
 
-  bool handle_instrument_msg(doc_t &);
-  bool handle_instrument_snapshot(doc_t &);
-  bool handle_instrument_update(doc_t &);
+  /**
+   * Where handle_msg() sends a message, as determined by its
+   * 'channel' or, failing that, its 'method' field. 'unrouted' means
+   * the discriminator was present but we don't handle its value.
+   */
+  enum class route_t : uint8_t {
+    unknown,
+    unrouted,
+    book,
+    trade,
+    instrument,
+    heartbeat,
+    pong,
+    subscribe,
+    unsubscribe
+  };
+
+  using symbol_set_t = std::set<std::string>;
+
+  static route_t route_channel(std::string_view);
+  static route_t route_method(std::string_view);
+  static route_t route_msg(doc_t &);
+
+  /** The io_context on which engine timers and processing run. */
+  session_t::ioc_t &processing_ioc() {
+    return m_ring ? m_engine_ioc : m_session.ioc();
+  }
 
-  bool handle_book_msg(doc_t &);
-  bool handle_trade_msg(doc_t &);
+  /** Send on the session's thread, whichever thread we're on. */
+  void send(std::string msg);
+
+  /** Producer side of the ring; runs on the I/O thread. */
+  bool enqueue_msg(padded_msg_t, timestamp_t recv_tm);
+  /** Post a drain unless one is already pending. */
+  void post_drain();
+  /**
+   * Consumer side of the ring. Handle up to a batch of messages and
+   * repost if more remain, so that timers still get a turn; the batch
+   * doubles while a backlog persists and halves once it clears.
+   */
+  void drain_ring();
+
+  void on_connected();
+  void on_reconnected();
+  void on_disconnected();
+
+  /**
+   * Batch up subscriptions for `symbols` (processing thread only) and
+   * remember them for replay after a reconnect.
+   */
+  void queue_subscriptions(const std::vector<std::string> &symbols);
+  void queue_book_subscriptions(const symbol_set_t &symbols);
+  void queue_trade_subscriptions(const symbol_set_t &symbols);
+
+  /**
+   * Post an instrument response (and, for a snapshot, this shard's
+   * symbols) to a follower's processing thread.
+   */
+  void post_instrument(const response::instrument_t &,
+                       std::vector<std::string> symbols);
+
+  bool handle_instrument_msg(doc_t &, timestamp_t recv_tm);
+  bool handle_instrument_snapshot(doc_t &, timestamp_t recv_tm);
+  bool handle_instrument_update(doc_t &, timestamp_t recv_tm);
+
+  /**
+   * Stream a book message into the sink as it is parsed. A message
+   * that fails once under way, on its checksum or otherwise, is
+   * aborted and resyncs only that symbol.
+   */
+  bool handle_book_msg(doc_t &, timestamp_t recv_tm);
+  /** Skip books whose symbol is awaiting a resync snapshot. */
+  bool begin_book(const response::header_t &, symbol_id_t,
+                  const std::string &symbol);
+  void resync_book(symbol_id_t, timestamp_t recv_tm);
+
+  bool handle_trade_msg(doc_t &, timestamp_t recv_tm);
 
   bool handle_heartbeat_msg(doc_t &);
   bool handle_pong_msg(doc_t &);
+  bool handle_subscribe_msg(doc_t &);
 
   void on_metrics_timer(error_code ec);
   void on_ping_timer(error_code ec);
-  void on_process_timer(error_code ec);
+  /**
+   * Send whatever the scheduler allows now and arm the subscribe timer
+   * for when it next might allow more.
+   */
+  void send_subscriptions();
+  void on_subscribe_timer(error_code ec);
 
   session_t m_session;
   config_t m_config;
+  const model::symbol_table_t &m_symbols;
+  const shard_id_t m_shard;
+  std::vector<engine_t *> m_followers;
+
+  session_t::ioc_t m_engine_ioc;
+  std::unique_ptr<msg_ring_t> m_ring;
+  std::atomic<size_t> m_ring_overflows = 0;
+  std::atomic<bool> m_drain_pending = false;
+  size_t m_drain_batch = c_min_drain_batch;
+  recv_cb_t m_recv_cb;
 
   simdjson::ondemand::parser m_parser;
 
-  req_id_t m_book_req_id = 0;
-  req_id_t m_inst_req_id = 0;
+  // Shared by every subscribe/unsubscribe so that acks can be matched
+  // to their request by id alone.
+  req_id_t m_req_id = 0;
   req_id_t m_ping_req_id = 0;
-  req_id_t m_trade_req_id = 0;
 
   boost::asio::deadline_timer m_metrics_timer;
   boost::asio::deadline_timer m_ping_timer;
-  boost::asio::steady_timer m_process_timer;
-  std::queue<response::book_t> m_book_responses;
-  std::queue<request::subscribe_book_t> m_book_subs;
-  std::queue<request::subscribe_trade_t> m_trade_subs;
+  boost::asio::steady_timer m_subscribe_timer;
+  bool m_subscribe_armed = false;
+  bool m_subscribing = false;
+  subscription_scheduler_t m_subscriptions;
+  response::book_stream_t m_book_stream;
+  symbol_id_t m_book_symbol = 0;
+  /** Between the sink's begin() returning true and end(). */
+  bool m_book_open = false;
+  // Refilled by each trade message so that, once it has grown to the
+  // largest batch seen, parsing trades does not allocate.
+  response::trades_t m_trades;
+
+  bool m_timers_started = false;
+  bool m_have_instruments = false;
+  symbol_set_t m_book_symbols;
+  symbol_set_t m_trade_symbols;
+  symbol_set_t m_live_book_symbols;
+  std::unordered_set<symbol_id_t> m_stale_book_symbols;
 
   sink_t m_sink;
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "channel.hpp"
+#include "msg_type.hpp"
 #include "timestamp.hpp"
 
 #include <boost/json.hpp>
@@ -10,6 +12,11 @@
 namespace kdr {
 namespace response {
 
+/**
+ * Channel and type are parsed once, when the message is routed, and
+ * carried as a byte each so that consumers switch rather than
+ * compare strings.
+ */
 struct header_t final {
   /** Field names */
   static const std::string_view c_recv_tm;
@@ -17,19 +24,20 @@ struct header_t final {
   static const std::string_view c_type;
 
   header_t() = default;
-  header_t(timestamp_t recv_tm, std::string channel, std::string type);
+  header_t(timestamp_t recv_tm, model::channel_t channel,
+           model::msg_type_t type);
 
   timestamp_t recv_tm() const { return m_recv_tm; }
-  const std::string &channel() const { return m_channel; }
-  const std::string &type() const { return m_type; }
+  model::channel_t channel() const { return m_channel; }
+  model::msg_type_t type() const { return m_type; }
 
   boost::json::object to_json_obj() const;
   std::string str() const { return boost::json::serialize(to_json_obj()); }
 
 private:
   timestamp_t m_recv_tm;
-  std::string m_channel;
-  std::string m_type;
+  model::channel_t m_channel = model::channel_invalid;
+  model::msg_type_t m_type = model::msg_type_invalid;
 };
 
 } // namespace response
@@ -19,7 +19,9 @@ namespace response {
 struct instrument_t final {
   instrument_t() = default;
 
-  static instrument_t from_json(simdjson::ondemand::document &);
+  /** recv_tm is the time at which the message was read off the wire. */
+  static instrument_t from_json(simdjson::ondemand::document &,
+                                timestamp_t recv_tm = timestamp_t::now());
 
   const header_t &header() const { return m_header; }
   const std::vector<model::asset_t> &assets() const { return m_assets; }
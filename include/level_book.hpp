@@ -1,29 +1,56 @@
 #pragma once
 
 #include "sides.hpp"
+#include "symbols.hpp"
 
-#include <unordered_map>
+#include <optional>
+#include <vector>
 
 namespace kdr {
 namespace model {
 
+/**
+ * Sides are kept per symbol id (see symbol_table_t); the overloads
+ * taking symbol strings look the id up first and are for callers off
+ * the hot path.
+ */
 struct level_book_t final {
   using symbol_t = std::string;
 
-  const sides_t &sides(symbol_t) const;
+  level_book_t(depth_t book_depth, symbol_table_t &symbols)
+      : m_book_depth{book_depth}, m_symbols{symbols} {};
 
-  level_book_t(depth_t book_depth) : m_book_depth{book_depth} {};
+  const sides_t &sides(symbol_id_t) const;
+  const sides_t &sides(const symbol_t &) const;
 
   void accept(const model::pair_t &);
   void accept(const response::book_t &);
 
+  /**
+   * Streaming counterpart of accept(book_t) (see
+   * response::book_stream_t): begin() selects the symbol's sides,
+   * which the remaining calls then update. end() throws
+   * checksum_error_t if the sides no longer match the checksum.
+   */
+  void begin(const response::header_t &, symbol_id_t);
+  void begin(const response::header_t &, const symbol_t &);
+  void accept_bid(const bid_t &bid) { m_current->accept_bid(bid); }
+  void accept_ask(const ask_t &ask) { m_current->accept_ask(ask); }
+  void end(uint64_t crc32) { m_current->end(crc32); }
+
   uint64_t crc32(symbol_t symbol) const;
 
   std::string str(std::string) const;
 
+  const symbol_table_t &symbols() const { return m_symbols; }
+
 private:
+  sides_t &mutable_sides(symbol_id_t);
+
   depth_t m_book_depth;
-  std::unordered_map<symbol_t, sides_t> m_sides;
+  symbol_table_t &m_symbols;
+  std::vector<std::optional<sides_t>> m_sides;
+  sides_t *m_current = nullptr;
 };
 
 } // namespace model
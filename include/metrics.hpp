@@ -4,6 +4,7 @@
 
 #include <boost/json.hpp>
 
+#include <algorithm>
 #include <cstddef>
 #include <string_view>
 
@@ -11,15 +12,29 @@ namespace kdr {
 
 struct metrics_t final {
   // clang-format off
-  static constexpr std::string_view c_book_last_consumed       = "book_last_consumed";
-  static constexpr std::string_view c_book_last_process_micros = "book_last_process_micros";
-  static constexpr std::string_view c_book_max_queue_depth     = "book_max_queue_depth";
-  static constexpr std::string_view c_book_queue_depth         = "book_queue_depth";
+  static constexpr std::string_view c_num_allocs               = "num_allocs";
   static constexpr std::string_view c_num_bytes                = "num_bytes";
+  static constexpr std::string_view c_num_frees                = "num_frees";
   static constexpr std::string_view c_num_heartbeats           = "num_heartbeats";
   static constexpr std::string_view c_num_msgs                 = "num_msgs";
   static constexpr std::string_view c_num_pings                = "num_pings";
   static constexpr std::string_view c_num_pongs                = "num_pongs";
+  static constexpr std::string_view c_num_reconnects           = "num_reconnects";
+  static constexpr std::string_view c_num_resyncs              = "num_resyncs";
+  static constexpr std::string_view c_num_stale_drops          = "num_stale_drops";
+  static constexpr std::string_view c_partition_evictions      = "partition_evictions";
+  static constexpr std::string_view c_ring_depth               = "ring_depth";
+  static constexpr std::string_view c_ring_max_depth           = "ring_max_depth";
+  static constexpr std::string_view c_ring_overflows           = "ring_overflows";
+  static constexpr std::string_view c_subscribe_micros         = "subscribe_micros";
+  static constexpr std::string_view c_subscribe_timeouts       = "subscribe_timeouts";
+  static constexpr std::string_view c_write_max_micros         = "write_max_micros";
+  static constexpr std::string_view c_write_micros             = "write_micros";
+  static constexpr std::string_view c_writer_max_queue_depth   = "writer_max_queue_depth";
+  static constexpr std::string_view c_writer_queue_depth       = "writer_queue_depth";
+  static constexpr std::string_view c_writer_errors            = "writer_errors";
+  static constexpr std::string_view c_writer_wait_micros       = "writer_wait_micros";
+  static constexpr std::string_view c_writer_waits             = "writer_waits";
   // clang-format on
 
   void accept(msg_t);
@@ -27,17 +42,44 @@ struct metrics_t final {
   void heartbeat() { ++m_num_heartbeats; }
   void ping() { ++m_num_pings; }
   void pong() { ++m_num_pongs; }
+  void reconnect() { ++m_num_reconnects; }
+  void resync() { ++m_num_resyncs; }
+  void stale_drop() { ++m_num_stale_drops; }
 
-  void set_book_last_consumed(size_t consumed) {
-    m_book_last_consumed = consumed;
+  /** Only meaningful when running with a dedicated I/O thread. */
+  void set_ring_depth(size_t depth) {
+    m_ring_depth = depth;
+    m_ring_max_depth = std::max(m_ring_max_depth, m_ring_depth);
   }
-  void set_book_last_process_micros(size_t last_process_micros) {
-    m_book_last_process_micros = last_process_micros;
+  void set_ring_overflows(size_t overflows) { m_ring_overflows = overflows; }
+  /** Heap traffic on the processing thread; see alloc_counter.hpp. */
+  void set_allocs(size_t allocs, size_t frees) {
+    m_num_allocs = allocs;
+    m_num_frees = frees;
   }
-  void set_book_queue_depth(size_t depth) {
-    m_book_queue_depth = depth;
-    m_book_max_queue_depth =
-        std::max(m_book_max_queue_depth, m_book_queue_depth);
+  /** Time from queuing subscriptions until the last was acked. */
+  void set_subscribe_micros(size_t micros) { m_subscribe_micros = micros; }
+  void set_subscribe_timeouts(size_t timeouts) {
+    m_subscribe_timeouts = timeouts;
+  }
+  /** The parquet writer's queue; see pq::async_writer_t. */
+  void set_writer_queue_depth(size_t depth) {
+    m_writer_queue_depth = depth;
+    m_writer_max_queue_depth =
+        std::max(m_writer_max_queue_depth, m_writer_queue_depth);
+  }
+  void set_writer_waits(size_t waits, size_t wait_micros) {
+    m_writer_waits = waits;
+    m_writer_wait_micros = wait_micros;
+  }
+  void set_write_micros(size_t micros, size_t max_micros) {
+    m_write_micros = micros;
+    m_write_max_micros = max_micros;
+  }
+  void set_writer_errors(size_t errors) { m_writer_errors = errors; }
+  /** Partition files closed to stay under max_open_partitions. */
+  void set_partition_evictions(size_t evictions) {
+    m_partition_evictions = evictions;
   }
 
   boost::json::object to_json_obj() const;
@@ -46,15 +88,29 @@ struct metrics_t final {
 
 private:
   const timestamp_t m_stm = timestamp_t::now();
-  size_t m_book_last_consumed = 0;
-  size_t m_book_last_process_micros = 0;
-  size_t m_book_queue_depth = 0;
-  size_t m_book_max_queue_depth = 0;
+  size_t m_num_allocs = 0;
   size_t m_num_bytes = 0;
+  size_t m_num_frees = 0;
   size_t m_num_heartbeats = 0;
   size_t m_num_msgs = 0;
   size_t m_num_pings = 0;
   size_t m_num_pongs = 0;
+  size_t m_num_reconnects = 0;
+  size_t m_num_resyncs = 0;
+  size_t m_num_stale_drops = 0;
+  size_t m_partition_evictions = 0;
+  size_t m_ring_depth = 0;
+  size_t m_ring_max_depth = 0;
+  size_t m_ring_overflows = 0;
+  size_t m_subscribe_micros = 0;
+  size_t m_subscribe_timeouts = 0;
+  size_t m_write_max_micros = 0;
+  size_t m_write_micros = 0;
+  size_t m_writer_errors = 0;
+  size_t m_writer_max_queue_depth = 0;
+  size_t m_writer_queue_depth = 0;
+  size_t m_writer_wait_micros = 0;
+  size_t m_writer_waits = 0;
 };
 
 } // namespace kdr
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "spsc_ring.hpp"
+#include "types.hpp"
+
+#include <simdjson.h>
+
+#include <cstring>
+#include <vector>
+
+namespace kdr {
+
+/**
+ * msg_slot_t is a reusable, simdjson-padded copy of a received message
+ * along with the time at which it was read off the socket. Its buffer
+ * only ever grows, so once it has held the largest message it will see
+ * assign() neither allocates nor frees.
+ */
+struct msg_slot_t final {
+  void assign(msg_t msg, timestamp_t recv_tm) {
+    const auto capacity = msg.size() + simdjson::SIMDJSON_PADDING;
+    if (m_buffer.size() < capacity) {
+      m_buffer.resize(capacity);
+    }
+    std::memcpy(m_buffer.data(), msg.data(), msg.size());
+    std::memset(m_buffer.data() + msg.size(), 0, simdjson::SIMDJSON_PADDING);
+    m_size = msg.size();
+    m_recv_tm = recv_tm;
+  }
+
+  padded_msg_t msg() const {
+    return padded_msg_t{m_buffer.data(), m_size, m_buffer.size()};
+  }
+  timestamp_t recv_tm() const { return m_recv_tm; }
+
+private:
+  std::vector<char> m_buffer;
+  size_t m_size = 0;
+  timestamp_t m_recv_tm;
+};
+
+using msg_ring_t = spsc_ring_t<msg_slot_t>;
+
+} // namespace kdr
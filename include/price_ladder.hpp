@@ -0,0 +1,122 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+namespace kdr {
+namespace model {
+
+/**
+ * price_ladder_t is one side of a book held as a sorted, contiguous
+ * array of levels: a drop-in for the std::map it replaces as far as
+ * sides_t, shmem and the checksum are concerned (find, insert, erase
+ * and best-first iteration over price/qty pairs).
+ *
+ * Levels are stored worst-first so that the busy end of the book, its
+ * top, sits at the back of the array and inserting or erasing there
+ * moves little. Levels beyond the book depth are dropped by advancing
+ * the start of the live range, which is O(1); the dead prefix is
+ * reclaimed once it outgrows the live levels. New worst levels go into
+ * the dead prefix, which is regrown by the live size when it runs out,
+ * so that a snapshot, whose levels arrive best-first, loads in linear
+ * rather than quadratic time.
+ *
+ * `Better` orders prices best-first, e.g. std::greater for bids.
+ */
+template <typename Better> struct price_ladder_t final {
+  using value_type = quote_t;
+  using levels_t = std::vector<value_type>;
+  using iterator = std::reverse_iterator<typename levels_t::iterator>;
+  using const_iterator =
+      std::reverse_iterator<typename levels_t::const_iterator>;
+
+  iterator begin() { return iterator{m_levels.end()}; }
+  iterator end() { return iterator{live_begin()}; }
+  const_iterator begin() const { return const_iterator{m_levels.end()}; }
+  const_iterator end() const { return const_iterator{live_begin()}; }
+
+  Better key_comp() const { return Better{}; }
+
+  size_t size() const { return m_levels.size() - m_first; }
+  bool empty() const { return size() == 0; }
+
+  void clear() {
+    m_levels.clear();
+    m_first = 0;
+  }
+
+  iterator find(const price_t &price) {
+    return find(live_begin(), m_levels.end(), price, end());
+  }
+  const_iterator find(const price_t &price) const {
+    return find(live_begin(), m_levels.end(), price, end());
+  }
+
+  /** Insert a level whose price is not already present. */
+  void insert(const value_type &level) {
+    const auto it = lower_bound(live_begin(), m_levels.end(), level.first);
+    if (it != live_begin()) {
+      m_levels.insert(it, level);
+      return;
+    }
+    if (m_first == 0) {
+      const auto headroom = std::max(size(), size_t{1});
+      m_levels.insert(m_levels.begin(), headroom, level);
+      m_first = headroom;
+    }
+    m_levels[--m_first] = level;
+  }
+
+  void erase(iterator it) {
+    const auto pos = std::prev(it.base());
+    if (pos == live_begin()) {
+      ++m_first;
+    } else {
+      m_levels.erase(pos);
+    }
+  }
+
+  /** Keep only the best `depth` levels. */
+  void truncate(size_t depth) {
+    if (size() > depth) {
+      m_first += size() - depth;
+    }
+    if (m_first > size()) {
+      m_levels.erase(m_levels.begin(), live_begin());
+      m_first = 0;
+    }
+  }
+
+private:
+  typename levels_t::iterator live_begin() {
+    return m_levels.begin() + m_first;
+  }
+  typename levels_t::const_iterator live_begin() const {
+    return m_levels.begin() + m_first;
+  }
+
+  /** The first level no worse than `price` (worst-first order). */
+  template <typename It>
+  static It lower_bound(It first, It last, const price_t &price) {
+    return std::lower_bound(first, last, price,
+                            [](const value_type &level, const price_t &px) {
+                              return Better{}(px, level.first);
+                            });
+  }
+
+  template <typename It, typename R>
+  static R find(It first, It last, const price_t &price, R not_found) {
+    const auto it = lower_bound(first, last, price);
+    return it != last && it->first == price ? R{std::next(it)} : not_found;
+  }
+
+  levels_t m_levels;
+  size_t m_first = 0;
+};
+
+} // namespace model
+} // namespace kdr
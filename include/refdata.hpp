@@ -3,14 +3,25 @@
 #include "asset.hpp"
 #include "instrument.hpp"
 #include "pair.hpp"
+#include "symbols.hpp"
 #include "types.hpp"
 
+#include <mutex>
 #include <optional>
+#include <shared_mutex>
 #include <unordered_map>
+#include <vector>
 
 namespace kdr {
 namespace model {
 
+/**
+ * refdata_t may be shared between shards: one thread accept()s
+ * instrument updates while others look up precisions.
+ *
+ * It owns the symbol table: accept() interns each pair's symbol, and
+ * pairs are then held and looked up by symbol id.
+ */
 struct refdata_t final {
   struct pair_precision_t final {
     integer_t price_precision = 0;
@@ -19,11 +30,18 @@ struct refdata_t final {
 
   void accept(const response::instrument_t &);
 
+  std::optional<pair_precision_t> pair_precision(symbol_id_t) const;
   std::optional<pair_precision_t> pair_precision(const std::string &) const;
 
+  symbol_table_t &symbols() { return m_symbols; }
+  const symbol_table_t &symbols() const { return m_symbols; }
+
 private:
+  symbol_table_t m_symbols;
+
+  mutable std::shared_mutex m_mutex;
   std::unordered_map<std::string, asset_t> m_assets;
-  std::unordered_map<std::string, pair_t> m_pairs;
+  std::vector<std::optional<pair_t>> m_pairs;
 };
 
 } // namespace model
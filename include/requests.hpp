@@ -59,6 +59,24 @@ private:
   std::set<std::string> m_symbols;
 };
 
+/**
+ * See https://docs.kraken.com/websockets-v2/#book
+ */
+struct unsubscribe_book_t final {
+  unsubscribe_book_t(req_id_t req_id, model::depth_t depth,
+                     const std::vector<std::string> &symbols)
+      : m_req_id{req_id}, m_depth{depth},
+        m_symbols{symbols.begin(), symbols.end()} {}
+
+  boost::json::object to_json_obj() const;
+  std::string str() const { return boost::json::serialize(to_json_obj()); }
+
+private:
+  req_id_t m_req_id;
+  model::depth_t m_depth;
+  std::set<std::string> m_symbols;
+};
+
 /**
  * See https://docs.kraken.com/websockets-v2/#trade
  */
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "config.hpp"
+#include "tsc_clock.hpp"
 #include "types.hpp"
 
 #include <boost/asio.hpp>
@@ -9,7 +10,10 @@
 #include <boost/beast/websocket.hpp>
 #include <boost/beast/websocket/ssl.hpp>
 
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <memory>
 #include <string>
 #include <string_view>
 
@@ -21,7 +25,17 @@ namespace kdr {
  *
  * - establishes the websocket connection and performs an SSL handshake
  * - invokes a callback when it receives messages from the venue
+ *   (the message refers to a reusable, simdjson-padded read buffer
+ *   and is only valid for the duration of the callback) along with
+ *   the time at which the read completed
  * - enables client code to send messages to the venue
+ * - with the reconnect option, re-establishes the connection after
+ *   a network error, backing off exponentially between attempts;
+ *   the connected callback runs again on each success and the
+ *   disconnected callback runs when the connection is lost
+ *
+ * Other than keep_processing(), stop_processing() and connected(),
+ * session_t must only be used from the thread running its io_context.
  */
 struct session_t final {
   using ioc_t = boost::asio::io_context;
@@ -30,7 +44,8 @@ struct session_t final {
       boost::beast::ssl_stream<boost::beast::tcp_stream>>;
 
   using connected_cb_t = std::function<void()>;
-  using recv_cb_t = std::function<bool(msg_t)>;
+  using disconnected_cb_t = std::function<void()>;
+  using recv_cb_t = std::function<bool(padded_msg_t, timestamp_t)>;
 
   session_t(ssl_context_t &ssl_context, const config_t &config);
 
@@ -41,9 +56,16 @@ struct session_t final {
   ioc_t &ioc() { return m_ioc; }
 
   bool keep_processing() const { return m_keep_processing; }
-  void start_processing(const connected_cb_t &handle_connected,
-                        const recv_cb_t &handle_recv);
+  void start_processing(
+      const connected_cb_t &handle_connected, const recv_cb_t &handle_recv,
+      const disconnected_cb_t &handle_disconnected = []() {});
   void stop_processing() { m_keep_processing = false; }
+
+  /** True between a completed handshake and the next failure. */
+  bool connected() const { return m_connected; }
+  size_t num_reconnects() const { return m_num_reconnects; }
+
+  /** Messages sent while disconnected are dropped. */
   void send(msg_t);
   void send(const std::string &msg) {
     send(std::string_view(msg.data(), msg.size()));
@@ -53,8 +75,14 @@ private:
   using error_code = boost::beast::error_code;
   using resolver = boost::asio::ip::tcp::resolver;
 
+  static constexpr auto c_min_backoff = std::chrono::seconds(1);
+  static constexpr auto c_max_backoff = std::chrono::seconds(60);
+
   void fail(boost::beast::error_code, char const *);
 
+  void connect();
+  void schedule_reconnect();
+
   void on_resolve(error_code, resolver::results_type);
   void on_connect(error_code, resolver::results_type::endpoint_type);
   void on_ssl_handshake(error_code);
@@ -64,17 +92,32 @@ private:
   void on_close(error_code);
 
   ioc_t m_ioc;
+  ssl_context_t &m_ssl_context;
   resolver m_resolver;
-  websocket_t m_ws;
+  boost::asio::steady_timer m_reconnect_timer;
   config_t m_config;
 
-  bool m_keep_processing = false;
+  // A fresh stream for each connection attempt. The previous one is
+  // kept for one more attempt so that handlers it has outstanding
+  // never refer to a destroyed stream; m_generation lets them notice
+  // that they are stale.
+  std::unique_ptr<websocket_t> m_ws;
+  std::unique_ptr<websocket_t> m_retired_ws;
+  size_t m_generation = 0;
+
+  std::atomic<bool> m_keep_processing = false;
+  std::atomic<bool> m_connected = false;
+  bool m_reconnect_pending = false;
+  std::chrono::seconds m_backoff = c_min_backoff;
+  size_t m_num_reconnects = 0;
 
   connected_cb_t m_handle_connected = []() {};
-  recv_cb_t m_handle_recv = [](msg_t) { return true; };
+  recv_cb_t m_handle_recv = [](padded_msg_t, timestamp_t) { return true; };
+  disconnected_cb_t m_handle_disconnected = []() {};
 
   boost::beast::flat_buffer m_read_buffer;
-  std::string m_read_msg_str;
+  // Stamps each frame as soon as its read completes.
+  tsc_clock_t m_clock;
 };
 
 } // namespace kdr
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace kdr {
+
+using shard_id_t = size_t;
+
+/**
+ * Map a symbol onto one of `num_shards` shards. This uses FNV-1a
+ * rather than std::hash so that a given symbol lands on the same
+ * shard (and hence in the same output files) from one run to the
+ * next.
+ */
+inline shard_id_t shard_of(std::string_view symbol, size_t num_shards) {
+  if (num_shards <= 1) {
+    return 0;
+  }
+  uint64_t hash = 14695981039346656037ULL;
+  for (const char ch : symbol) {
+    hash ^= static_cast<unsigned char>(ch);
+    hash *= 1099511628211ULL;
+  }
+  return hash % num_shards;
+}
+
+/**
+ * Pin the calling thread to `cpu`. Returns false (and leaves the
+ * thread unpinned) where this is unsupported or fails.
+ */
+bool pin_current_thread(int cpu);
+
+} // namespace kdr
@@ -5,6 +5,7 @@
 #include "instrument.hpp"
 #include "level_book.hpp"
 #include "shmem_names.hpp"
+#include "symbols.hpp"
 #include "trades.hpp"
 #include "types.hpp"
 
@@ -15,7 +16,9 @@
 
 #include <array>
 #include <memory>
-#include <unordered_map>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
 
 namespace kdr {
 namespace shmem {
@@ -157,10 +160,15 @@ private:
 };
 
 /**
- * Shared memory sink for book and trade states.
+ * Shared memory sink for book and trade states. Distinct threads may
+ * publish distinct symbols concurrently (e.g. one per shard).
+ * Segments are kept per symbol id (see model::symbol_table_t).
  */
 struct shmem_sink_t final {
 
+  explicit shmem_sink_t(model::symbol_table_t &symbols)
+      : m_symbols{symbols} {}
+
   /**
    * Create shared memory book segments for all pairs referenced in an
    * instrument response.
@@ -168,10 +176,10 @@ struct shmem_sink_t final {
   void accept(const response::instrument_t &response);
 
   /**
-   * Update shared memory representation of level book.
+   * Update shared memory representation of the level book for
+   * `symbol`.
    */
-  void accept(const response::book_t &response,
-              const model::level_book_t &level_book);
+  void accept_book(symbol_id_t symbol, const model::level_book_t &level_book);
 
   /**
    * Update shared memory representation of trades.
@@ -182,8 +190,16 @@ private:
   using book_segment_ptr = std::unique_ptr<book_segment_t>;
   using trade_segment_ptr = std::unique_ptr<trade_segment_t>;
 
-  std::unordered_map<std::string, book_segment_ptr> m_book_segments;
-  std::unordered_map<std::string, trade_segment_ptr> m_trade_segments;
+  model::symbol_table_t &m_symbols;
+
+  /**
+   * Guards the vectors, not the segments, which have their own
+   * mutexes.
+   */
+  mutable std::shared_mutex m_mutex;
+
+  std::vector<book_segment_ptr> m_book_segments;
+  std::vector<trade_segment_ptr> m_trade_segments;
 };
 
 } // namespace shmem
@@ -2,21 +2,42 @@
 
 #include "book.hpp"
 #include "constants.hpp"
+#include "crc32.hpp"
 #include "depth.hpp"
+#include "msg_type.hpp"
 #include "pair.hpp"
+#include "price_ladder.hpp"
 #include "types.hpp"
 
-#include <boost/crc.hpp>
 #include <boost/json.hpp>
 
+#include <iterator>
 #include <map>
+#include <stdexcept>
+#include <string>
 #include <unordered_map>
 
 namespace kdr {
 namespace model {
 
+// KDR_FLAT_SIDES (a CMake option) selects contiguous price ladders
+// over node-based maps; both iterate best-first over price/qty pairs.
+#if KDR_FLAT_SIDES
+using bid_side_t = price_ladder_t<std::greater<price_t>>;
+using ask_side_t = price_ladder_t<std::less<price_t>>;
+#else
 using bid_side_t = std::map<price_t, qty_t, std::greater<price_t>>;
 using ask_side_t = std::map<price_t, qty_t, std::less<price_t>>;
+#endif
+
+/**
+ * Thrown when a book's levels no longer match the venue's checksum.
+ * Only that symbol's book is suspect; it must be resynced from a
+ * fresh snapshot.
+ */
+struct checksum_error_t final : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
 
 struct sides_t final {
   sides_t(depth_t, integer_t price_precision, integer_t qty_precision,
@@ -29,22 +50,50 @@ struct sides_t final {
   const bid_side_t &bids() const { return m_bids; }
   const ask_side_t &asks() const { return m_asks; }
 
-  void accept_snapshot(const response::book_t &);
-  void accept_update(const response::book_t &);
+  /**
+   * Apply a book message level by level: begin() with its type (a
+   * snapshot clears the book, as does a gap, after which levels are
+   * unknown until the next snapshot), then each level, then end()
+   * with its checksum. end() throws checksum_error_t on a mismatch.
+   */
+  void begin(msg_type_t type);
+  void accept_bid(const bid_t &bid) { apply_level(bid, m_bids, m_bid_crc); }
+  void accept_ask(const ask_t &ask) { apply_level(ask, m_asks, m_ask_crc); }
+  void end(uint64_t crc32);
 
   uint64_t crc32() const;
 
+  /**
+   * Whether a side's checksum bytes will be rebuilt by the next
+   * crc32(), exposed for tests.
+   */
+  bool bid_crc_stale() const { return m_bid_crc.stale; }
+  bool ask_crc_stale() const { return m_ask_crc.stale; }
+
   boost::json::object to_json_obj() const;
   std::string str() const { return boost::json::serialize(to_json_obj()); }
 
 private:
-  template <typename Q, typename S> void apply_update(const Q &, S &);
+  /** Levels per side covered by the checksum. */
+  static constexpr size_t c_crc32_depth = 10;
+
+  /**
+   * The bytes one side contributes to the checksum, rebuilt only
+   * after a change within its top c_crc32_depth levels.
+   */
+  struct crc_bytes_t final {
+    std::string bytes;
+    bool stale = true;
+  };
+
+  template <typename S> void apply_level(const quote_t &, S &, crc_bytes_t &);
+  template <typename S> void truncate(S &);
 
   void clear();
   void verify_checksum(uint64_t) const;
 
   template <typename S>
-  boost::crc_32_type update_checksum(const boost::crc_32_type, const S &) const;
+  void refresh_crc_bytes(const S &, crc_bytes_t &) const;
 
   depth_t m_book_depth;
   integer_t m_price_precision = 0;
@@ -52,49 +101,63 @@ private:
 
   bid_side_t m_bids;
   ask_side_t m_asks;
+  mutable crc_bytes_t m_bid_crc;
+  mutable crc_bytes_t m_ask_crc;
+
+  bool m_verify = false;
 };
 
 template <typename S>
-boost::crc_32_type sides_t::update_checksum(boost::crc_32_type crc32,
-                                            const S &side) const {
-  static constexpr size_t c_crc32_depth = 10;
-  auto &result = crc32;
+void sides_t::refresh_crc_bytes(const S &side, crc_bytes_t &crc) const {
+  if (!crc.stale) {
+    return;
+  }
+  crc.bytes.clear();
+  decimal_t::chars_t buffer;
   auto depth = size_t{0};
-  for (const auto &kv : side) {
+  for (const auto &[price, qty] : side) {
     if (++depth > c_crc32_depth) {
       break;
     }
-    const auto &price = kv.first;
-    const auto &qty = kv.second;
-    price.process(crc32, price_precision());
-    qty.process(crc32, qty_precision());
+    crc.bytes.append(price.crc_chars(buffer, price_precision()));
+    crc.bytes.append(qty.crc_chars(buffer, qty_precision()));
   }
-  return result;
+  crc.stale = false;
 }
 
-template <typename Q, typename S>
-void sides_t::apply_update(const Q &quotes, S &side) {
-  static const std::string_view c_zero_str = "0";
-  static const decimal_t c_zero(c_zero_str);
-
-  for (const auto &quote : quotes) {
-    const auto &[price, qty] = quote;
-    auto it = side.find(price);
-    if (it != side.end()) {
-      if (qty == c_zero) {
-        side.erase(it);
-      } else {
-        it->second = qty;
-      }
+template <typename S>
+void sides_t::apply_level(const quote_t &quote, S &side, crc_bytes_t &crc) {
+  const auto &[price, qty] = quote;
+  // Only levels at or above the current last checksummed one can
+  // change what the checksum covers.
+  if (!crc.stale && (side.size() < c_crc32_depth ||
+                     !side.key_comp()(
+                         std::next(side.begin(), c_crc32_depth - 1)->first,
+                         price))) {
+    crc.stale = true;
+  }
+  auto it = side.find(price);
+  if (it != side.end()) {
+    if (qty == decimal_t{}) {
+      side.erase(it);
     } else {
-      side.insert(quote);
+      it->second = qty;
     }
+  } else {
+    side.insert(quote);
   }
+}
+
+template <typename S> void sides_t::truncate(S &side) {
+#if KDR_FLAT_SIDES
+  side.truncate(static_cast<size_t>(m_book_depth));
+#else
   if (side.size() > static_cast<size_t>(m_book_depth)) {
     auto it = side.begin();
     std::advance(it, m_book_depth);
     side.erase(it, side.end());
   }
+#endif
 }
 
 } // namespace model
@@ -2,39 +2,55 @@
 
 #include "book.hpp"
 #include "instrument.hpp"
+#include "metrics.hpp"
 #include "trades.hpp"
 
 #include <functional>
 
 namespace kdr {
 
+/**
+ * sink_t is where the engine delivers what it receives. Books arrive
+ * as a stream of levels (see response::book_stream_t) rather than as
+ * whole book_t objects. Sinks may add their own figures to the
+ * engine's periodic metrics.
+ */
 struct sink_t final {
   using accept_instrument_t =
       std::function<void(const response::instrument_t &)>;
-  using accept_book_t = std::function<void(const response::book_t &)>;
   using accept_trades_t = std::function<void(const response::trades_t &)>;
+  using report_metrics_t = std::function<void(metrics_t &)>;
 
   sink_t(const accept_instrument_t &accept_instrument,
-         const accept_book_t &accept_book, const accept_trades_t &accept_trades)
-      : m_accept_instrument{accept_instrument}, m_accept_book(accept_book),
-        m_accept_trades(accept_trades) {}
+         const response::book_stream_t &book_stream,
+         const accept_trades_t &accept_trades,
+         const report_metrics_t &report_metrics = [](metrics_t &) {})
+      : m_accept_instrument{accept_instrument}, m_book_stream(book_stream),
+        m_accept_trades(accept_trades), m_report_metrics(report_metrics) {}
 
   void accept(const response::instrument_t &response) const {
     m_accept_instrument(response);
   }
 
-  void accept(const response::book_t &response) const {
-    m_accept_book(response);
+  const response::book_stream_t &book_stream() const { return m_book_stream; }
+
+  /** For books we construct ourselves, e.g. gaps. */
+  void accept(const response::book_t &response,
+              const model::symbol_table_t &symbols) const {
+    response.stream(symbols, m_book_stream);
   }
 
   void accept(const response::trades_t &response) const {
     m_accept_trades(response);
   }
 
+  void report(metrics_t &metrics) const { m_report_metrics(metrics); }
+
 private:
   accept_instrument_t m_accept_instrument;
-  accept_book_t m_accept_book;
+  response::book_stream_t m_book_stream;
   accept_trades_t m_accept_trades;
+  report_metrics_t m_report_metrics;
 };
 
 } // namespace kdr
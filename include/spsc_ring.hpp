@@ -0,0 +1,91 @@
+#pragma once
+
+#include "constants.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <vector>
+
+namespace kdr {
+
+/**
+ * spsc_ring_t is a bounded, lock-free ring of preallocated slots for
+ * exactly one producer thread and one consumer thread.
+ *
+ * Slots are constructed once and then reused in place: the producer
+ * fills the slot returned by back() and publishes it with push(); the
+ * consumer reads the slot returned by front() and releases it with
+ * pop(). Any resources a slot acquires (e.g. buffer capacity) are
+ * therefore retained across trips around the ring.
+ */
+template <typename T> struct spsc_ring_t final {
+  /** Capacity is rounded up to the next power of two. */
+  explicit spsc_ring_t(size_t capacity)
+      : m_mask{std::bit_ceil(std::max(capacity, size_t{2})) - 1},
+        m_slots(m_mask + 1) {}
+
+  spsc_ring_t(const spsc_ring_t &) = delete;
+  spsc_ring_t &operator=(const spsc_ring_t &) = delete;
+
+  size_t capacity() const { return m_slots.size(); }
+
+  /** Approximate when called concurrently with push() or pop(). */
+  size_t size() const {
+    const auto head = m_head.load(std::memory_order_acquire);
+    const auto tail = m_tail.load(std::memory_order_acquire);
+    return std::min(tail - head, capacity());
+  }
+  bool empty() const { return size() == 0; }
+
+  /** Producer: the next free slot or nullptr if the ring is full. */
+  T *back() {
+    const auto tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_cached_head == capacity()) {
+      m_cached_head = m_head.load(std::memory_order_acquire);
+      if (tail - m_cached_head == capacity()) {
+        return nullptr;
+      }
+    }
+    return &m_slots[tail & m_mask];
+  }
+
+  /** Producer: publish the slot most recently returned by back(). */
+  void push() {
+    m_tail.store(m_tail.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_release);
+  }
+
+  /** Consumer: the oldest published slot or nullptr if none. */
+  T *front() {
+    const auto head = m_head.load(std::memory_order_relaxed);
+    if (head == m_cached_tail) {
+      m_cached_tail = m_tail.load(std::memory_order_acquire);
+      if (head == m_cached_tail) {
+        return nullptr;
+      }
+    }
+    return &m_slots[head & m_mask];
+  }
+
+  /** Consumer: release the slot most recently returned by front(). */
+  void pop() {
+    m_head.store(m_head.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_release);
+  }
+
+private:
+  const size_t m_mask;
+  std::vector<T> m_slots;
+
+  // Keep each side's index and its private cache of the other side's
+  // index on their own cache line to avoid false sharing.
+  alignas(c_expected_cacheline_size) std::atomic<size_t> m_head = 0;
+  size_t m_cached_tail = 0;
+
+  alignas(c_expected_cacheline_size) std::atomic<size_t> m_tail = 0;
+  size_t m_cached_head = 0;
+};
+
+} // namespace kdr
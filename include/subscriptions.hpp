@@ -0,0 +1,119 @@
+#pragma once
+
+#include "config.hpp"
+#include "types.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace kdr {
+
+/**
+ * subscription_scheduler_t paces book and trade subscriptions. It
+ * knows nothing of sockets or timers: the engine queues symbols,
+ * repeatedly asks next() for a batch to send, reports acks as they
+ * arrive and sleeps until wake_time().
+ *
+ * Symbols go out in batches of at most `subscribe_batch_size`, those
+ * listed in `priority_pairs` first and the book and trade channels
+ * taking turns. At most `subscribe_max_in_flight` batches await acks
+ * at once, so the venue's acks (one per symbol) release the next
+ * batch; a batch that is not fully acked within
+ * `subscribe_timeout_secs` stops holding up the rest. With a nonzero
+ * `subscribe_rate`, batches are further limited to that many per
+ * second.
+ *
+ * A cycle runs from the first symbol queued while idle until the last
+ * of them is acked (or timed out); its duration is the time to full
+ * capture.
+ */
+struct subscription_scheduler_t final {
+  using clock_t = std::chrono::steady_clock;
+  using time_point_t = clock_t::time_point;
+
+  enum class channel_t : uint8_t { book, trade };
+
+  struct batch_t final {
+    channel_t channel;
+    req_id_t req_id;
+    std::vector<std::string> symbols;
+  };
+
+  explicit subscription_scheduler_t(const config_t &);
+
+  void queue(channel_t, const std::vector<std::string> &symbols,
+             time_point_t now);
+
+  /** Forget everything queued or in flight, e.g. after a disconnect. */
+  void clear();
+
+  /**
+   * The next batch to send at `now` (tagged with `req_id`) or nullopt
+   * if none is due yet.
+   */
+  std::optional<batch_t> next(time_point_t now, req_id_t req_id);
+
+  /**
+   * When next() may next have something to offer, or nullopt if
+   * nothing is queued or in flight.
+   */
+  std::optional<time_point_t> wake_time() const;
+
+  /**
+   * Count an ack (success or error) for one symbol of the batch
+   * `req_id`. Unknown ids, e.g. those of instrument or resync
+   * requests, are ignored.
+   */
+  void ack(req_id_t req_id, time_point_t now);
+
+  bool idle() const { return pending_size() == 0 && m_in_flight.empty(); }
+
+  /** Duration of the most recently completed cycle. */
+  std::optional<clock_t::duration> last_cycle() const { return m_last_cycle; }
+
+  size_t num_timeouts() const { return m_num_timeouts; }
+
+private:
+  struct in_flight_t final {
+    size_t num_unacked;
+    time_point_t deadline;
+  };
+
+  using pending_t = std::deque<std::string>;
+
+  size_t pending_size() const {
+    return m_book_pending.size() + m_trade_pending.size();
+  }
+  /** Rank in `priority_pairs`, or its size for unlisted symbols. */
+  size_t rank(const std::string &symbol) const;
+  pending_t &pending(channel_t channel) {
+    return channel == channel_t::book ? m_book_pending : m_trade_pending;
+  }
+  void expire(time_point_t now);
+  void finish_cycle(time_point_t now);
+
+  const size_t m_batch_size;
+  const size_t m_max_in_flight;
+  const clock_t::duration m_min_interval;
+  const clock_t::duration m_timeout;
+  std::unordered_map<std::string, size_t> m_ranks;
+
+  pending_t m_book_pending;
+  pending_t m_trade_pending;
+  channel_t m_next_channel = channel_t::book;
+
+  std::map<req_id_t, in_flight_t> m_in_flight;
+  std::optional<time_point_t> m_last_sent;
+  std::optional<time_point_t> m_cycle_begin;
+  std::optional<clock_t::duration> m_last_cycle;
+  size_t m_num_timeouts = 0;
+};
+
+} // namespace kdr
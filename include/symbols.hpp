@@ -0,0 +1,55 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <deque>
+#include <functional>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace kdr {
+namespace model {
+
+/**
+ * symbol_table_t interns pair symbols as they arrive in instrument
+ * responses, numbering them densely from zero in order of first
+ * appearance. Ids never change, so anything kept per symbol can live
+ * in a vector indexed by id and a symbol is hashed once, when its
+ * message is parsed, rather than by every consumer.
+ *
+ * Shards share one table: intern() may run concurrently with lookups.
+ */
+struct symbol_table_t final {
+  /** The id of `symbol`, assigning the next one if it is new. */
+  symbol_id_t intern(std::string_view symbol);
+
+  std::optional<symbol_id_t> find(std::string_view symbol) const;
+
+  /** As find() but throws std::runtime_error for unknown symbols. */
+  symbol_id_t id(std::string_view symbol) const;
+
+  /** The reference remains valid for the table's lifetime. */
+  const std::string &symbol(symbol_id_t id) const;
+
+  size_t size() const;
+
+private:
+  struct hash_t final {
+    using is_transparent = void;
+    size_t operator()(std::string_view symbol) const {
+      return std::hash<std::string_view>{}(symbol);
+    }
+  };
+
+  mutable std::shared_mutex m_mutex;
+  // A deque so that the views keyed in m_ids stay put as it grows.
+  std::deque<std::string> m_symbols;
+  std::unordered_map<std::string_view, symbol_id_t, hash_t, std::equal_to<>>
+      m_ids;
+};
+
+} // namespace model
+} // namespace kdr
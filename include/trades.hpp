@@ -17,7 +17,16 @@ struct trades_t final {
 
   const header_t &header() const { return m_header; }
 
-  static trades_t from_json(simdjson::ondemand::document &);
+  /** recv_tm is the time at which the message was read off the wire. */
+  static trades_t from_json(simdjson::ondemand::document &,
+                            timestamp_t recv_tm = timestamp_t::now());
+  /**
+   * Refill `result` in place. Its storage is reused, so a trades_t
+   * kept across messages stops allocating once it has held the
+   * largest batch.
+   */
+  static void from_json(simdjson::ondemand::document &, timestamp_t recv_tm,
+                        trades_t &result);
 
   boost::json::object to_json_obj(integer_t price_precision,
                                   integer_t qty_precision) const;
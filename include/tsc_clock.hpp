@@ -0,0 +1,47 @@
+#pragma once
+
+#include "timestamp.hpp"
+
+#include <cstdint>
+
+namespace kdr {
+
+/**
+ * tsc_clock_t reads wall-clock time off the CPU's timestamp counter:
+ * a few cycles per read rather than a clock_gettime() call. Where
+ * the CPU has no invariant TSC (or isn't x86-64) it falls back to
+ * CLOCK_REALTIME.
+ *
+ * Readings are extrapolated from an anchor pair of (TSC,
+ * CLOCK_REALTIME) samples at a rate calibrated when the clock is
+ * made. Every so often (at most c_resync_nanos) the clock takes a
+ * fresh anchor and refines the rate from the interval since the last,
+ * so it follows NTP adjustments. now_nanos() does not go backwards unless the
+ * system clock is stepped back.
+ *
+ * Instances are not thread-safe; give each reading thread its own.
+ */
+struct tsc_clock_t final {
+  static constexpr int64_t c_resync_nanos = 1'000'000'000;
+
+  tsc_clock_t();
+
+  /** Nanoseconds since the epoch. */
+  int64_t now_nanos();
+  timestamp_t now() { return timestamp_t{now_nanos() / 1000}; }
+
+  /** Whether readings come from the TSC rather than the fallback. */
+  static bool have_tsc();
+
+private:
+  void anchor();
+
+  uint64_t m_anchor_tsc = 0;
+  int64_t m_anchor_nanos = 0;
+  double m_nanos_per_tick = 0;
+  int64_t m_resync_nanos = 0;
+  uint64_t m_resync_ticks = 0;
+  int64_t m_last_nanos = 0;
+};
+
+} // namespace kdr
@@ -3,6 +3,8 @@
 #include "decimal.hpp"
 #include "timestamp.hpp" // !@# TODO: remove this and include timestamp only where it is required
 
+#include <simdjson.h>
+
 #include <cstdint>
 #include <string_view>
 
@@ -20,10 +22,19 @@ namespace kdr {
 
 using msg_t = std::string_view;
 
+/**
+ * A received message whose underlying buffer carries at least
+ * simdjson::SIMDJSON_PADDING readable bytes past its end so that it
+ * may be handed to the parser without being copied.
+ */
+using padded_msg_t = simdjson::padded_string_view;
+
 using integer_t = int64_t;
 using double_t = double;
 
 using req_id_t = int64_t;
+/** Dense index of a pair symbol (see model::symbol_table_t). */
+using symbol_id_t = uint32_t;
 using price_t = decimal_t;
 using qty_t = decimal_t;
 using quote_t = std::pair<price_t, qty_t>;
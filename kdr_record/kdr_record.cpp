@@ -1,10 +1,12 @@
 #include "assets_sink.hpp"
+#include "async_writer.hpp"
 #include "book_sink.hpp"
 #include "config.hpp"
 #include "depth.hpp"
 #include "engine.hpp"
 #include "level_book.hpp"
 #include "pairs_sink.hpp"
+#include "shard.hpp"
 #include "shmem_sink.hpp"
 #include "sink.hpp"
 #include "trade_sink.hpp"
@@ -16,13 +18,20 @@
 #include <boost/log/expressions.hpp>
 #include <boost/log/trivial.hpp>
 #include <boost/program_options.hpp>
+#include <simdjson.h>
 
+#include <algorithm>
+#include <atomic>
 #include <csignal>
+#include <memory>
+#include <optional>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace po = boost::program_options;
 
-bool shutting_down = false;
+std::atomic<bool> shutting_down = false;
 
 void signal_handler(const boost::system::error_code &ec, int signal_number) {
   BOOST_LOG_TRIVIAL(error) << "received signal_number: " << signal_number
@@ -32,7 +41,7 @@ void signal_handler(const boost::system::error_code &ec, int signal_number) {
 
 using shmem_accept_instrument_t =
     std::function<void(const kdr::response::instrument_t &)>;
-using shmem_accept_book_t = std::function<void(const kdr::response::book_t &)>;
+using shmem_accept_book_t = std::function<void(kdr::symbol_id_t symbol)>;
 using shmem_accept_trades_t =
     std::function<void(const kdr::response::trades_t &)>;
 
@@ -60,14 +69,12 @@ make_shmem_accept_instrument(bool enable_shmem,
 shmem_accept_book_t
 make_shmem_accept_book(bool enable_shmem, kdr::shmem::shmem_sink_t &shmem_sink,
                        kdr::model::level_book_t &level_book) {
-  const shmem_accept_book_t noop_shmem_accept_book{
-      [](const kdr::response::book_t &) {}};
+  const shmem_accept_book_t noop_shmem_accept_book{[](kdr::symbol_id_t) {}};
   const shmem_accept_book_t result{
-      enable_shmem
-          ? [&shmem_sink, &level_book](
-                const kdr::response::book_t
-                    &response) { shmem_sink.accept(response, level_book); }
-          : noop_shmem_accept_book};
+      enable_shmem ? [&shmem_sink, &level_book](kdr::symbol_id_t symbol) {
+        shmem_sink.accept_book(symbol, level_book);
+      }
+                   : noop_shmem_accept_book};
   return result;
 }
 
@@ -88,6 +95,67 @@ make_shmem_accept_trades(bool enable_shmem,
   return result;
 }
 
+/**
+ * Per-shard state. Only the shard's own thread touches these sinks
+ * and its level book; the shard's async writer has a thread of its own
+ * which writes the sinks' finished batches. With a single shard,
+ * filenames are unchanged.
+ */
+struct shard_t final {
+  shard_t(const kdr::config_t &config, kdr::pq::sink_id_t id,
+          kdr::shard_id_t shard_id, kdr::model::symbol_table_t &symbols)
+      : async_writer{config.writer_queue_size()},
+        book_sink{config.parquet_dir(), id, config.book_depth(),
+                  config.price_format(), async_writer, rotation(config),
+                  partitioning(config), properties(config),
+                  file_shard(config, shard_id)},
+        trades_sink{config.parquet_dir(), id, config.price_format(),
+                    async_writer, rotation(config), partitioning(config),
+                    properties(config), file_shard(config, shard_id)},
+        level_book{config.book_depth(), symbols} {}
+
+  static std::optional<size_t> file_shard(const kdr::config_t &config,
+                                          kdr::shard_id_t shard_id) {
+    return config.num_shards() > 1 ? std::make_optional(shard_id)
+                                   : std::nullopt;
+  }
+
+  static kdr::pq::rotation_t rotation(const kdr::config_t &config) {
+    constexpr int64_t c_micros_per_sec = 1'000'000;
+    constexpr int64_t c_bytes_per_mb = 1024 * 1024;
+    return {int64_t(config.rotate_interval_secs()) * c_micros_per_sec,
+            int64_t(config.rotate_size_mb()) * c_bytes_per_mb};
+  }
+
+  // Every shard's sinks hold files in this one process, so they share
+  // the limit.
+  static kdr::pq::partitioning_t partitioning(const kdr::config_t &config) {
+    const auto max_open = config.max_open_partitions();
+    return {config.partition_by_symbol(),
+            max_open == 0 ? 0
+                          : std::max(max_open / config.num_shards(), size_t{1})};
+  }
+
+  static kdr::pq::writer_properties_t
+  properties(const kdr::config_t &config) {
+    return {config.parquet_compression(),
+            config.parquet_column_compression(),
+            config.parquet_dictionary(),
+            config.parquet_delta_encoding(),
+            config.parquet_byte_stream_split(),
+            int64_t(config.parquet_row_group_size()),
+            int64_t(config.parquet_data_page_size())};
+  }
+
+  kdr::pq::async_writer_t async_writer;
+  kdr::pq::book_sink_t book_sink;
+  kdr::pq::trades_sink_t trades_sink;
+  kdr::model::level_book_t level_book;
+  /** Id of the book being streamed, looked up once per message. */
+  kdr::symbol_id_t book_symbol = 0;
+  std::unique_ptr<kdr::engine_t> engine;
+};
+
 int main(int argc, char *argv[]) {
 
   // !@# TODO: add program option to engage debug level...
@@ -101,6 +169,9 @@ int main(int argc, char *argv[]) {
   using kdr::config_t;
 
   std::vector<std::string> pairs_filter_vector;
+  std::vector<int> cpu_affinity_vector;
+  std::vector<std::string> priority_pairs_vector;
+  std::vector<std::string> column_compression_vector;
 
   // clang-format off
     desc.add_options()
@@ -115,6 +186,40 @@ int main(int argc, char *argv[]) {
       (config_t::c_capture_book.data(), po::value<bool>()->default_value(true), "subscribe to and record level book")
       (config_t::c_capture_trades.data(), po::value<bool>()->default_value(true), "subscribe to and record trades")
       (config_t::c_enable_shmem.data(), po::value<bool>()->default_value(false), "enable shared memory sink")
+      (config_t::c_io_thread.data(), po::value<bool>()->default_value(false), "read the websocket on a dedicated thread")
+      (config_t::c_reconnect.data(), po::value<bool>()->default_value(true), "reconnect and resubscribe after network errors")
+      (config_t::c_num_shards.data(), po::value<size_t>()->default_value(1), "number of websocket connections across which to split pairs")
+      (config_t::c_cpu_affinity.data(), po::value<std::vector<int>>(&cpu_affinity_vector)->multitoken(),
+       "cpus to which shard threads are pinned (round robin) or empty for none")
+      (config_t::c_subscribe_batch_size.data(), po::value<size_t>()->default_value(128), "pairs per subscribe request")
+      (config_t::c_subscribe_max_in_flight.data(), po::value<size_t>()->default_value(8), "subscribe requests awaiting acks at once")
+      (config_t::c_subscribe_rate.data(), po::value<size_t>()->default_value(0), "subscribe requests per second or 0 for no limit")
+      (config_t::c_subscribe_timeout_secs.data(), po::value<size_t>()->default_value(10), "how long to wait for a request's acks")
+      (config_t::c_priority_pairs.data(), po::value<std::vector<std::string>>(&priority_pairs_vector)->multitoken(),
+       "pairs to subscribe to ahead of all others, in order")
+      (config_t::c_price_format.data(), po::value<std::string>()->default_value("string"),
+       "write prices and quantities as one of {string, decimal128, int64}")
+      (config_t::c_writer_queue_size.data(), po::value<size_t>()->default_value(8),
+       "parquet batches that may await the writer thread or 0 to write inline")
+      (config_t::c_rotate_interval_secs.data(), po::value<size_t>()->default_value(0),
+       "start new book/trades files on multiples of this many seconds or 0 for never")
+      (config_t::c_rotate_size_mb.data(), po::value<size_t>()->default_value(0),
+       "start new book/trades files at this many MB or 0 for never")
+      (config_t::c_partition_by_symbol.data(), po::value<bool>()->default_value(false),
+       "write book/trades files under symbol=<pair>/date=<day> directories")
+      (config_t::c_max_open_partitions.data(), po::value<size_t>()->default_value(128),
+       "book/trades partition files each sink keeps open at once across shards or 0 for one per pair")
+      (config_t::c_parquet_compression.data(), po::value<std::string>()->default_value("snappy"),
+       "book/trades codec, one of {none, snappy, lz4, zstd, gzip, brotli} with optional :level")
+      (config_t::c_parquet_column_compression.data(), po::value<std::vector<std::string>>(&column_compression_vector)->multitoken(),
+       "per-column codecs as <column path>=<codec>, e.g. bids.list.element.qty=zstd:9")
+      (config_t::c_parquet_dictionary.data(), po::value<bool>()->default_value(true), "dictionary encode book/trades columns")
+      (config_t::c_parquet_delta_encoding.data(), po::value<bool>()->default_value(false),
+       "delta encode timestamps, checksums and trade ids")
+      (config_t::c_parquet_byte_stream_split.data(), po::value<bool>()->default_value(false),
+       "byte stream split int64 and decimal128 prices and quantities")
+      (config_t::c_parquet_row_group_size.data(), po::value<size_t>()->default_value(65536), "rows per book/trades row group")
+      (config_t::c_parquet_data_page_size.data(), po::value<size_t>()->default_value(1048576), "bytes per book/trades data page")
     ;
   // clang-format on
 
@@ -129,7 +234,7 @@ int main(int argc, char *argv[]) {
   const config_t::symbol_filter_t pair_filter{pairs_filter_vector.begin(),
                                               pairs_filter_vector.end()};
 
-  const auto config = config_t{
+  auto config = config_t{
       vm[config_t::c_ping_interval_secs.data()].as<size_t>(),
       vm[config_t::c_kraken_host.data()].as<std::string>(),
       vm[config_t::c_kraken_port.data()].as<std::string>(),
@@ -139,9 +244,50 @@ int main(int argc, char *argv[]) {
       vm[config_t::c_capture_book.data()].as<bool>(),
       vm[config_t::c_capture_trades.data()].as<bool>(),
       vm[config_t::c_enable_shmem.data()].as<bool>()};
+  config.set_io_thread(vm[config_t::c_io_thread.data()].as<bool>());
+  config.set_reconnect(vm[config_t::c_reconnect.data()].as<bool>());
+  config.set_num_shards(vm[config_t::c_num_shards.data()].as<size_t>());
+  config.set_cpu_affinity(cpu_affinity_vector);
+  config.set_subscribe_batch_size(
+      vm[config_t::c_subscribe_batch_size.data()].as<size_t>());
+  config.set_subscribe_max_in_flight(
+      vm[config_t::c_subscribe_max_in_flight.data()].as<size_t>());
+  config.set_subscribe_rate(vm[config_t::c_subscribe_rate.data()].as<size_t>());
+  config.set_subscribe_timeout_secs(
+      vm[config_t::c_subscribe_timeout_secs.data()].as<size_t>());
+  config.set_priority_pairs(priority_pairs_vector);
+  config.set_price_format(kdr::model::str_view_to_price_format_t(
+      vm[config_t::c_price_format.data()].as<std::string>()));
+  config.set_writer_queue_size(
+      vm[config_t::c_writer_queue_size.data()].as<size_t>());
+  config.set_rotate_interval_secs(
+      vm[config_t::c_rotate_interval_secs.data()].as<size_t>());
+  config.set_rotate_size_mb(vm[config_t::c_rotate_size_mb.data()].as<size_t>());
+  config.set_partition_by_symbol(
+      vm[config_t::c_partition_by_symbol.data()].as<bool>());
+  config.set_max_open_partitions(
+      vm[config_t::c_max_open_partitions.data()].as<size_t>());
+  config.set_parquet_compression(
+      vm[config_t::c_parquet_compression.data()].as<std::string>());
+  config.set_parquet_column_compression(column_compression_vector);
+  config.set_parquet_dictionary(
+      vm[config_t::c_parquet_dictionary.data()].as<bool>());
+  config.set_parquet_delta_encoding(
+      vm[config_t::c_parquet_delta_encoding.data()].as<bool>());
+  config.set_parquet_byte_stream_split(
+      vm[config_t::c_parquet_byte_stream_split.data()].as<bool>());
+  config.set_parquet_row_group_size(
+      vm[config_t::c_parquet_row_group_size.data()].as<size_t>());
+  config.set_parquet_data_page_size(
+      vm[config_t::c_parquet_data_page_size.data()].as<size_t>());
 
   BOOST_LOG_TRIVIAL(info) << kdr::c_license;
   BOOST_LOG_TRIVIAL(info) << "starting up with config: " << config.str();
+  BOOST_LOG_TRIVIAL(info)
+      << "simdjson builtin implementation: "
+      << simdjson::builtin_implementation()->name()
+      << " active implementation: "
+      << simdjson::get_active_implementation()->name();
 
   boost::asio::ssl::context ctx{boost::asio::ssl::context::tlsv13_client};
   ctx.set_options(boost::asio::ssl::context::default_workarounds |
@@ -152,85 +298,173 @@ int main(int argc, char *argv[]) {
 
   const auto now = kdr::timestamp_t::now().micros();
 
+  // Refdata and its sinks are shared by all shards but only ever
+  // updated by the leader (shard 0).
   kdr::pq::assets_sink_t assets_sink{config.parquet_dir(), now};
   kdr::pq::pairs_sink_t pairs_sink{config.parquet_dir(), now};
-  kdr::pq::book_sink_t book_sink{config.parquet_dir(), now,
-                                 config.book_depth()};
-  kdr::pq::trades_sink_t trades_sink{config.parquet_dir(), now};
-
-  kdr::model::level_book_t level_book{config.book_depth()};
   kdr::model::refdata_t refdata;
 
-  kdr::shmem::shmem_sink_t shmem_sink;
+  kdr::shmem::shmem_sink_t shmem_sink{refdata.symbols()};
 
   const shmem_accept_instrument_t shmem_accept_instrument{
       make_shmem_accept_instrument(config.enable_shmem(), shmem_sink)};
 
-  const shmem_accept_book_t shmem_accept_book{
-      make_shmem_accept_book(config.enable_shmem(), shmem_sink, level_book)};
-
   const shmem_accept_trades_t shmem_accept_trades{
       make_shmem_accept_trades(config.enable_shmem(), shmem_sink)};
 
-  const auto accept_instrument =
-      [&level_book, &assets_sink, &pairs_sink, &refdata,
-       shmem_accept_instrument](const kdr::response::instrument_t &response) {
-        assets_sink.accept(response.header(), response.assets());
-        pairs_sink.accept(response.header(), response.pairs());
-        refdata.accept(response);
-        for (const auto &pair : response.pairs()) {
-          level_book.accept(pair);
-          BOOST_LOG_TRIVIAL(debug)
-              << "created/updated book for symbol: " << pair.symbol();
-        }
-        shmem_accept_instrument(response);
-      };
-
-  const auto noop_accept_book = [](const kdr::response::book_t &) {};
-  const auto accept_book =
-      [&book_sink, &level_book, &refdata,
-       shmem_accept_book](const kdr::response::book_t &response) {
-        book_sink.accept(response, refdata);
-        level_book.accept(response);
-        shmem_accept_book(response);
-      };
-
-  const auto noop_accept_trades = [](const kdr::response::trades_t &) {};
-  const auto accept_trades = [&trades_sink, &refdata, shmem_accept_trades](
-                                 const kdr::response::trades_t &response) {
-    trades_sink.accept(response, refdata);
-    shmem_accept_trades(response);
-  };
+  std::vector<std::unique_ptr<shard_t>> shards;
+  for (kdr::shard_id_t shard_id = 0; shard_id < config.num_shards();
+       ++shard_id) {
+    auto &shard =
+        *shards.emplace_back(std::make_unique<shard_t>(config, now, shard_id,
+                                                       refdata.symbols()));
+    const bool leader = shard_id == 0;
+
+    const auto accept_instrument =
+        [leader, &level_book = shard.level_book, &assets_sink, &pairs_sink,
+         &refdata,
+         shmem_accept_instrument](const kdr::response::instrument_t &response) {
+          if (leader) {
+            assets_sink.accept(response.header(), response.assets());
+            pairs_sink.accept(response.header(), response.pairs());
+            refdata.accept(response);
+          }
+          for (const auto &pair : response.pairs()) {
+            level_book.accept(pair);
+            BOOST_LOG_TRIVIAL(debug)
+                << "created/updated book for symbol: " << pair.symbol();
+          }
+          if (leader) {
+            shmem_accept_instrument(response);
+          }
+        };
+
+    const shmem_accept_book_t shmem_accept_book{make_shmem_accept_book(
+        config.enable_shmem(), shmem_sink, shard.level_book)};
+
+    // Levels go straight from the parser into the level book and are
+    // staged for the parquet row, which end() writes only once the level
+    // book has verified the checksum: a book which fails it is aborted,
+    // so it is not recorded, and the engine resyncs that symbol.
+    const kdr::response::book_stream_t noop_book_stream{
+        [](const kdr::response::header_t &, kdr::symbol_id_t,
+           const std::string &) { return false; },
+        [](const kdr::bid_t &) {}, [](const kdr::ask_t &) {},
+        [](const std::string &, uint64_t, kdr::timestamp_t) {}};
+    const kdr::response::book_stream_t book_stream{
+        [&shard](const kdr::response::header_t &header, kdr::symbol_id_t id,
+                 const std::string &symbol) {
+          // The level book's sides carry the pair's precisions, so the
+          // parquet row needs no refdata lookup.
+          const auto &sides = shard.level_book.sides(id);
+          shard.book_symbol = id;
+          shard.level_book.begin(header, id);
+          shard.book_sink.begin(header, symbol, sides.price_precision(),
+                                sides.qty_precision());
+          return true;
+        },
+        [&book_sink = shard.book_sink,
+         &level_book = shard.level_book](const kdr::bid_t &bid) {
+          level_book.accept_bid(bid);
+          book_sink.accept_bid(bid);
+        },
+        [&book_sink = shard.book_sink,
+         &level_book = shard.level_book](const kdr::ask_t &ask) {
+          level_book.accept_ask(ask);
+          book_sink.accept_ask(ask);
+        },
+        [&shard, shmem_accept_book](const std::string &, uint64_t crc32,
+                                    kdr::timestamp_t timestamp) {
+          shard.level_book.end(crc32);
+          shard.book_sink.end(crc32, timestamp);
+          shmem_accept_book(shard.book_symbol);
+        },
+        [&book_sink = shard.book_sink] { book_sink.abort(); }};
+
+    const auto noop_accept_trades = [](const kdr::response::trades_t &) {};
+    const auto accept_trades = [&trades_sink = shard.trades_sink, &refdata,
+                                shmem_accept_trades](
+                                   const kdr::response::trades_t &response) {
+      trades_sink.accept(response, refdata);
+      shmem_accept_trades(response);
+    };
+
+    const auto report_metrics = [&async_writer = shard.async_writer,
+                                 &book_sink = shard.book_sink,
+                                 &trades_sink = shard.trades_sink](
+                                    kdr::metrics_t &metrics) {
+      metrics.set_writer_queue_depth(async_writer.queue_depth());
+      metrics.set_writer_waits(async_writer.num_waits(),
+                               async_writer.wait_micros());
+      metrics.set_write_micros(async_writer.write_micros(),
+                               async_writer.max_write_micros());
+      metrics.set_writer_errors(async_writer.num_errors());
+      metrics.set_partition_evictions(book_sink.num_evictions() +
+                                      trades_sink.num_evictions());
+    };
+
+    const kdr::sink_t sink{
+        accept_instrument,
+        config.capture_book() ? book_stream : noop_book_stream,
+        config.capture_trades()
+            ? kdr::sink_t::accept_trades_t{accept_trades}
+            : kdr::sink_t::accept_trades_t{noop_accept_trades},
+        report_metrics};
+
+    shard.engine = std::make_unique<kdr::engine_t>(
+        ctx, config, refdata.symbols(), sink, shard_id);
+  }
 
-  const kdr::sink_t sink{
-      accept_instrument,
-      config.capture_book() ? kdr::sink_t::accept_book_t{accept_book}
-                            : kdr::sink_t::accept_book_t{noop_accept_book},
-      config.capture_trades()
-          ? kdr::sink_t::accept_trades_t{accept_trades}
-          : kdr::sink_t::accept_trades_t{noop_accept_trades}};
-
-  auto engine = kdr::engine_t(ctx, config, sink);
-  const auto handle_recv = [&engine](kdr::msg_t msg) {
-    try {
-      return engine.handle_msg(msg);
-    } catch (const std::exception &ex) {
-      BOOST_LOG_TRIVIAL(error) << "handle_recv: " << ex.what();
-      return false;
-    }
-  };
+  auto &leader = *shards.front()->engine;
+  for (size_t idx = 1; idx < shards.size(); ++idx) {
+    leader.add_follower(*shards[idx]->engine);
+  }
 
-  auto &ioc = engine.session().ioc();
+  auto &ioc = leader.session().ioc();
   boost::asio::signal_set signals(ioc, SIGINT);
   signals.async_wait(signal_handler);
 
-  engine.start_processing(handle_recv);
+  for (auto &shard : shards) {
+    auto &engine = *shard->engine;
+    const auto handle_recv = [&engine](kdr::padded_msg_t msg,
+                                       kdr::timestamp_t recv_tm) {
+      try {
+        return engine.handle_msg(msg, recv_tm);
+      } catch (const std::exception &ex) {
+        BOOST_LOG_TRIVIAL(error) << "handle_recv: " << ex.what();
+        return false;
+      }
+    };
+    engine.start_processing(handle_recv);
+  }
+
+  const auto run_shard = [&config, &shards](kdr::shard_id_t shard_id) {
+    const auto &cpus = config.cpu_affinity();
+    if (!cpus.empty()) {
+      kdr::pin_current_thread(cpus[shard_id % cpus.size()]);
+    }
+    shards[shard_id]->engine->run(shutting_down);
+
+    // If any shard stops, stop them all.
+    shutting_down = true;
+    for (auto &shard : shards) {
+      shard->engine->session().ioc().stop();
+    }
+  };
 
-  while (!shutting_down && engine.keep_processing()) {
-    ioc.run_one();
+  std::vector<std::thread> threads;
+  for (kdr::shard_id_t shard_id = 1; shard_id < shards.size(); ++shard_id) {
+    threads.emplace_back(run_shard, shard_id);
   }
+  run_shard(0);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
   BOOST_LOG_TRIVIAL(info) << "session.stop_processing()";
-  engine.stop_processing();
+  for (auto &shard : shards) {
+    shard->engine->stop_processing();
+  }
 
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "io.hpp"
+#include "partitioned_writer.hpp"
+
+#include <arrow/api.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <variant>
+#include <vector>
+
+namespace kdr {
+namespace pq {
+
+/**
+ * async_writer_t takes finished record batches from the sinks and
+ * writes them, compression and file I/O included, on a thread of its
+ * own so that a flush no longer stalls the engine thread.
+ *
+ * A sink hands over a batch by finishing its builders, which passes
+ * their buffers to the batch and leaves the builders empty and ready
+ * for the next rows. Batches are written in the order queued. Once
+ * `max_queued` batches are waiting, write() blocks until the writer
+ * thread catches up, and that backpressure is counted.
+ *
+ * With `max_queued` of zero there is no thread and write() writes
+ * inline, as the sinks used to.
+ *
+ * A batch that fails to write on the writer thread is counted and
+ * lost, and the first such error is rethrown by the next write() (once
+ * its own batch is queued) or drain(), so that it reaches the sinks
+ * rather than only the log.
+ *
+ * Writers add()ed to it are also given close_if_due() every `tick`,
+ * from the writer thread between batches (or from write() with no
+ * thread), so that a file whose rotation interval has passed is
+ * finished even when no more batches come for it.
+ *
+ * Any number of sinks may share one async_writer_t, but each
+ * writer_t or partitioned_writer_t must outlive its queued batches:
+ * call drain(), and remove() it if added, before destroying one.
+ */
+struct async_writer_t final {
+  explicit async_writer_t(
+      size_t max_queued,
+      std::chrono::milliseconds tick = std::chrono::seconds{1});
+  ~async_writer_t();
+
+  async_writer_t(const async_writer_t&) = delete;
+  async_writer_t& operator=(const async_writer_t&) = delete;
+
+  /** Queue a batch of rows from `micros` on; see writer_t::write(). */
+  void write(writer_t&, std::shared_ptr<arrow::RecordBatch>, int64_t micros);
+  void write(partitioned_writer_t&,
+             std::shared_ptr<arrow::RecordBatch>,
+             int64_t micros);
+
+  void add(writer_t&);
+  void add(partitioned_writer_t&);
+  /** Stop ticking a writer, waiting out a tick in progress. */
+  void remove(writer_t&);
+  void remove(partitioned_writer_t&);
+
+  /**
+   * Block until every batch queued so far has been written, then
+   * rethrow any error not yet reported.
+   */
+  void drain();
+
+  size_t queue_depth() const;
+  /** Times write() had to wait for room, and for how long in all. */
+  size_t num_waits() const { return m_num_waits.load(); }
+  size_t wait_micros() const { return m_wait_micros.load(); }
+  /** How long writing a batch took, most recently and at worst. */
+  size_t write_micros() const { return m_write_micros.load(); }
+  size_t max_write_micros() const { return m_max_write_micros.load(); }
+  /** Batches, or files closed by a tick, that failed to write. */
+  size_t num_errors() const { return m_num_errors.load(); }
+
+ private:
+  using target_t = std::variant<writer_t*, partitioned_writer_t*>;
+
+  struct job_t final {
+    target_t writer;
+    std::shared_ptr<arrow::RecordBatch> batch;
+    int64_t micros;
+  };
+
+  void enqueue(job_t);
+  void run();
+  void write_now(const job_t&);
+  void remove(target_t);
+  /** Call with `lock` held; releases it while closing files. */
+  void tick_if_due(std::unique_lock<std::mutex>& lock);
+  /** Call with m_mutex held. */
+  void rethrow_error();
+
+  const size_t m_max_queued;
+  const std::chrono::milliseconds m_tick;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_queued_cv;
+  std::condition_variable m_written_cv;
+  std::deque<job_t> m_queue;
+  size_t m_num_writing = 0;
+  bool m_stopping = false;
+  std::vector<target_t> m_targets;
+  std::chrono::steady_clock::time_point m_next_tick;
+  bool m_ticking = false;
+  // The first error on the writer thread since the last one rethrown.
+  std::exception_ptr m_error;
+
+  std::atomic<size_t> m_num_waits = 0;
+  std::atomic<size_t> m_wait_micros = 0;
+  std::atomic<size_t> m_write_micros = 0;
+  std::atomic<size_t> m_max_write_micros = 0;
+  std::atomic<size_t> m_num_errors = 0;
+
+  std::thread m_thread;
+};
+
+}  // namespace pq
+}  // namespace kdr
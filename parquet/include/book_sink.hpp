@@ -1,6 +1,9 @@
 #pragma once
 
+#include "async_writer.hpp"
+#include "decimal_column.hpp"
 #include "io.hpp"
+#include "partitioned_writer.hpp"
 
 #include <asset.hpp>
 #include <book.hpp>
@@ -9,7 +12,9 @@
 #include <arrow/api.h>
 
 #include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 namespace kdr {
 namespace pq {
@@ -17,41 +22,104 @@ namespace pq {
 struct book_sink_t final {
   static constexpr char c_sink_name[] = "book";
 
-  book_sink_t(std::string parquet_dir, sink_id_t, integer_t book_depth);
+  book_sink_t(std::string parquet_dir,
+              sink_id_t,
+              integer_t book_depth,
+              model::price_format_t price_format,
+              async_writer_t& async_writer,
+              rotation_t rotation,
+              partitioning_t partitioning,
+              const writer_properties_t& properties,
+              std::optional<size_t> shard = {});
   ~book_sink_t();
 
   void accept(const response::book_t&, const model::refdata_t&);
 
+  /**
+   * Streaming counterpart of accept() (see response::book_stream_t).
+   * Levels are staged and end() appends the whole row to the column
+   * builders, so that abort() can drop a message which fails part way
+   * and the builders only ever hold complete rows.
+   *
+   * The caller passes the pair's precisions, which it has to hand
+   * (e.g. from the level book), rather than have every message look
+   * them up in the shared refdata.
+   */
+  void begin(const response::header_t&,
+             const std::string& symbol,
+             integer_t price_precision,
+             integer_t qty_precision);
+  void accept_bid(const bid_t&);
+  void accept_ask(const ask_t&);
+  void end(uint64_t crc32, timestamp_t timestamp);
+  void abort();
+
+  /** See partitioned_writer_t; zero unless partitioned. */
+  size_t num_evictions() const {
+    return m_partitioned_writer ? m_partitioned_writer->num_evictions() : 0;
+  }
+
  private:
   static constexpr size_t c_flush_threshold = 4096;
 
-  static std::shared_ptr<arrow::DataType> quote_struct();
-  static std::shared_ptr<arrow::Schema> schema(integer_t book_depth);
+  static std::shared_ptr<arrow::DataType> quote_struct(model::price_format_t);
+  static std::shared_ptr<arrow::Schema> schema(integer_t book_depth,
+                                               model::price_format_t);
 
+  /**
+   * Flush first if a row received at `recv_tm` belongs in a later file
+   * than the rows batched so far, so that each batch is written to the
+   * interval (and date) its rows were received in.
+   */
+  void next_row(int64_t recv_tm);
   void flush();
 
+  model::price_format_t m_price_format;
   std::shared_ptr<arrow::Schema> m_schema;
-  std::string m_sink_filename;
-  writer_t m_writer;
+  // Exactly one of these, as partitioning_t::by_symbol says.
+  std::optional<writer_t> m_writer;
+  std::optional<partitioned_writer_t> m_partitioned_writer;
+  async_writer_t& m_async_writer;
+  rotation_t m_rotation;
 
   size_t m_num_rows = 0;
+  // The first row's recv_tm and the next rotation after it.
+  int64_t m_batch_micros = 0;
+  int64_t m_batch_ends_micros = 0;
+
+  // The book being streamed, between begin() and end(). The level
+  // vectors keep their capacity from one message to the next.
+  struct row_t final {
+    int64_t recv_tm = 0;
+    model::msg_type_t type = model::msg_type_invalid;
+    std::string symbol;
+    integer_t price_precision = 0;
+    integer_t qty_precision = 0;
+    std::vector<quote_t> bids;
+    std::vector<quote_t> asks;
+  };
+  row_t m_row;
 
   std::shared_ptr<arrow::Int64Builder> m_recv_tm_builder;
-  std::shared_ptr<arrow::StringBuilder> m_type_builder;
+  std::shared_ptr<arrow::Int8Builder> m_type_builder;
 
-  std::shared_ptr<arrow::StringBuilder> m_bid_price_builder;
-  std::shared_ptr<arrow::StringBuilder> m_bid_qty_builder;
+  decimal_column_t m_bid_price_column;
+  decimal_column_t m_bid_qty_column;
   std::shared_ptr<arrow::StructBuilder> m_bid_builder;
   std::shared_ptr<arrow::ListBuilder> m_bids_builder;
 
-  std::shared_ptr<arrow::StringBuilder> m_ask_price_builder;
-  std::shared_ptr<arrow::StringBuilder> m_ask_qty_builder;
+  decimal_column_t m_ask_price_column;
+  decimal_column_t m_ask_qty_column;
   std::shared_ptr<arrow::StructBuilder> m_ask_builder;
   std::shared_ptr<arrow::ListBuilder> m_asks_builder;
 
   std::shared_ptr<arrow::UInt64Builder> m_crc32_builder;
   std::shared_ptr<arrow::StringBuilder> m_symbol_builder;
   std::shared_ptr<arrow::Int64Builder> m_timestamp_builder;
+
+  // Only written with price_format_int64, where they give the scale.
+  std::shared_ptr<arrow::Int8Builder> m_price_precision_builder;
+  std::shared_ptr<arrow::Int8Builder> m_qty_precision_builder;
 };
 
 }  // namespace pq
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <decimal.hpp>
+#include <price_format.hpp>
+
+#include <arrow/api.h>
+
+#include <memory>
+
+namespace kdr {
+namespace pq {
+
+/**
+ * decimal_column_t builds a price or qty column in one of the formats
+ * config_t::price_format() offers:
+ *
+ * - string: utf8 at the pair's precision, e.g. "65000.10000"
+ * - decimal128: decimal128(38, 18), which holds any decimal_t
+ * - int64: whole 10^-precision units at the pair's precision (see
+ *   decimal_t::units()); the sink writes the precisions alongside
+ *
+ * All three truncate values to the pair's precision, so that a file
+ * holds the same values whichever format it was written in.
+ *
+ * The numeric formats skip string formatting on the hot path, make
+ * for much smaller files and let readers filter without casts.
+ */
+struct decimal_column_t final {
+  static constexpr int32_t c_decimal128_precision = 38;
+  static constexpr int32_t c_decimal128_scale = decimal_t::c_max_scale;
+
+  explicit decimal_column_t(model::price_format_t);
+
+  static std::shared_ptr<arrow::DataType> type(model::price_format_t);
+
+  /**
+   * Record the format, and where to find the scale of the price and
+   * qty columns, in a sink's schema metadata.
+   */
+  static void append_metadata(model::price_format_t,
+                              arrow::KeyValueMetadata&);
+
+  /** Read back a value that was written at `precision`. */
+  static decimal_t value(const arrow::Array&,
+                         int64_t idx,
+                         integer_t precision);
+
+  std::shared_ptr<arrow::ArrayBuilder> builder() const { return m_builder; }
+
+  /** Throws if append() would, without appending. */
+  void check(const decimal_t& value, integer_t precision) const;
+  void append(const decimal_t& value, integer_t precision);
+  void finish(std::shared_ptr<arrow::Array>* out);
+
+ private:
+  model::price_format_t m_format;
+  std::shared_ptr<arrow::ArrayBuilder> m_builder;
+
+  // m_builder downcast once; only the one for m_format is set.
+  arrow::StringBuilder* m_string_builder = nullptr;
+  arrow::Decimal128Builder* m_decimal128_builder = nullptr;
+  arrow::Int64Builder* m_int64_builder = nullptr;
+};
+
+}  // namespace pq
+}  // namespace kdr
@@ -1,15 +1,27 @@
 #pragma once
 
 #include <constants.hpp>
+#include <timestamp.hpp>
 
 #include <arrow/io/file.h>
+#include <arrow/util/compression.h>
 #include <parquet/api/reader.h>
 #include <parquet/api/writer.h>
 #include <parquet/arrow/reader.h>
+#include <parquet/arrow/schema.h>
 #include <parquet/arrow/writer.h>
+#include <boost/log/trivial.hpp>
 
+#include <algorithm>
+#include <filesystem>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace kdr {
 namespace pq {
@@ -17,13 +29,19 @@ namespace pq {
 using sink_id_t = int64_t;
 
 /**
- * Utility for constructing a canonical parquet filename.
+ * Utility for constructing a canonical parquet filename. A sharded
+ * sink gets its shard number ahead of the sink name (e.g.
+ * "<id>.3.book.pq") so that globs like "*.book.pq" still match the
+ * output of every shard.
  */
 inline std::string parquet_filename(std::string parquet_dir,
                                     std::string sink_name,
-                                    sink_id_t id) {
+                                    sink_id_t id,
+                                    std::optional<size_t> shard = {}) {
   // !@# TODO: replace with std::filesystem constructs
-  return parquet_dir + "/" + std::to_string(id) + "." + sink_name + ".pq";
+  const auto shard_str = shard ? std::to_string(*shard) + "." : "";
+  return parquet_dir + "/" + std::to_string(id) + "." + shard_str +
+         sink_name + ".pq";
 }
 
 /**
@@ -50,19 +68,135 @@ struct reader_t final {
   std::shared_ptr<::arrow::RecordBatchReader> m_record_batch_reader;
 };
 
+/**
+ * When a writer_t moves on to a new file: at each multiple of
+ * `interval_micros` (e.g. on the hour) and once a file has reached
+ * `max_bytes`. Zero disables either.
+ */
+struct rotation_t final {
+  int64_t interval_micros = 0;
+  int64_t max_bytes = 0;
+
+  /** The first interval boundary after `micros`, if there are any. */
+  std::optional<int64_t> next_boundary(int64_t micros) const {
+    if (interval_micros <= 0) {
+      return std::nullopt;
+    }
+    return (micros / interval_micros + 1) * interval_micros;
+  }
+};
+
+/**
+ * How writer_t encodes and compresses its files; the defaults are
+ * what it has always written.
+ *
+ * Codecs are named as in "zstd", "zstd:9" (with a level), "lz4",
+ * "snappy", "gzip", "brotli" or "none"; snappy and none take no
+ * level. `column_compression` overrides
+ * the codec of individual columns given by their parquet path, e.g.
+ * "bids.list.element.qty=zstd:9".
+ *
+ * `delta_encoding` writes int64 columns other than prices and
+ * quantities (timestamps, checksums, trade ids) DELTA_BINARY_PACKED,
+ * and `byte_stream_split` writes int64 and decimal128 prices and
+ * quantities BYTE_STREAM_SPLIT, which leaves them more compressible.
+ * Either replaces dictionary encoding for the columns it covers.
+ */
+struct writer_properties_t final {
+  std::string compression = "snappy";
+  std::vector<std::string> column_compression;
+  bool dictionary = true;
+  bool delta_encoding = false;
+  bool byte_stream_split = false;
+  int64_t row_group_size = 64 * 1024;
+  int64_t data_page_size = 1024 * 1024;
+
+  /** Throws std::runtime_error for an unknown codec or column. */
+  std::shared_ptr<parquet::WriterProperties> build(
+      const arrow::Schema& schema,
+      const parquet::ArrowWriterProperties& arrow_properties) const;
+
+ private:
+  struct codec_t final {
+    arrow::Compression::type type;
+    std::optional<int> level;
+  };
+  static codec_t codec(std::string_view name);
+};
+
 /**
  * RAII wrapper for the Arrow machinery necessary to write parquet files.
+ *
+ * Each file is written under its name plus ".tmp" and renamed once its
+ * footer is written, so a file under its final name is always
+ * complete and a crash only costs the file being written.
+ *
+ * With rotation, write() closes the current file and opens the next
+ * when one is due, before writing the batch, so files split at batch
+ * boundaries and never close empty. Intervals go by the time each
+ * batch is written for (its rows' receive time, for the sinks), so a
+ * batch that spans a boundary goes to the earlier file. `filename`
+ * names each file from the time of its first batch (the first file
+ * from `start_micros`), which is distinct for every file. Batches may
+ * stop coming, so close_if_due() finishes a file whose interval has
+ * passed by the clock without waiting for the next one. This all
+ * happens on the thread calling write(), which for the book and trades
+ * sinks is the async writer's.
  */
 struct writer_t final {
-  writer_t(std::string parquet_filename, std::shared_ptr<arrow::Schema> schema);
+  using filename_t = std::function<std::string(int64_t start_micros)>;
+  /** The wall clock in micros, which tests replace. */
+  using clock_fn_t = std::function<int64_t()>;
 
-  parquet::arrow::FileWriter& arrow_file_writer() {
-    return *m_arrow_file_writer;
-  }
+  writer_t(std::string parquet_filename,
+           std::shared_ptr<arrow::Schema> schema,
+           const writer_properties_t& properties = {});
+  writer_t(filename_t filename,
+           std::shared_ptr<arrow::Schema> schema,
+           int64_t start_micros,
+           rotation_t rotation,
+           const writer_properties_t& properties = {},
+           clock_fn_t clock = wall_clock);
+  ~writer_t();
+
+  writer_t(const writer_t&) = delete;
+  writer_t& operator=(const writer_t&) = delete;
+
+  /** Write rows from `micros` on, which picks their file. */
+  void write(const arrow::RecordBatch& batch, int64_t micros);
+  void write(const arrow::RecordBatch& batch) { write(batch, m_clock()); }
+
+  /** Finish and rename the current file; write() opens another. */
+  void close();
+
+  /** close() if the current file has rows and its interval has passed. */
+  void close_if_due();
+
+  static int64_t wall_clock() { return timestamp_t::now().micros(); }
+
+  /** Final name of the file being written, or empty if none is open. */
+  const std::string& filename() const { return m_filename; }
 
  private:
-  std::shared_ptr<parquet::WriterProperties> m_writer_properties;
+  static std::string tmp_filename(const std::string& filename) {
+    return filename + ".tmp";
+  }
+
+  void open(int64_t start_micros);
+  bool rotation_due(int64_t micros) const;
+
+  filename_t m_filename_fn;
+  std::shared_ptr<arrow::Schema> m_schema;
+  rotation_t m_rotation;
+  clock_fn_t m_clock;
+
   std::shared_ptr<parquet::ArrowWriterProperties> m_arrow_writer_properties;
+  std::shared_ptr<parquet::WriterProperties> m_writer_properties;
+
+  std::string m_filename;
+  int64_t m_start_micros = 0;
+  int64_t m_rotate_at_micros = 0;
+  size_t m_num_batches = 0;
   std::shared_ptr<arrow::io::FileOutputStream> m_file_output_stream;
   std::unique_ptr<parquet::arrow::FileWriter> m_arrow_file_writer;
 };
@@ -84,27 +218,199 @@ inline reader_t::reader_t(std::string parquet_filename)
       m_arrow_file_reader->GetRecordBatchReader(&m_record_batch_reader));
 }
 
+inline std::shared_ptr<parquet::WriterProperties> writer_properties_t::build(
+    const arrow::Schema& schema,
+    const parquet::ArrowWriterProperties& arrow_properties) const {
+  parquet::WriterProperties::Builder builder;
+  builder.max_row_group_length(row_group_size)
+      ->data_pagesize(data_page_size)
+      ->created_by(c_app_name)
+      ->version(parquet::ParquetVersion::PARQUET_2_6)
+      ->data_page_version(parquet::ParquetDataPageVersion::V2);
+
+  const auto default_codec = codec(compression);
+  builder.compression(default_codec.type);
+  if (default_codec.level) {
+    builder.compression_level(*default_codec.level);
+  }
+  if (!dictionary) {
+    builder.disable_dictionary();
+  }
+
+  // Column options go by parquet path, so map the schema to see which
+  // paths exist and what they hold.
+  std::shared_ptr<parquet::SchemaDescriptor> descriptor;
+  PARQUET_THROW_NOT_OK(parquet::arrow::ToParquetSchema(
+      &schema, *builder.build(), arrow_properties, &descriptor));
+
+  for (const auto& column : column_compression) {
+    const auto pos = column.find('=');
+    const auto path = column.substr(0, pos);
+    if (pos == std::string::npos || descriptor->ColumnIndex(path) < 0) {
+      throw std::runtime_error{"bad column compression: '" + column +
+                               "' (expected <column path>=<codec>)"};
+    }
+    const auto column_codec = codec(std::string_view{column}.substr(pos + 1));
+    builder.compression(path, column_codec.type);
+    if (column_codec.level) {
+      builder.compression_level(path, *column_codec.level);
+    }
+  }
+
+  for (int idx = 0; idx < descriptor->num_columns(); ++idx) {
+    const auto& column = *descriptor->Column(idx);
+    const auto path = column.path()->ToDotString();
+    const auto type = column.physical_type();
+    const bool is_price_or_qty =
+        column.name() == "price" || column.name() == "qty";
+    if (byte_stream_split && is_price_or_qty &&
+        (type == parquet::Type::INT64 ||
+         type == parquet::Type::FIXED_LEN_BYTE_ARRAY)) {
+      builder.disable_dictionary(path)->encoding(
+          path, parquet::Encoding::BYTE_STREAM_SPLIT);
+    } else if (delta_encoding && !is_price_or_qty &&
+               type == parquet::Type::INT64) {
+      builder.disable_dictionary(path)->encoding(
+          path, parquet::Encoding::DELTA_BINARY_PACKED);
+    }
+  }
+  return builder.build();
+}
+
+inline writer_properties_t::codec_t writer_properties_t::codec(
+    std::string_view name) {
+  const auto pos = name.find(':');
+  const auto codec_name = name.substr(0, pos);
+  auto result = codec_t{arrow::Compression::UNCOMPRESSED, std::nullopt};
+  if (codec_name == "snappy") {
+    result.type = arrow::Compression::SNAPPY;
+  } else if (codec_name == "zstd") {
+    result.type = arrow::Compression::ZSTD;
+  } else if (codec_name == "lz4") {
+    result.type = arrow::Compression::LZ4;
+  } else if (codec_name == "gzip") {
+    result.type = arrow::Compression::GZIP;
+  } else if (codec_name == "brotli") {
+    result.type = arrow::Compression::BROTLI;
+  } else if (codec_name != "none") {
+    throw std::runtime_error{"unknown parquet codec: '" + std::string{name} +
+                             "'"};
+  }
+  if (pos != std::string_view::npos) {
+    if (!arrow::util::Codec::SupportsCompressionLevel(result.type)) {
+      throw std::runtime_error{"parquet codec has no levels: '" +
+                               std::string{name} + "'"};
+    }
+    try {
+      result.level = std::stoi(std::string{name.substr(pos + 1)});
+    } catch (const std::exception&) {
+      throw std::runtime_error{"bad parquet codec level: '" +
+                               std::string{name} + "'"};
+    }
+  }
+  if (!arrow::util::Codec::IsAvailable(result.type)) {
+    throw std::runtime_error{"parquet codec not built into arrow: '" +
+                             std::string{name} + "'"};
+  }
+  return result;
+}
+
 inline writer_t::writer_t(std::string parquet_filename,
-                          std::shared_ptr<arrow::Schema> schema)
-    : m_writer_properties{parquet::WriterProperties::Builder()
-                              .max_row_group_length(64 * 1024)
-                              ->created_by(c_app_name)
-                              ->version(parquet::ParquetVersion::PARQUET_2_6)
-                              ->data_page_version(
-                                  parquet::ParquetDataPageVersion::V2)
-                              ->compression(arrow::Compression::SNAPPY)
-                              ->build()},
+                          std::shared_ptr<arrow::Schema> schema,
+                          const writer_properties_t& properties)
+    : writer_t{[parquet_filename](int64_t) { return parquet_filename; },
+               std::move(schema), 0, rotation_t{}, properties} {}
+
+inline writer_t::writer_t(filename_t filename,
+                          std::shared_ptr<arrow::Schema> schema,
+                          int64_t start_micros,
+                          rotation_t rotation,
+                          const writer_properties_t& properties,
+                          clock_fn_t clock)
+    : m_filename_fn{std::move(filename)},
+      m_schema{std::move(schema)},
+      m_rotation{rotation},
+      m_clock{std::move(clock)},
       m_arrow_writer_properties{
           parquet::ArrowWriterProperties::Builder().store_schema()->build()},
-      m_file_output_stream{
-          arrow::io::FileOutputStream::Open(parquet_filename).ValueOrDie()},
-      m_arrow_file_writer{
-          parquet::arrow::FileWriter::Open(*schema,
-                                           arrow::default_memory_pool(),
-                                           m_file_output_stream,
-                                           m_writer_properties,
-                                           m_arrow_writer_properties)
-              .ValueOrDie()} {}
+      m_writer_properties{
+          properties.build(*m_schema, *m_arrow_writer_properties)} {
+  open(start_micros);
+}
+
+inline writer_t::~writer_t() {
+  try {
+    close();
+  } catch (const std::exception& ex) {
+    BOOST_LOG_TRIVIAL(error)
+        << __FUNCTION__ << " failed to close " << m_filename << ": "
+        << ex.what();
+  }
+}
+
+inline void writer_t::write(const arrow::RecordBatch& batch,
+                             int64_t micros) {
+  if (m_arrow_file_writer && rotation_due(micros)) {
+    close();
+  }
+  if (!m_arrow_file_writer) {
+    open(std::max(micros, m_start_micros + 1));
+  }
+  PARQUET_THROW_NOT_OK(m_arrow_file_writer->WriteRecordBatch(batch));
+  ++m_num_batches;
+}
+
+inline void writer_t::close() {
+  if (!m_arrow_file_writer) {
+    return;
+  }
+  // Reset first so that a failure below leaves nothing half-closed to
+  // retry.
+  const auto arrow_file_writer = std::move(m_arrow_file_writer);
+  const auto file_output_stream = std::move(m_file_output_stream);
+  const auto filename = std::exchange(m_filename, std::string{});
+  PARQUET_THROW_NOT_OK(arrow_file_writer->Close());
+  PARQUET_THROW_NOT_OK(file_output_stream->Close());
+  std::filesystem::rename(tmp_filename(filename), filename);
+}
+
+inline void writer_t::close_if_due() {
+  if (m_arrow_file_writer && m_num_batches > 0 && m_rotate_at_micros > 0 &&
+      m_clock() >= m_rotate_at_micros) {
+    close();
+  }
+}
+
+inline void writer_t::open(int64_t start_micros) {
+  m_filename = m_filename_fn(start_micros);
+  m_start_micros = start_micros;
+  m_num_batches = 0;
+  m_rotate_at_micros = m_rotation.next_boundary(start_micros).value_or(0);
+  PARQUET_ASSIGN_OR_THROW(
+      m_file_output_stream,
+      arrow::io::FileOutputStream::Open(tmp_filename(m_filename)));
+  PARQUET_ASSIGN_OR_THROW(
+      m_arrow_file_writer,
+      parquet::arrow::FileWriter::Open(*m_schema, arrow::default_memory_pool(),
+                                       m_file_output_stream,
+                                       m_writer_properties,
+                                       m_arrow_writer_properties));
+}
+
+inline bool writer_t::rotation_due(int64_t micros) const {
+  if (m_num_batches == 0) {
+    return false;
+  }
+  if (m_rotate_at_micros > 0 && micros >= m_rotate_at_micros) {
+    return true;
+  }
+  if (m_rotation.max_bytes > 0) {
+    // Counts what has reached the file; the open row group has not.
+    const auto position = m_file_output_stream->Tell();
+    return position.ok() && *position >= m_rotation.max_bytes;
+  }
+  return false;
+}
 
 }  // namespace pq
 }  // namespace kdr
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "io.hpp"
+
+#include <arrow/api.h>
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace kdr {
+namespace pq {
+
+/**
+ * How the book and trades sinks lay out their files: one file for all
+ * symbols, or a partition per symbol (see partitioned_writer_t) with
+ * at most `max_open` files open at once, or any number if zero, and
+ * at most `max_buffered_rows` rows waiting for them.
+ */
+struct partitioning_t final {
+  bool by_symbol = false;
+  size_t max_open = 128;
+  int64_t max_buffered_rows = 256 * 1024;
+};
+
+/**
+ * partitioned_writer_t writes a sink's batches into a hive-style
+ * layout with a directory per symbol and UTC date:
+ *
+ *   <parquet_dir>/<sink>/symbol=BTC_USD/date=2024-09-10/part-<micros>.pq
+ *
+ * so that reading or replaying one pair touches only that pair's
+ * files. write() splits each batch by its "symbol" column and keeps
+ * the rows until their partition has a row group's worth, then hands
+ * them to the partition's writer_t, which rotates and renames its
+ * files as usual (and at least daily, since the date is part of the
+ * path). The date is that of the batch's time, like the intervals, so
+ * a batch must not span midnight: see rotation().
+ *
+ * Every open partition holds a file descriptor, so only `max_open` of
+ * the most recently written ones stay open: the least recently
+ * written is closed to make room, counted by num_evictions(), and its
+ * next rows start a new part. Rows are kept back so that each part
+ * still gets many of them: when more than `max_buffered_rows` are
+ * waiting, the partition with the most goes to its file, and
+ * close_if_due() writes out and closes the partitions whose interval
+ * has passed, so that a pair which stops trading does not leave its
+ * rows behind.
+ *
+ * Like writer_t, it is used by one thread at a time: the async
+ * writer's, for the sinks.
+ */
+struct partitioned_writer_t final {
+  partitioned_writer_t(std::string parquet_dir,
+                       std::string sink_name,
+                       std::shared_ptr<arrow::Schema> schema,
+                       rotation_t rotation,
+                       writer_properties_t properties,
+                       partitioning_t partitioning,
+                       std::optional<size_t> shard = {},
+                       writer_t::clock_fn_t clock = writer_t::wall_clock);
+  ~partitioned_writer_t();
+
+  partitioned_writer_t(const partitioned_writer_t&) = delete;
+  partitioned_writer_t& operator=(const partitioned_writer_t&) = delete;
+
+  /** Write rows from `micros` on, see writer_t. */
+  void write(const arrow::RecordBatch& batch, int64_t micros);
+
+  /** Write out every waiting row, then finish and rename every file. */
+  void close();
+
+  /** Close every partition whose file is due, see writer_t. */
+  void close_if_due();
+
+  size_t num_open() const { return m_open.size(); }
+  /** Rows written to no file yet. */
+  int64_t num_buffered_rows() const { return m_num_buffered_rows; }
+  /** Safe to call from any thread. */
+  size_t num_evictions() const { return m_num_evictions.load(); }
+
+  /** How files rotate, at least daily whatever was asked for. */
+  const rotation_t& rotation() const { return m_rotation; }
+
+  /** Directory holding `symbol`'s files for the day of `micros`. */
+  static std::string partition_dir(const std::string& parquet_dir,
+                                   const std::string& sink_name,
+                                   const std::string& symbol,
+                                   int64_t micros);
+
+ private:
+  struct partition_t;
+  using lru_t = std::list<partition_t*>;
+
+  // A symbol's files for one date and the rows waiting for them, each
+  // with the time of the batch it came in.
+  struct partition_t final {
+    std::string symbol;
+    std::string dir;
+    std::vector<std::pair<std::shared_ptr<arrow::RecordBatch>, int64_t>>
+        buffered;
+    int64_t num_buffered_rows = 0;
+    // Null while closed, else in m_open at `lru`.
+    std::unique_ptr<writer_t> writer;
+    lru_t::iterator lru;
+  };
+
+  void buffer(const std::string& symbol,
+              std::shared_ptr<arrow::RecordBatch> batch,
+              int64_t micros);
+  void flush(partition_t& partition);
+  writer_t& open(partition_t& partition, int64_t micros);
+  void close(partition_t& partition);
+
+  const std::string m_parquet_dir;
+  const std::string m_sink_name;
+  const std::shared_ptr<arrow::Schema> m_schema;
+  const rotation_t m_rotation;
+  const writer_properties_t m_properties;
+  const size_t m_max_open;
+  const int64_t m_max_buffered_rows;
+  // A partition writes out its rows once it has this many.
+  const int64_t m_flush_rows;
+  const std::optional<size_t> m_shard;
+  const writer_t::clock_fn_t m_clock;
+  const int m_symbol_index;
+
+  // Keyed by directory, so by symbol and date.
+  std::unordered_map<std::string, partition_t> m_partitions;
+  // Partitions with a file open, most recently written first.
+  lru_t m_open;
+  int64_t m_num_buffered_rows = 0;
+  // By symbol, the start of its most recently opened file.
+  std::unordered_map<std::string, int64_t> m_last_start_micros;
+  std::atomic<size_t> m_num_evictions = 0;
+};
+
+}  // namespace pq
+}  // namespace kdr
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "async_writer.hpp"
+#include "decimal_column.hpp"
 #include "io.hpp"
+#include "partitioned_writer.hpp"
 
 #include <header.hpp>
 #include <refdata.hpp>
@@ -9,7 +12,9 @@
 #include <arrow/api.h>
 
 #include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 namespace kdr {
 namespace pq {
@@ -17,32 +22,65 @@ namespace pq {
 struct trades_sink_t final {
   static constexpr char c_sink_name[] = "trades";
 
-  trades_sink_t(std::string parquet_dir, sink_id_t);
+  trades_sink_t(std::string parquet_dir,
+                sink_id_t,
+                model::price_format_t price_format,
+                async_writer_t& async_writer,
+                rotation_t rotation,
+                partitioning_t partitioning,
+                const writer_properties_t& properties,
+                std::optional<size_t> shard = {});
   ~trades_sink_t();
 
   void accept(const response::trades_t&, const model::refdata_t&);
 
+  /** See partitioned_writer_t; zero unless partitioned. */
+  size_t num_evictions() const {
+    return m_partitioned_writer ? m_partitioned_writer->num_evictions() : 0;
+  }
+
  private:
   static constexpr size_t c_flush_threshold = 4096;
 
-  static std::shared_ptr<arrow::Schema> schema();
+  static std::shared_ptr<arrow::Schema> schema(model::price_format_t);
 
+  /**
+   * Flush first if a row received at `recv_tm` belongs in a later file
+   * than the rows batched so far, so that each batch is written to the
+   * interval (and date) its rows were received in.
+   */
+  void next_row(int64_t recv_tm);
   void flush();
 
+  model::price_format_t m_price_format;
   std::shared_ptr<arrow::Schema> m_schema;
-  std::string m_sink_filename;
-  writer_t m_writer;
+  // Exactly one of these, as partitioning_t::by_symbol says.
+  std::optional<writer_t> m_writer;
+  std::optional<partitioned_writer_t> m_partitioned_writer;
+  async_writer_t& m_async_writer;
+  rotation_t m_rotation;
 
   size_t m_num_rows = 0;
+  // The first row's recv_tm and the next rotation after it.
+  int64_t m_batch_micros = 0;
+  int64_t m_batch_ends_micros = 0;
 
   arrow::Int64Builder m_recv_tm_builder;
   arrow::StringBuilder m_ord_type_builder;
-  arrow::StringBuilder m_price_builder;
-  arrow::StringBuilder m_qty_builder;
+  decimal_column_t m_price_column;
+  decimal_column_t m_qty_column;
   arrow::StringBuilder m_side_builder;
   arrow::StringBuilder m_symbol_builder;
   arrow::Int64Builder m_timestamp_builder;
   arrow::UInt64Builder m_trade_id_builder;
+
+  // Only written with price_format_int64, where they give the scale.
+  arrow::Int8Builder m_price_precision_builder;
+  arrow::Int8Builder m_qty_precision_builder;
+
+  // Each trade's precisions, looked up before any is appended. Kept
+  // across messages for its capacity.
+  std::vector<model::refdata_t::pair_precision_t> m_precisions;
 };
 
 }  // namespace pq
@@ -55,7 +55,7 @@ void assets_sink_t::accept(const response::header_t& header,
 
   std::shared_ptr<arrow::RecordBatch> batch =
       arrow::RecordBatch::Make(m_schema, assets.size(), columns);
-  PARQUET_THROW_NOT_OK(m_writer.arrow_file_writer().WriteRecordBatch(*batch));
+  m_writer.write(*batch);
 }
 
 std::shared_ptr<arrow::Schema> assets_sink_t::schema() {
@@ -0,0 +1,220 @@
+#include "async_writer.hpp"
+
+#include <boost/log/trivial.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace kdr {
+namespace pq {
+
+namespace {
+
+size_t micros_since(std::chrono::steady_clock::time_point start) {
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+      .count();
+}
+
+}  // namespace
+
+async_writer_t::async_writer_t(size_t max_queued,
+                               std::chrono::milliseconds tick)
+    : m_max_queued{max_queued},
+      m_tick{tick},
+      m_next_tick{std::chrono::steady_clock::now() + tick} {
+  if (m_max_queued > 0) {
+    m_thread = std::thread{[this] { run(); }};
+  }
+}
+
+async_writer_t::~async_writer_t() {
+  if (!m_thread.joinable()) {
+    return;
+  }
+  {
+    const std::lock_guard lock{m_mutex};
+    m_stopping = true;
+  }
+  m_queued_cv.notify_one();
+  m_thread.join();
+  if (m_error) {
+    BOOST_LOG_TRIVIAL(error)
+        << __FUNCTION__ << " dropping an unreported write error";
+  }
+}
+
+void async_writer_t::write(writer_t& writer,
+                           std::shared_ptr<arrow::RecordBatch> batch,
+                           int64_t micros) {
+  enqueue(job_t{&writer, std::move(batch), micros});
+}
+
+void async_writer_t::write(partitioned_writer_t& writer,
+                           std::shared_ptr<arrow::RecordBatch> batch,
+                           int64_t micros) {
+  enqueue(job_t{&writer, std::move(batch), micros});
+}
+
+void async_writer_t::add(writer_t& writer) {
+  const std::lock_guard lock{m_mutex};
+  m_targets.push_back(&writer);
+}
+
+void async_writer_t::add(partitioned_writer_t& writer) {
+  const std::lock_guard lock{m_mutex};
+  m_targets.push_back(&writer);
+}
+
+void async_writer_t::remove(writer_t& writer) {
+  remove(target_t{&writer});
+}
+
+void async_writer_t::remove(partitioned_writer_t& writer) {
+  remove(target_t{&writer});
+}
+
+void async_writer_t::remove(target_t target) {
+  std::unique_lock lock{m_mutex};
+  m_written_cv.wait(lock, [this] { return !m_ticking; });
+  std::erase(m_targets, target);
+}
+
+void async_writer_t::enqueue(job_t job) {
+  if (m_max_queued == 0) {
+    std::unique_lock lock{m_mutex};
+    tick_if_due(lock);
+    lock.unlock();
+    try {
+      write_now(job);
+    } catch (...) {
+      ++m_num_errors;
+      throw;
+    }
+    lock.lock();
+    rethrow_error();
+    return;
+  }
+  {
+    std::unique_lock lock{m_mutex};
+    if (m_queue.size() >= m_max_queued) {
+      const auto start = std::chrono::steady_clock::now();
+      m_written_cv.wait(lock,
+                        [this] { return m_queue.size() < m_max_queued; });
+      ++m_num_waits;
+      m_wait_micros += micros_since(start);
+    }
+    m_queue.push_back(std::move(job));
+  }
+  m_queued_cv.notify_one();
+
+  const std::lock_guard lock{m_mutex};
+  rethrow_error();
+}
+
+void async_writer_t::drain() {
+  std::unique_lock lock{m_mutex};
+  m_written_cv.wait(lock,
+                    [this] { return m_queue.empty() && m_num_writing == 0; });
+  rethrow_error();
+}
+
+void async_writer_t::rethrow_error() {
+  if (m_error) {
+    std::rethrow_exception(std::exchange(m_error, nullptr));
+  }
+}
+
+size_t async_writer_t::queue_depth() const {
+  const std::lock_guard lock{m_mutex};
+  return m_queue.size() + m_num_writing;
+}
+
+void async_writer_t::run() {
+  std::unique_lock lock{m_mutex};
+  while (true) {
+    // Between batches, so that a busy queue does not hold ticks off.
+    tick_if_due(lock);
+    m_queued_cv.wait_until(lock, m_next_tick, [this] {
+      return m_stopping || !m_queue.empty();
+    });
+    if (m_queue.empty()) {
+      if (m_stopping) {
+        return;  // everything queued has been written
+      }
+      continue;  // time to tick
+    }
+    const auto job = std::move(m_queue.front());
+    m_queue.pop_front();
+    ++m_num_writing;
+
+    lock.unlock();
+    auto error = std::exception_ptr{};
+    try {
+      write_now(job);
+    } catch (const std::exception& ex) {
+      BOOST_LOG_TRIVIAL(error)
+          << __FUNCTION__ << " failed to write batch: " << ex.what();
+      ++m_num_errors;
+      error = std::current_exception();
+    }
+    lock.lock();
+
+    // There is no one to throw to on this thread: keep the error for
+    // the next write() or drain().
+    if (error && !m_error) {
+      m_error = error;
+    }
+
+    --m_num_writing;
+    m_written_cv.notify_all();
+  }
+}
+
+void async_writer_t::tick_if_due(std::unique_lock<std::mutex>& lock) {
+  const auto now = std::chrono::steady_clock::now();
+  if (now < m_next_tick) {
+    return;
+  }
+  m_next_tick = now + m_tick;
+  const auto targets = m_targets;
+  m_ticking = true;
+
+  lock.unlock();
+  auto error = std::exception_ptr{};
+  for (const auto target : targets) {
+    try {
+      std::visit([](auto* writer) { writer->close_if_due(); }, target);
+    } catch (const std::exception& ex) {
+      BOOST_LOG_TRIVIAL(error)
+          << __FUNCTION__ << " failed to close file: " << ex.what();
+      ++m_num_errors;
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  }
+  lock.lock();
+
+  if (error && !m_error) {
+    m_error = error;
+  }
+  m_ticking = false;
+  m_written_cv.notify_all();
+}
+
+void async_writer_t::write_now(const job_t& job) {
+  const auto start = std::chrono::steady_clock::now();
+  std::visit(
+      [&job](auto* writer) { writer->write(*job.batch, job.micros); },
+      job.writer);
+  const auto micros = micros_since(start);
+  m_write_micros = micros;
+  if (micros > m_max_write_micros) {
+    m_max_write_micros = micros;
+  }
+}
+
+}  // namespace pq
+}  // namespace kdr
@@ -1,42 +1,73 @@
 #include "book_sink.hpp"
 
+#include <pair.hpp>
+
 #include <arrow/scalar.h>
 #include <boost/log/trivial.hpp>
 
+#include <limits>
+
 namespace kdr {
 namespace pq {
 
 book_sink_t::book_sink_t(std::string parquet_dir,
                          sink_id_t id,
-                         integer_t book_depth)
-    : m_schema{schema(book_depth)},
-      m_sink_filename{parquet_filename(parquet_dir, c_sink_name, id)},
-      m_writer{m_sink_filename, m_schema},
+                         integer_t book_depth,
+                         model::price_format_t price_format,
+                         async_writer_t& async_writer,
+                         rotation_t rotation,
+                         partitioning_t partitioning,
+                         const writer_properties_t& properties,
+                         std::optional<size_t> shard)
+    : m_price_format{price_format},
+      m_schema{schema(book_depth, price_format)},
+      m_async_writer{async_writer},
+      m_rotation{rotation},
       m_recv_tm_builder{std::make_shared<arrow::Int64Builder>()},
-      m_type_builder{std::make_shared<arrow::StringBuilder>()},
-      m_bid_price_builder{std::make_shared<arrow::StringBuilder>()},
-      m_bid_qty_builder{std::make_shared<arrow::StringBuilder>()},
+      m_type_builder{std::make_shared<arrow::Int8Builder>()},
+      m_bid_price_column{price_format},
+      m_bid_qty_column{price_format},
       m_bid_builder{std::make_shared<arrow::StructBuilder>(
-          quote_struct(),
+          quote_struct(price_format),
           arrow::default_memory_pool(),
           std::vector<std::shared_ptr<arrow::ArrayBuilder>>{
-              m_bid_price_builder, m_bid_qty_builder})},
+              m_bid_price_column.builder(), m_bid_qty_column.builder()})},
       m_bids_builder{
           std::make_shared<arrow::ListBuilder>(arrow::default_memory_pool(),
                                                m_bid_builder)},
-      m_ask_price_builder{std::make_shared<arrow::StringBuilder>()},
-      m_ask_qty_builder{std::make_shared<arrow::StringBuilder>()},
+      m_ask_price_column{price_format},
+      m_ask_qty_column{price_format},
       m_ask_builder{std::make_shared<arrow::StructBuilder>(
-          quote_struct(),
+          quote_struct(price_format),
           arrow::default_memory_pool(),
           std::vector<std::shared_ptr<arrow::ArrayBuilder>>{
-              m_ask_price_builder, m_ask_qty_builder})},
+              m_ask_price_column.builder(), m_ask_qty_column.builder()})},
       m_asks_builder{
           std::make_shared<arrow::ListBuilder>(arrow::default_memory_pool(),
                                                m_ask_builder)},
       m_crc32_builder{std::make_shared<arrow::UInt64Builder>()},
       m_symbol_builder{std::make_shared<arrow::StringBuilder>()},
-      m_timestamp_builder{std::make_shared<arrow::Int64Builder>()} {}
+      m_timestamp_builder{std::make_shared<arrow::Int64Builder>()},
+      m_price_precision_builder{std::make_shared<arrow::Int8Builder>()},
+      m_qty_precision_builder{std::make_shared<arrow::Int8Builder>()} {
+  if (partitioning.by_symbol) {
+    m_partitioned_writer.emplace(parquet_dir, c_sink_name, m_schema, rotation,
+                                 properties, partitioning, shard);
+  } else {
+    m_writer.emplace(
+        [parquet_dir, shard](int64_t start_micros) {
+          return parquet_filename(parquet_dir, c_sink_name, start_micros,
+                                  shard);
+        },
+        m_schema, id, rotation, properties);
+  }
+  if (m_partitioned_writer) {
+    m_rotation = m_partitioned_writer->rotation();
+    m_async_writer.add(*m_partitioned_writer);
+  } else {
+    m_async_writer.add(*m_writer);
+  }
+}
 
 book_sink_t::~book_sink_t() {
   try {
@@ -44,6 +75,18 @@ book_sink_t::~book_sink_t() {
   } catch (const std::exception& ex) {
     BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << " failed to flush() sink";
   }
+  // Queued batches refer to the writers.
+  try {
+    m_async_writer.drain();
+  } catch (const std::exception& ex) {
+    BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << " failed to write batches: "
+                             << ex.what();
+  }
+  if (m_partitioned_writer) {
+    m_async_writer.remove(*m_partitioned_writer);
+  } else {
+    m_async_writer.remove(*m_writer);
+  }
 }
 
 void book_sink_t::accept(const response::book_t& book,
@@ -55,49 +98,100 @@ void book_sink_t::accept(const response::book_t& book,
     BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << msg;
     throw std::runtime_error{msg};
   }
+  begin(book.header(), book.symbol(), precision->price_precision,
+        precision->qty_precision);
+  for (const auto& bid : book.bids()) {
+    accept_bid(bid);
+  }
+  for (const auto& ask : book.asks()) {
+    accept_ask(ask);
+  }
+  end(book.crc32(), book.timestamp());
+}
 
-  PARQUET_THROW_NOT_OK(
-      m_recv_tm_builder->Append(book.header().recv_tm().micros()));
-  PARQUET_THROW_NOT_OK(m_type_builder->Append(book.header().type()));
-  PARQUET_THROW_NOT_OK(m_crc32_builder->Append(book.crc32()));
+void book_sink_t::begin(const response::header_t& header,
+                        const std::string& symbol,
+                        integer_t price_precision,
+                        integer_t qty_precision) {
+  m_row.recv_tm = header.recv_tm().micros();
+  m_row.type = header.type();
+  m_row.symbol = symbol;
+  m_row.price_precision = price_precision;
+  m_row.qty_precision = qty_precision;
+  m_row.bids.clear();
+  m_row.asks.clear();
+}
 
-  PARQUET_THROW_NOT_OK(m_bid_price_builder->Reserve(book.bids().size()));
-  PARQUET_THROW_NOT_OK(m_bid_qty_builder->Reserve(book.bids().size()));
-  PARQUET_THROW_NOT_OK(m_bid_builder->Reserve(book.bids().size()));
-  PARQUET_THROW_NOT_OK(m_bids_builder->Reserve(1));
+void book_sink_t::accept_bid(const bid_t& bid) {
+  m_row.bids.push_back(bid);
+}
 
-  PARQUET_THROW_NOT_OK(m_bids_builder->Append(book.bids().size()));
-  for (const auto& bid : book.bids()) {
-    PARQUET_THROW_NOT_OK(m_bid_builder->Append());
-    PARQUET_THROW_NOT_OK(
-        m_bid_price_builder->Append(bid.first.str(precision->price_precision)));
-    PARQUET_THROW_NOT_OK(
-        m_bid_qty_builder->Append(bid.second.str(precision->qty_precision)));
+void book_sink_t::accept_ask(const ask_t& ask) {
+  m_row.asks.push_back(ask);
+}
+
+void book_sink_t::end(uint64_t crc32, timestamp_t timestamp) {
+  // Anything that can reject a level does so before the first append,
+  // so that the row goes in whole or not at all.
+  for (const auto* levels : {&m_row.bids, &m_row.asks}) {
+    for (const auto& [price, qty] : *levels) {
+      m_bid_price_column.check(price, m_row.price_precision);
+      m_bid_qty_column.check(qty, m_row.qty_precision);
+    }
   }
 
-  PARQUET_THROW_NOT_OK(m_ask_price_builder->Reserve(book.asks().size()));
-  PARQUET_THROW_NOT_OK(m_ask_qty_builder->Reserve(book.asks().size()));
-  PARQUET_THROW_NOT_OK(m_ask_builder->Reserve(book.asks().size()));
-  PARQUET_THROW_NOT_OK(m_asks_builder->Reserve(1));
+  next_row(m_row.recv_tm);
+  PARQUET_THROW_NOT_OK(m_recv_tm_builder->Append(m_row.recv_tm));
+  PARQUET_THROW_NOT_OK(m_type_builder->Append(m_row.type));
+  PARQUET_THROW_NOT_OK(m_symbol_builder->Append(m_row.symbol));
+  if (m_price_format == model::price_format_int64) {
+    PARQUET_THROW_NOT_OK(m_price_precision_builder->Append(
+        static_cast<int8_t>(m_row.price_precision)));
+    PARQUET_THROW_NOT_OK(m_qty_precision_builder->Append(
+        static_cast<int8_t>(m_row.qty_precision)));
+  }
 
-  PARQUET_THROW_NOT_OK(m_asks_builder->Append(book.asks().size()));
-  for (const auto& ask : book.asks()) {
+  PARQUET_THROW_NOT_OK(m_bids_builder->Append());
+  for (const auto& [price, qty] : m_row.bids) {
+    PARQUET_THROW_NOT_OK(m_bid_builder->Append());
+    m_bid_price_column.append(price, m_row.price_precision);
+    m_bid_qty_column.append(qty, m_row.qty_precision);
+  }
+  PARQUET_THROW_NOT_OK(m_asks_builder->Append());
+  for (const auto& [price, qty] : m_row.asks) {
     PARQUET_THROW_NOT_OK(m_ask_builder->Append());
-    PARQUET_THROW_NOT_OK(
-        m_ask_price_builder->Append(ask.first.str(precision->price_precision)));
-    PARQUET_THROW_NOT_OK(
-        m_ask_qty_builder->Append(ask.second.str(precision->qty_precision)));
+    m_ask_price_column.append(price, m_row.price_precision);
+    m_ask_qty_column.append(qty, m_row.qty_precision);
   }
 
-  PARQUET_THROW_NOT_OK(m_symbol_builder->Append(book.symbol()));
-  PARQUET_THROW_NOT_OK(m_timestamp_builder->Append(book.timestamp().micros()));
+  PARQUET_THROW_NOT_OK(m_crc32_builder->Append(crc32));
+  PARQUET_THROW_NOT_OK(m_timestamp_builder->Append(timestamp.micros()));
 
   if (++m_num_rows >= c_flush_threshold) {
     flush();
   }
 }
 
+void book_sink_t::abort() {
+  m_row.bids.clear();
+  m_row.asks.clear();
+}
+
+void book_sink_t::next_row(int64_t recv_tm) {
+  if (m_num_rows > 0 && recv_tm >= m_batch_ends_micros) {
+    flush();
+  }
+  if (m_num_rows == 0) {
+    m_batch_micros = recv_tm;
+    m_batch_ends_micros = m_rotation.next_boundary(recv_tm).value_or(
+        std::numeric_limits<int64_t>::max());
+  }
+}
+
 void book_sink_t::flush() {
+  if (m_num_rows == 0) {
+    return;
+  }
   std::shared_ptr<arrow::Array> recv_tm_array;
   std::shared_ptr<arrow::Array> type_array;
   std::shared_ptr<arrow::Array> bids_array;
@@ -117,36 +211,72 @@ void book_sink_t::flush() {
   auto columns = std::vector<std::shared_ptr<arrow::Array>>{
       recv_tm_array, type_array,   bids_array,     asks_array,
       crc32_array,   symbol_array, timestamp_array};
+  if (m_price_format == model::price_format_int64) {
+    std::shared_ptr<arrow::Array> price_precision_array;
+    std::shared_ptr<arrow::Array> qty_precision_array;
+    PARQUET_THROW_NOT_OK(
+        m_price_precision_builder->Finish(&price_precision_array));
+    PARQUET_THROW_NOT_OK(m_qty_precision_builder->Finish(&qty_precision_array));
+    columns.push_back(price_precision_array);
+    columns.push_back(qty_precision_array);
+  }
 
   std::shared_ptr<arrow::RecordBatch> batch =
       arrow::RecordBatch::Make(m_schema, m_num_rows, columns);
-  PARQUET_THROW_NOT_OK(m_writer.arrow_file_writer().WriteRecordBatch(*batch));
-
+  // The builders are empty now, whatever becomes of the batch.
   m_num_rows = 0;
+
+  // A failed write (this batch's, inline, or an earlier one's from the
+  // writer thread) is the writer's, not the row being added's: it is
+  // counted in writer_errors and logged, and recording carries on.
+  try {
+    if (m_partitioned_writer) {
+      m_async_writer.write(*m_partitioned_writer, std::move(batch),
+                           m_batch_micros);
+    } else {
+      m_async_writer.write(*m_writer, std::move(batch), m_batch_micros);
+    }
+  } catch (const std::exception& ex) {
+    BOOST_LOG_TRIVIAL(error)
+        << __FUNCTION__ << " failed to write batch: " << ex.what();
+  }
 }
 
-std::shared_ptr<arrow::DataType> book_sink_t::quote_struct() {
+std::shared_ptr<arrow::DataType> book_sink_t::quote_struct(
+    model::price_format_t price_format) {
+  const auto type = decimal_column_t::type(price_format);
   const auto field_vector =
-      arrow::FieldVector{arrow::field("price", arrow::utf8(), false),
-                         arrow::field("qty", arrow::utf8(), false)};
+      arrow::FieldVector{arrow::field("price", type, false),
+                         arrow::field("qty", type, false)};
   return arrow::struct_(field_vector);
 }
 
-std::shared_ptr<arrow::Schema> book_sink_t::schema(integer_t book_depth) {
+std::shared_ptr<arrow::Schema> book_sink_t::schema(
+    integer_t book_depth,
+    model::price_format_t price_format) {
   auto metadata = std::make_shared<arrow::KeyValueMetadata>();
   metadata->Append("book_depth", std::to_string(book_depth));
+  decimal_column_t::append_metadata(price_format, *metadata);
 
-  // TODO: add KeyValueMetadata for enum fields
+  // The type column holds msg_type_t values; record their names so
+  // that readers need not hard-code them.
+  for (const auto type : {model::msg_type_snapshot,
+                          model::msg_type_update,
+                          model::msg_type_gap}) {
+    metadata->Append(std::string{response::header_t::c_type} + "." +
+                         model::msg_type_t_to_str(type),
+                     std::to_string(type));
+  }
 
   auto field_vector = arrow::FieldVector{
       arrow::field(std::string{response::header_t::c_recv_tm}, arrow::int64(),
                    false),  // TODO: replace with timestamp type?
-      arrow::field(std::string{response::header_t::c_type}, arrow::utf8(),
+      arrow::field(std::string{response::header_t::c_type}, arrow::int8(),
                    false),
       arrow::field(std::string{response::book_t::c_bids},
-                   arrow::list(quote_struct()), false),
+                   arrow::list(quote_struct(price_format)), false),
       arrow::field(std::string{response::book_t::c_asks},
-                   arrow::list(quote_struct()), false),
+                   arrow::list(quote_struct(price_format)), false),
       arrow::field(std::string{response::book_t::c_checksum}, arrow::uint64(),
                    false),
       arrow::field(std::string{response::book_t::c_symbol}, arrow::utf8(),
@@ -154,6 +284,13 @@ std::shared_ptr<arrow::Schema> book_sink_t::schema(integer_t book_depth) {
       arrow::field(std::string{response::book_t::c_timestamp}, arrow::int64(),
                    false),  // TODO: replace with timestamp type?
   };
+  if (price_format == model::price_format_int64) {
+    field_vector.push_back(
+        arrow::field(std::string{model::pair_t::c_price_precision},
+                     arrow::int8(), false));
+    field_vector.push_back(arrow::field(
+        std::string{model::pair_t::c_qty_precision}, arrow::int8(), false));
+  }
   return arrow::schema(field_vector)->WithMetadata(metadata);
   ;
 }
@@ -0,0 +1,133 @@
+#include "decimal_column.hpp"
+
+#include <pair.hpp>
+
+#include <parquet/exception.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace kdr {
+namespace pq {
+
+decimal_column_t::decimal_column_t(model::price_format_t format)
+    : m_format{format} {
+  switch (m_format) {
+    case model::price_format_decimal128: {
+      auto builder = std::make_shared<arrow::Decimal128Builder>(type(format));
+      m_decimal128_builder = builder.get();
+      m_builder = builder;
+      break;
+    }
+    case model::price_format_int64: {
+      auto builder = std::make_shared<arrow::Int64Builder>();
+      m_int64_builder = builder.get();
+      m_builder = builder;
+      break;
+    }
+    case model::price_format_string: {
+      auto builder = std::make_shared<arrow::StringBuilder>();
+      m_string_builder = builder.get();
+      m_builder = builder;
+      break;
+    }
+    case model::price_format_invalid:
+      throw std::runtime_error("decimal_column_t invalid price_format");
+  }
+}
+
+std::shared_ptr<arrow::DataType> decimal_column_t::type(
+    model::price_format_t format) {
+  switch (format) {
+    case model::price_format_decimal128:
+      return arrow::decimal128(c_decimal128_precision, c_decimal128_scale);
+    case model::price_format_int64:
+      return arrow::int64();
+    default:
+      return arrow::utf8();
+  }
+}
+
+void decimal_column_t::append_metadata(model::price_format_t format,
+                                       arrow::KeyValueMetadata& metadata) {
+  metadata.Append("price_format", model::price_format_t_to_str(format));
+  switch (format) {
+    case model::price_format_decimal128:
+      metadata.Append("price.scale", std::to_string(c_decimal128_scale));
+      metadata.Append("qty.scale", std::to_string(c_decimal128_scale));
+      break;
+    case model::price_format_int64:
+      // The scale varies by pair, so each row names its own.
+      metadata.Append("price.scale",
+                      std::string{model::pair_t::c_price_precision});
+      metadata.Append("qty.scale", std::string{model::pair_t::c_qty_precision});
+      break;
+    default:
+      break;
+  }
+}
+
+decimal_t decimal_column_t::value(const arrow::Array& array,
+                                  int64_t idx,
+                                  integer_t precision) {
+  switch (array.type_id()) {
+    case arrow::Type::DECIMAL128: {
+      const auto& decimals = static_cast<const arrow::Decimal128Array&>(array);
+      const auto stored = arrow::Decimal128{decimals.GetValue(idx)};
+      const auto units = stored.ReduceScaleBy(
+          c_decimal128_scale - static_cast<int32_t>(precision), false);
+      return decimal_t::from_units(static_cast<int64_t>(units.low_bits()),
+                                   precision);
+    }
+    case arrow::Type::INT64:
+      return decimal_t::from_units(
+          static_cast<const arrow::Int64Array&>(array).Value(idx), precision);
+    case arrow::Type::STRING:
+      return decimal_t{
+          static_cast<const arrow::StringArray&>(array).GetView(idx)};
+    default:
+      throw std::runtime_error("decimal_column_t unexpected column type: " +
+                               array.type()->ToString());
+  }
+}
+
+void decimal_column_t::check(const decimal_t& value,
+                             integer_t precision) const {
+  // Only int64 units can overflow.
+  if (m_format == model::price_format_int64) {
+    static_cast<void>(value.units(precision));
+  }
+}
+
+void decimal_column_t::append(const decimal_t& value, integer_t precision) {
+  switch (m_format) {
+    case model::price_format_decimal128: {
+      // Truncated to `precision`, as the other formats are.
+      auto mantissa = arrow::Decimal128{0, value.mantissa()};
+      auto scale = static_cast<int32_t>(value.scale());
+      if (scale > precision) {
+        mantissa = mantissa.ReduceScaleBy(scale - precision, false);
+        scale = static_cast<int32_t>(precision);
+      }
+      const auto scaled = mantissa.IncreaseScaleBy(c_decimal128_scale - scale);
+      PARQUET_THROW_NOT_OK(m_decimal128_builder->Append(scaled));
+      break;
+    }
+    case model::price_format_int64:
+      PARQUET_THROW_NOT_OK(m_int64_builder->Append(value.units(precision)));
+      break;
+    default: {
+      decimal_t::chars_t buffer;
+      PARQUET_THROW_NOT_OK(
+          m_string_builder->Append(value.to_chars(buffer, precision)));
+      break;
+    }
+  }
+}
+
+void decimal_column_t::finish(std::shared_ptr<arrow::Array>* out) {
+  PARQUET_THROW_NOT_OK(m_builder->Finish(out));
+}
+
+}  // namespace pq
+}  // namespace kdr
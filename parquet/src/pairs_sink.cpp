@@ -110,7 +110,7 @@ void pairs_sink_t::accept(const response::header_t& header,
 
   std::shared_ptr<arrow::RecordBatch> batch =
       arrow::RecordBatch::Make(m_schema, pairs.size(), columns);
-  PARQUET_THROW_NOT_OK(m_writer.arrow_file_writer().WriteRecordBatch(*batch));
+  m_writer.write(*batch);
 }
 
 std::shared_ptr<arrow::Schema> pairs_sink_t::schema() {
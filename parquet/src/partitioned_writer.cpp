@@ -0,0 +1,252 @@
+#include "partitioned_writer.hpp"
+
+#include <arrow/compute/api_vector.h>
+#include <boost/log/trivial.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace kdr {
+namespace pq {
+
+namespace {
+
+constexpr char c_symbol[] = "symbol";
+constexpr int64_t c_micros_per_day = 86'400'000'000;
+
+/**
+ * The date in a partition's path is that of its file's first batch,
+ * so files must not outlive the day.
+ */
+rotation_t daily(rotation_t rotation) {
+  if (rotation.interval_micros <= 0 ||
+      rotation.interval_micros > c_micros_per_day) {
+    rotation.interval_micros = c_micros_per_day;
+  }
+  return rotation;
+}
+
+}  // namespace
+
+partitioned_writer_t::partitioned_writer_t(
+    std::string parquet_dir,
+    std::string sink_name,
+    std::shared_ptr<arrow::Schema> schema,
+    rotation_t rotation,
+    writer_properties_t properties,
+    partitioning_t partitioning,
+    std::optional<size_t> shard,
+    writer_t::clock_fn_t clock)
+    : m_parquet_dir{std::move(parquet_dir)},
+      m_sink_name{std::move(sink_name)},
+      m_schema{std::move(schema)},
+      m_rotation{daily(rotation)},
+      m_properties{std::move(properties)},
+      m_max_open{partitioning.max_open},
+      m_max_buffered_rows{std::max<int64_t>(partitioning.max_buffered_rows, 0)},
+      m_flush_rows{std::min(m_properties.row_group_size, m_max_buffered_rows)},
+      m_shard{shard},
+      m_clock{std::move(clock)},
+      m_symbol_index{m_schema->GetFieldIndex(c_symbol)} {
+  if (m_symbol_index < 0) {
+    throw std::runtime_error{"cannot partition " + m_sink_name +
+                             " without a symbol column"};
+  }
+}
+
+partitioned_writer_t::~partitioned_writer_t() {
+  try {
+    close();
+  } catch (const std::exception& ex) {
+    BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << " failed to close "
+                             << m_sink_name << " partitions: " << ex.what();
+  }
+}
+
+void partitioned_writer_t::write(const arrow::RecordBatch& batch,
+                                 int64_t micros) {
+  const auto& symbols =
+      static_cast<const arrow::StringArray&>(*batch.column(m_symbol_index));
+
+  // Each symbol's row numbers, symbols in order of first appearance.
+  auto order = std::vector<std::string_view>{};
+  auto rows = std::unordered_map<std::string_view, arrow::Int64Builder>{};
+  for (int64_t idx = 0; idx < batch.num_rows(); ++idx) {
+    const auto symbol = symbols.GetView(idx);
+    const auto [it, inserted] = rows.try_emplace(symbol);
+    if (inserted) {
+      order.push_back(symbol);
+    }
+    PARQUET_THROW_NOT_OK(it->second.Append(idx));
+  }
+
+  if (order.size() == 1) {
+    // Shares the batch's columns rather than copying them.
+    buffer(std::string{order.front()},
+           arrow::RecordBatch::Make(batch.schema(), batch.num_rows(),
+                                    batch.columns()),
+           micros);
+  } else {
+    for (const auto symbol : order) {
+      std::shared_ptr<arrow::Array> indices;
+      PARQUET_THROW_NOT_OK(rows.at(symbol).Finish(&indices));
+      auto columns = std::vector<std::shared_ptr<arrow::Array>>{};
+      for (const auto& column : batch.columns()) {
+        PARQUET_ASSIGN_OR_THROW(auto taken,
+                                arrow::compute::Take(*column, *indices));
+        columns.push_back(std::move(taken));
+      }
+      buffer(std::string{symbol},
+             arrow::RecordBatch::Make(batch.schema(), indices->length(),
+                                      columns),
+             micros);
+    }
+  }
+
+  // The partitions holding most rows go first, so their parts are
+  // the largest they can be.
+  while (m_num_buffered_rows > m_max_buffered_rows) {
+    const auto largest = std::max_element(
+        m_partitions.begin(), m_partitions.end(),
+        [](const auto& lhs, const auto& rhs) {
+          return lhs.second.num_buffered_rows < rhs.second.num_buffered_rows;
+        });
+    flush(largest->second);
+  }
+}
+
+void partitioned_writer_t::close() {
+  // Those with a file open first, so that none has to be evicted.
+  while (!m_open.empty()) {
+    auto& partition = *m_open.front();
+    flush(partition);
+    close(partition);
+  }
+  for (auto& [dir, partition] : m_partitions) {
+    flush(partition);
+    close(partition);
+  }
+  m_partitions.clear();
+}
+
+void partitioned_writer_t::close_if_due() {
+  const auto now_micros = m_clock();
+  for (auto it = m_partitions.begin(); it != m_partitions.end();) {
+    auto& partition = it->second;
+    // Rows wait no longer than a file of theirs would stay open.
+    if (!partition.buffered.empty()) {
+      const auto boundary =
+          m_rotation.next_boundary(partition.buffered.front().second);
+      if (boundary && *boundary <= now_micros) {
+        flush(partition);
+      }
+    }
+    if (partition.writer) {
+      partition.writer->close_if_due();
+      if (partition.writer->filename().empty()) {
+        close(partition);
+      }
+    }
+    // Closed with nothing waiting: the next batch for it starts over.
+    if (!partition.writer && partition.buffered.empty()) {
+      it = m_partitions.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+std::string partitioned_writer_t::partition_dir(const std::string& parquet_dir,
+                                                const std::string& sink_name,
+                                                const std::string& symbol,
+                                                int64_t micros) {
+  // "BTC/USD" would be two directories.
+  auto symbol_str = symbol;
+  std::replace(symbol_str.begin(), symbol_str.end(), '/', '_');
+  const auto date = timestamp_t::to_iso_8601(micros).substr(0, 10);
+  return parquet_dir + "/" + sink_name + "/symbol=" + symbol_str +
+         "/date=" + date;
+}
+
+void partitioned_writer_t::buffer(const std::string& symbol,
+                                  std::shared_ptr<arrow::RecordBatch> batch,
+                                  int64_t micros) {
+  // The date is the batch's, whatever file names it takes below.
+  auto dir = partition_dir(m_parquet_dir, m_sink_name, symbol, micros);
+  auto& partition = m_partitions[dir];
+  if (partition.dir.empty()) {
+    partition.symbol = symbol;
+    partition.dir = std::move(dir);
+  }
+  const auto num_rows = batch->num_rows();
+  partition.buffered.emplace_back(std::move(batch), micros);
+  partition.num_buffered_rows += num_rows;
+  m_num_buffered_rows += num_rows;
+  if (partition.num_buffered_rows >= m_flush_rows) {
+    flush(partition);
+  }
+}
+
+void partitioned_writer_t::flush(partition_t& partition) {
+  if (partition.buffered.empty()) {
+    return;
+  }
+  // Dropped rather than retried if writing fails.
+  const auto buffered = std::move(partition.buffered);
+  partition.buffered.clear();
+  m_num_buffered_rows -= partition.num_buffered_rows;
+  partition.num_buffered_rows = 0;
+
+  auto& writer = open(partition, buffered.front().second);
+  for (const auto& [batch, micros] : buffered) {
+    writer.write(*batch, micros);
+  }
+}
+
+writer_t& partitioned_writer_t::open(partition_t& partition, int64_t micros) {
+  if (partition.writer) {
+    m_open.splice(m_open.begin(), m_open, partition.lru);
+    return *partition.writer;
+  }
+
+  if (m_max_open > 0 && m_open.size() >= m_max_open) {
+    // Any rows it still has wait for it to reopen.
+    ++m_num_evictions;
+    close(*m_open.back());
+  }
+
+  // Names only have to differ within the symbol's directories, so
+  // each symbol counts its own starts: a part closed and reopened
+  // within the same microsecond must not reuse its file's name.
+  auto& last_start_micros = m_last_start_micros[partition.symbol];
+  const auto filename = [this, dir = partition.dir, &last_start_micros](
+                            int64_t start_micros) {
+    std::filesystem::create_directories(dir);
+    last_start_micros = std::max(last_start_micros, start_micros);
+    const auto shard_str = m_shard ? "." + std::to_string(*m_shard) : "";
+    return dir + "/part-" + std::to_string(start_micros) + shard_str + ".pq";
+  };
+  const auto start_micros = std::max(micros, last_start_micros + 1);
+
+  partition.writer = std::make_unique<writer_t>(
+      filename, m_schema, start_micros, m_rotation, m_properties, m_clock);
+  partition.lru = m_open.insert(m_open.begin(), &partition);
+  return *partition.writer;
+}
+
+void partitioned_writer_t::close(partition_t& partition) {
+  if (!partition.writer) {
+    return;
+  }
+  m_open.erase(partition.lru);
+  const auto writer = std::move(partition.writer);
+  writer->close();
+}
+
+}  // namespace pq
+}  // namespace kdr
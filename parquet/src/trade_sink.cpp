@@ -1,15 +1,47 @@
 #include "trade_sink.hpp"
 
+#include <pair.hpp>
+
 #include <arrow/scalar.h>
 #include <boost/log/trivial.hpp>
 
+#include <limits>
+
 namespace kdr {
 namespace pq {
 
-trades_sink_t::trades_sink_t(std::string parquet_dir, sink_id_t id)
-    : m_schema{schema()},
-      m_sink_filename{parquet_filename(parquet_dir, c_sink_name, id)},
-      m_writer{m_sink_filename, m_schema} {}
+trades_sink_t::trades_sink_t(std::string parquet_dir,
+                             sink_id_t id,
+                             model::price_format_t price_format,
+                             async_writer_t& async_writer,
+                             rotation_t rotation,
+                             partitioning_t partitioning,
+                             const writer_properties_t& properties,
+                             std::optional<size_t> shard)
+    : m_price_format{price_format},
+      m_schema{schema(price_format)},
+      m_async_writer{async_writer},
+      m_rotation{rotation},
+      m_price_column{price_format},
+      m_qty_column{price_format} {
+  if (partitioning.by_symbol) {
+    m_partitioned_writer.emplace(parquet_dir, c_sink_name, m_schema, rotation,
+                                 properties, partitioning, shard);
+  } else {
+    m_writer.emplace(
+        [parquet_dir, shard](int64_t start_micros) {
+          return parquet_filename(parquet_dir, c_sink_name, start_micros,
+                                  shard);
+        },
+        m_schema, id, rotation, properties);
+  }
+  if (m_partitioned_writer) {
+    m_rotation = m_partitioned_writer->rotation();
+    m_async_writer.add(*m_partitioned_writer);
+  } else {
+    m_async_writer.add(*m_writer);
+  }
+}
 
 trades_sink_t::~trades_sink_t() {
   try {
@@ -17,10 +49,25 @@ trades_sink_t::~trades_sink_t() {
   } catch (const std::exception& ex) {
     BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << " failed to flush() sink";
   }
+  // Queued batches refer to the writers.
+  try {
+    m_async_writer.drain();
+  } catch (const std::exception& ex) {
+    BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << " failed to write batches: "
+                             << ex.what();
+  }
+  if (m_partitioned_writer) {
+    m_async_writer.remove(*m_partitioned_writer);
+  } else {
+    m_async_writer.remove(*m_writer);
+  }
 }
 
 void trades_sink_t::accept(const response::trades_t& trades,
                            const model::refdata_t& refdata) {
+  // Anything that can reject a trade does so before the first append,
+  // so that the message goes in whole or not at all.
+  m_precisions.clear();
   for (const auto& trade : trades) {
     const std::optional<model::refdata_t::pair_precision_t> precision{
         refdata.pair_precision(trade.symbol())};
@@ -30,22 +77,34 @@ void trades_sink_t::accept(const response::trades_t& trades,
       BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << msg;
       throw std::runtime_error{msg};
     }
+    m_price_column.check(trade.price(), precision->price_precision);
+    m_qty_column.check(trade.qty(), precision->qty_precision);
+    m_precisions.push_back(*precision);
+  }
 
+  next_row(trades.header().recv_tm().micros());
+  auto precision = m_precisions.cbegin();
+  for (const auto& trade : trades) {
     PARQUET_THROW_NOT_OK(
         m_recv_tm_builder.Append(trades.header().recv_tm().micros()));
     PARQUET_THROW_NOT_OK(
         m_ord_type_builder.Append(std::string(1, trade.ord_type())));
-    PARQUET_THROW_NOT_OK(
-        m_price_builder.Append(trade.price().str(precision->price_precision)));
-    PARQUET_THROW_NOT_OK(
-        m_qty_builder.Append(trade.qty().str(precision->qty_precision)));
+    m_price_column.append(trade.price(), precision->price_precision);
+    m_qty_column.append(trade.qty(), precision->qty_precision);
     PARQUET_THROW_NOT_OK(m_side_builder.Append(std::string(1, trade.side())));
     PARQUET_THROW_NOT_OK(m_symbol_builder.Append(trade.symbol()));
     PARQUET_THROW_NOT_OK(
         m_timestamp_builder.Append(trade.timestamp().micros()));
     PARQUET_THROW_NOT_OK(m_trade_id_builder.Append(trade.trade_id()));
+    if (m_price_format == model::price_format_int64) {
+      PARQUET_THROW_NOT_OK(m_price_precision_builder.Append(
+          static_cast<int8_t>(precision->price_precision)));
+      PARQUET_THROW_NOT_OK(m_qty_precision_builder.Append(
+          static_cast<int8_t>(precision->qty_precision)));
+    }
 
     ++m_num_rows;
+    ++precision;
   }
 
   if (m_num_rows >= c_flush_threshold) {
@@ -53,7 +112,21 @@ void trades_sink_t::accept(const response::trades_t& trades,
   }
 }
 
+void trades_sink_t::next_row(int64_t recv_tm) {
+  if (m_num_rows > 0 && recv_tm >= m_batch_ends_micros) {
+    flush();
+  }
+  if (m_num_rows == 0) {
+    m_batch_micros = recv_tm;
+    m_batch_ends_micros = m_rotation.next_boundary(recv_tm).value_or(
+        std::numeric_limits<int64_t>::max());
+  }
+}
+
 void trades_sink_t::flush() {
+  if (m_num_rows == 0) {
+    return;
+  }
   std::shared_ptr<arrow::Array> recv_tm_array;
   std::shared_ptr<arrow::Array> ord_type_array;
   std::shared_ptr<arrow::Array> price_array;
@@ -65,8 +138,8 @@ void trades_sink_t::flush() {
 
   PARQUET_THROW_NOT_OK(m_recv_tm_builder.Finish(&recv_tm_array));
   PARQUET_THROW_NOT_OK(m_ord_type_builder.Finish(&ord_type_array));
-  PARQUET_THROW_NOT_OK(m_price_builder.Finish(&price_array));
-  PARQUET_THROW_NOT_OK(m_qty_builder.Finish(&qty_array));
+  m_price_column.finish(&price_array);
+  m_qty_column.finish(&qty_array);
   PARQUET_THROW_NOT_OK(m_side_builder.Finish(&side_array));
   PARQUET_THROW_NOT_OK(m_symbol_builder.Finish(&symbol_array));
   PARQUET_THROW_NOT_OK(m_timestamp_builder.Finish(&timestamp_array));
@@ -76,24 +149,52 @@ void trades_sink_t::flush() {
       recv_tm_array, ord_type_array, price_array,     qty_array,
       side_array,    symbol_array,   timestamp_array, trade_id_array,
   };
+  if (m_price_format == model::price_format_int64) {
+    std::shared_ptr<arrow::Array> price_precision_array;
+    std::shared_ptr<arrow::Array> qty_precision_array;
+    PARQUET_THROW_NOT_OK(
+        m_price_precision_builder.Finish(&price_precision_array));
+    PARQUET_THROW_NOT_OK(m_qty_precision_builder.Finish(&qty_precision_array));
+    columns.push_back(price_precision_array);
+    columns.push_back(qty_precision_array);
+  }
 
   std::shared_ptr<arrow::RecordBatch> batch =
       arrow::RecordBatch::Make(m_schema, m_num_rows, columns);
-  PARQUET_THROW_NOT_OK(m_writer.arrow_file_writer().WriteRecordBatch(*batch));
-
+  // The builders are empty now, whatever becomes of the batch.
   m_num_rows = 0;
+
+  // A failed write (this batch's, inline, or an earlier one's from the
+  // writer thread) is the writer's, not the row being added's: it is
+  // counted in writer_errors and logged, and recording carries on.
+  try {
+    if (m_partitioned_writer) {
+      m_async_writer.write(*m_partitioned_writer, std::move(batch),
+                           m_batch_micros);
+    } else {
+      m_async_writer.write(*m_writer, std::move(batch), m_batch_micros);
+    }
+  } catch (const std::exception& ex) {
+    BOOST_LOG_TRIVIAL(error)
+        << __FUNCTION__ << " failed to write batch: " << ex.what();
+  }
 }
 
-std::shared_ptr<arrow::Schema> trades_sink_t::schema() {
+std::shared_ptr<arrow::Schema> trades_sink_t::schema(
+    model::price_format_t price_format) {
   // TODO: add KeyValueMetadata for enum fields
+  auto metadata = std::make_shared<arrow::KeyValueMetadata>();
+  decimal_column_t::append_metadata(price_format, *metadata);
 
   auto field_vector = arrow::FieldVector{
       arrow::field(std::string{response::header_t::c_recv_tm}, arrow::int64(),
                    false),  // TODO: replace with timestamp type
       arrow::field(std::string{model::trade_t::c_ord_type}, arrow::utf8(),
                    false),
-      arrow::field(std::string{model::trade_t::c_price}, arrow::utf8(), false),
-      arrow::field(std::string{model::trade_t::c_qty}, arrow::utf8(), false),
+      arrow::field(std::string{model::trade_t::c_price},
+                   decimal_column_t::type(price_format), false),
+      arrow::field(std::string{model::trade_t::c_qty},
+                   decimal_column_t::type(price_format), false),
       arrow::field(std::string{model::trade_t::c_side}, arrow::utf8(), false),
       arrow::field(std::string{model::trade_t::c_symbol}, arrow::utf8(), false),
       arrow::field(std::string{model::trade_t::c_timestamp}, arrow::int64(),
@@ -101,7 +202,14 @@ std::shared_ptr<arrow::Schema> trades_sink_t::schema() {
       arrow::field(std::string{model::trade_t::c_trade_id}, arrow::uint64(),
                    false),
   };
-  return arrow::schema(field_vector);
+  if (price_format == model::price_format_int64) {
+    field_vector.push_back(
+        arrow::field(std::string{model::pair_t::c_price_precision},
+                     arrow::int8(), false));
+    field_vector.push_back(arrow::field(
+        std::string{model::pair_t::c_qty_precision}, arrow::int8(), false));
+  }
+  return arrow::schema(field_vector)->WithMetadata(metadata);
 }
 
 }  // namespace pq
@@ -0,0 +1,24 @@
+#include "alloc_counter.hpp"
+
+namespace {
+
+// Plain integers, so neither needs a TLS guard nor can itself
+// allocate.
+thread_local constinit size_t t_num_allocs = 0;
+thread_local constinit size_t t_num_frees = 0;
+
+} // namespace
+
+namespace kdr {
+
+size_t thread_allocs() { return t_num_allocs; }
+size_t thread_frees() { return t_num_frees; }
+
+namespace detail {
+
+void count_alloc() noexcept { ++t_num_allocs; }
+void count_free() noexcept { ++t_num_frees; }
+
+} // namespace detail
+
+} // namespace kdr
@@ -0,0 +1,50 @@
+#include "alloc_counter.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+void *allocate(size_t size) {
+  kdr::detail::count_alloc();
+  if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc{};
+}
+
+void *allocate(size_t size, std::align_val_t align) {
+  kdr::detail::count_alloc();
+  const auto alignment = static_cast<size_t>(align);
+  // aligned_alloc() wants a size that is a multiple of the alignment.
+  const auto rounded = (size + alignment - 1) / alignment * alignment;
+  if (void *ptr = std::aligned_alloc(alignment, rounded == 0 ? alignment
+                                                             : rounded)) {
+    return ptr;
+  }
+  throw std::bad_alloc{};
+}
+
+void deallocate(void *ptr) noexcept {
+  if (ptr) {
+    kdr::detail::count_free();
+    std::free(ptr);
+  }
+}
+
+} // namespace
+
+// The array and nothrow forms of the standard library's defaults
+// forward to these, so replacing these covers every form.
+
+void *operator new(size_t size) { return allocate(size); }
+void *operator new(size_t size, std::align_val_t align) {
+  return allocate(size, align);
+}
+
+void operator delete(void *ptr) noexcept { deallocate(ptr); }
+void operator delete(void *ptr, size_t) noexcept { deallocate(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { deallocate(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept {
+  deallocate(ptr);
+}
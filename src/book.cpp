@@ -43,28 +43,20 @@ const std::string_view book_t::c_symbol{c_symbol_field.data(),
 const std::string_view book_t::c_timestamp{c_timestamp_field.data(),
                                            c_timestamp_field.size() - 1};
 
-static constexpr auto c_snapshot_value = std::to_array("snapshot");
-static constexpr auto c_update_value = std::to_array("update");
-
-const std::string_view book_t::c_snapshot{c_snapshot_value.data(),
-                                          c_snapshot_value.size() - 1};
-const std::string_view book_t::c_update{c_update_value.data(),
-                                        c_update_value.size() - 1};
-
-book_t::book_t(const header_t &header, const asks_t &asks, const bids_t &bids,
-               uint64_t crc32, std::string symbol, timestamp_t timestamp)
-    : m_header(header), m_asks(asks), m_bids(bids), m_crc32(crc32),
-      m_symbol(std::move(symbol)), m_timestamp(timestamp) {}
+namespace {
 
-book_t book_t::from_json(simdjson::ondemand::document &response) {
-  auto result = book_t{};
+/** stream_json(), with the symbol's id from `find_id`. */
+template <typename F>
+void stream_book_json(simdjson::ondemand::document &response,
+                      timestamp_t recv_tm, const F &find_id,
+                      const book_stream_t &stream) {
   auto buffer = std::string_view{};
 
-  buffer = response[header_t::c_channel].get_string();
-  const auto channel = std::string{buffer.begin(), buffer.end()};
+  // Only book messages are routed here, so the channel is known.
   buffer = response[header_t::c_type].get_string();
-  const auto type = std::string{buffer.begin(), buffer.end()};
-  result.m_header = header_t{timestamp_t::now(), channel, type};
+  const auto header = header_t{recv_tm, model::channel_book,
+                               model::str_view_to_msg_type_t(buffer)};
+  const auto is_update = header.type() == model::msg_type_update;
 
   // TODO: it is entirely unclear to me why `data` is an array since
   // it only ever seems to contain a single entry.
@@ -76,37 +68,106 @@ book_t book_t::from_json(simdjson::ondemand::document &response) {
     }
     processed = true;
 
-    // TODO: eliminate duplication
-    for (simdjson::fallback::ondemand::object obj : data[c_asks]) {
-      const auto price = extract_decimal(obj, c_price);
-      const auto qty = extract_decimal(obj, c_qty);
-      const ask_t ask = std::make_pair(price, qty);
-      result.m_asks.push_back(ask);
+    // Consumers need the symbol before any levels. The venue sends it
+    // first, so this lookup is cheap, after which we rewind and walk
+    // the fields in whatever order they arrive.
+    simdjson::ondemand::object obj = data.get_object();
+    buffer = obj[book_t::c_symbol].get_string();
+    const auto symbol = std::string{buffer.begin(), buffer.end()};
+    if (!stream.begin(header, find_id(symbol), symbol)) {
+      return;
+    }
+    if (obj.reset().error() != simdjson::SUCCESS) {
+      throw std::runtime_error("failed to rewind book data for: " + symbol);
     }
 
-    for (simdjson::fallback::ondemand::object obj : data[c_bids]) {
-      const auto price = extract_decimal(obj, c_price);
-      const auto qty = extract_decimal(obj, c_qty);
-      const bid_t bid = std::make_pair(price, qty);
-      result.m_bids.push_back(bid);
+    auto crc32 = uint64_t{0};
+    auto timestamp = timestamp_t{};
+    for (auto field : obj) {
+      const std::string_view key = field.unescaped_key();
+      if (key == book_t::c_bids) {
+        for (simdjson::ondemand::object quote : field.value().get_array()) {
+          const auto price = extract_decimal(quote, book_t::c_price);
+          const auto qty = extract_decimal(quote, book_t::c_qty);
+          stream.accept_bid(std::make_pair(price, qty));
+        }
+      } else if (key == book_t::c_asks) {
+        for (simdjson::ondemand::object quote : field.value().get_array()) {
+          const auto price = extract_decimal(quote, book_t::c_price);
+          const auto qty = extract_decimal(quote, book_t::c_qty);
+          stream.accept_ask(std::make_pair(price, qty));
+        }
+      } else if (key == book_t::c_checksum) {
+        crc32 = field.value().get_uint64();
+      } else if (key == book_t::c_timestamp && is_update) {
+        buffer = field.value().get_string();
+        timestamp = timestamp_t::from_iso_8601(buffer);
+      }
     }
+    stream.end(symbol, crc32, timestamp);
+  }
+}
 
-    result.m_crc32 = data[c_checksum].get_uint64();
+} // namespace
 
-    buffer = data[c_symbol].get_string();
-    const auto symbol = std::string{buffer.begin(), buffer.end()};
-    result.m_symbol = symbol;
+book_t::book_t(const header_t &header, const asks_t &asks, const bids_t &bids,
+               uint64_t crc32, std::string symbol, timestamp_t timestamp)
+    : m_header(header), m_asks(asks), m_bids(bids), m_crc32(crc32),
+      m_symbol(std::move(symbol)), m_timestamp(timestamp) {}
 
-    if (type == c_update) {
-      buffer = data[c_timestamp].get_string();
-      result.m_timestamp =
-          timestamp_t::from_iso_8601(std::string{buffer.data(), buffer.size()});
-    }
-  }
+book_t book_t::gap(std::string symbol, timestamp_t recv_tm) {
+  const auto header =
+      header_t{recv_tm, model::channel_book, model::msg_type_gap};
+  return book_t{header, asks_t{}, bids_t{}, 0, std::move(symbol), recv_tm};
+}
 
+book_t book_t::from_json(simdjson::ondemand::document &response,
+                         timestamp_t recv_tm) {
+  auto result = book_t{};
+  const auto stream = book_stream_t{
+      [&result](const header_t &header, symbol_id_t,
+                const std::string &symbol) {
+        result.m_header = header;
+        result.m_symbol = symbol;
+        return true;
+      },
+      [&result](const bid_t &bid) { result.m_bids.push_back(bid); },
+      [&result](const ask_t &ask) { result.m_asks.push_back(ask); },
+      [&result](const std::string &, uint64_t crc32, timestamp_t timestamp) {
+        result.m_crc32 = crc32;
+        result.m_timestamp = timestamp;
+      }};
+  // book_t keeps the symbol itself, so needs no id for it.
+  stream_book_json(
+      response, recv_tm, [](const std::string &) { return symbol_id_t{}; },
+      stream);
   return result;
 }
 
+void book_t::stream_json(simdjson::ondemand::document &response,
+                         timestamp_t recv_tm,
+                         const model::symbol_table_t &symbols,
+                         const book_stream_t &stream) {
+  stream_book_json(
+      response, recv_tm,
+      [&symbols](const std::string &symbol) { return symbols.id(symbol); },
+      stream);
+}
+
+void book_t::stream(const model::symbol_table_t &symbols,
+                    const book_stream_t &stream) const {
+  if (!stream.begin(m_header, symbols.id(m_symbol), m_symbol)) {
+    return;
+  }
+  for (const auto &bid : m_bids) {
+    stream.accept_bid(bid);
+  }
+  for (const auto &ask : m_asks) {
+    stream.accept_ask(ask);
+  }
+  stream.end(m_symbol, m_crc32, m_timestamp);
+}
+
 boost::json::object book_t::to_json_obj(integer_t price_precision,
                                         integer_t qty_precision) const {
   auto asks = boost::json::array();
@@ -137,9 +198,10 @@ boost::json::object book_t::to_json_obj(integer_t price_precision,
   auto data = boost::json::array();
   data.push_back(content);
 
-  const boost::json::object result = {{header_t::c_channel, m_header.channel()},
-                                      {c_response_data, data},
-                                      {header_t::c_type, m_header.type()}};
+  const boost::json::object result = {
+      {header_t::c_channel, model::channel_t_to_str(m_header.channel())},
+      {c_response_data, data},
+      {header_t::c_type, model::msg_type_t_to_str(m_header.type())}};
 
   return result;
 }
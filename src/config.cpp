@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <array>
+#include <iterator>
 
 namespace {
 
@@ -20,16 +21,55 @@ boost::json::object config_t::to_json_obj() const {
       std::back_inserter(pair_filter_array),
       [](const std::string &pair) { return boost::json::string{pair}; });
 
+  auto priority_pairs_array = boost::json::array{};
+  std::transform(
+      priority_pairs().begin(), priority_pairs().end(),
+      std::back_inserter(priority_pairs_array),
+      [](const std::string &pair) { return boost::json::string{pair}; });
+
+  auto column_compression_array = boost::json::array{};
+  std::transform(
+      parquet_column_compression().begin(),
+      parquet_column_compression().end(),
+      std::back_inserter(column_compression_array),
+      [](const std::string &column) { return boost::json::string{column}; });
+
+  auto cpu_affinity_array = boost::json::array{};
+  std::copy(cpu_affinity().begin(), cpu_affinity().end(),
+            std::back_inserter(cpu_affinity_array));
+
   const boost::json::object result = {
       {c_book_depth, book_depth()},
       {c_capture_book, capture_book()},
       {c_capture_trades, capture_trades()},
+      {c_cpu_affinity, cpu_affinity_array},
       {c_enable_shmem, enable_shmem()},
+      {c_io_thread, io_thread()},
       {c_kraken_host, kraken_host()},
       {c_kraken_port, kraken_port()},
+      {c_max_open_partitions, max_open_partitions()},
+      {c_num_shards, num_shards()},
       {c_pair_filter, pair_filter_array},
+      {c_parquet_byte_stream_split, parquet_byte_stream_split()},
+      {c_parquet_column_compression, column_compression_array},
+      {c_parquet_compression, parquet_compression()},
+      {c_parquet_data_page_size, parquet_data_page_size()},
+      {c_parquet_delta_encoding, parquet_delta_encoding()},
+      {c_parquet_dictionary, parquet_dictionary()},
       {c_parquet_dir, parquet_dir()},
+      {c_parquet_row_group_size, parquet_row_group_size()},
+      {c_partition_by_symbol, partition_by_symbol()},
       {c_ping_interval_secs, ping_interval_secs()},
+      {c_price_format, model::price_format_t_to_str(price_format())},
+      {c_priority_pairs, priority_pairs_array},
+      {c_reconnect, reconnect()},
+      {c_rotate_interval_secs, rotate_interval_secs()},
+      {c_rotate_size_mb, rotate_size_mb()},
+      {c_subscribe_batch_size, subscribe_batch_size()},
+      {c_subscribe_max_in_flight, subscribe_max_in_flight()},
+      {c_subscribe_rate, subscribe_rate()},
+      {c_subscribe_timeout_secs, subscribe_timeout_secs()},
+      {c_writer_queue_size, writer_queue_size()},
   };
   return result;
 }
@@ -60,6 +100,103 @@ config_t config_t::from_json(simdjson::ondemand::document &doc) {
     result.m_book_depth = model::depth_t{val};
   }
 
+  if (doc[c_io_thread].get(optional_val) == simdjson::SUCCESS) {
+    result.m_io_thread = optional_val.get_bool();
+  }
+
+  if (doc[c_reconnect].get(optional_val) == simdjson::SUCCESS) {
+    result.m_reconnect = optional_val.get_bool();
+  }
+
+  if (doc[c_num_shards].get(optional_val) == simdjson::SUCCESS) {
+    result.set_num_shards(optional_val.get_uint64());
+  }
+
+  if (doc[c_cpu_affinity].get(optional_val) == simdjson::SUCCESS) {
+    for (int64_t cpu : optional_val.get_array()) {
+      result.m_cpu_affinity.push_back(static_cast<int>(cpu));
+    }
+  }
+
+  if (doc[c_subscribe_batch_size].get(optional_val) == simdjson::SUCCESS) {
+    result.set_subscribe_batch_size(optional_val.get_uint64());
+  }
+
+  if (doc[c_subscribe_max_in_flight].get(optional_val) == simdjson::SUCCESS) {
+    result.set_subscribe_max_in_flight(optional_val.get_uint64());
+  }
+
+  if (doc[c_subscribe_rate].get(optional_val) == simdjson::SUCCESS) {
+    result.m_subscribe_rate = optional_val.get_uint64();
+  }
+
+  if (doc[c_subscribe_timeout_secs].get(optional_val) == simdjson::SUCCESS) {
+    result.m_subscribe_timeout_secs = optional_val.get_uint64();
+  }
+
+  if (doc[c_priority_pairs].get(optional_val) == simdjson::SUCCESS) {
+    for (std::string_view pair : optional_val.get_array()) {
+      result.m_priority_pairs.push_back(::to_string(pair));
+    }
+  }
+
+  if (doc[c_price_format].get(optional_val) == simdjson::SUCCESS) {
+    result.set_price_format(
+        model::str_view_to_price_format_t(optional_val.get_string()));
+  }
+
+  if (doc[c_writer_queue_size].get(optional_val) == simdjson::SUCCESS) {
+    result.m_writer_queue_size = optional_val.get_uint64();
+  }
+
+  if (doc[c_rotate_interval_secs].get(optional_val) == simdjson::SUCCESS) {
+    result.m_rotate_interval_secs = optional_val.get_uint64();
+  }
+
+  if (doc[c_rotate_size_mb].get(optional_val) == simdjson::SUCCESS) {
+    result.m_rotate_size_mb = optional_val.get_uint64();
+  }
+
+  if (doc[c_partition_by_symbol].get(optional_val) == simdjson::SUCCESS) {
+    result.m_partition_by_symbol = optional_val.get_bool();
+  }
+
+  if (doc[c_max_open_partitions].get(optional_val) == simdjson::SUCCESS) {
+    result.set_max_open_partitions(optional_val.get_uint64());
+  }
+
+  if (doc[c_parquet_compression].get(optional_val) == simdjson::SUCCESS) {
+    result.m_parquet_compression = ::to_string(optional_val.get_string());
+  }
+
+  if (doc[c_parquet_column_compression].get(optional_val) ==
+      simdjson::SUCCESS) {
+    for (std::string_view column : optional_val.get_array()) {
+      result.m_parquet_column_compression.push_back(::to_string(column));
+    }
+  }
+
+  if (doc[c_parquet_dictionary].get(optional_val) == simdjson::SUCCESS) {
+    result.m_parquet_dictionary = optional_val.get_bool();
+  }
+
+  if (doc[c_parquet_delta_encoding].get(optional_val) == simdjson::SUCCESS) {
+    result.m_parquet_delta_encoding = optional_val.get_bool();
+  }
+
+  if (doc[c_parquet_byte_stream_split].get(optional_val) ==
+      simdjson::SUCCESS) {
+    result.m_parquet_byte_stream_split = optional_val.get_bool();
+  }
+
+  if (doc[c_parquet_row_group_size].get(optional_val) == simdjson::SUCCESS) {
+    result.set_parquet_row_group_size(optional_val.get_uint64());
+  }
+
+  if (doc[c_parquet_data_page_size].get(optional_val) == simdjson::SUCCESS) {
+    result.set_parquet_data_page_size(optional_val.get_uint64());
+  }
+
   return result;
 }
 
@@ -0,0 +1,180 @@
+#include "crc32.hpp"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define KDR_CRC32_CLMUL 1
+#include <immintrin.h>
+#else
+#define KDR_CRC32_CLMUL 0
+#endif
+
+namespace {
+
+constexpr uint32_t c_polynomial = 0xedb88320;
+
+using table_t = std::array<std::array<uint32_t, 256>, 8>;
+
+/** c_tables[k][b] is the CRC of byte b followed by k zero bytes. */
+constexpr table_t c_tables = [] {
+  auto result = table_t{};
+  for (uint32_t byte = 0; byte < 256; ++byte) {
+    auto crc = byte;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ (crc & 1 ? c_polynomial : 0);
+    }
+    result[0][byte] = crc;
+  }
+  for (size_t slice = 1; slice < result.size(); ++slice) {
+    for (size_t byte = 0; byte < 256; ++byte) {
+      const auto prev = result[slice - 1][byte];
+      result[slice][byte] = (prev >> 8) ^ result[0][prev & 0xff];
+    }
+  }
+  return result;
+}();
+
+#if KDR_CRC32_CLMUL
+
+const bool c_have_clmul = [] {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+}();
+
+/** Multiply `acc` forward by the distance in `keys` and add `next`. */
+__attribute__((target("pclmul,sse4.1"))) inline __m128i
+fold(__m128i acc, __m128i keys, __m128i next) {
+  const auto lo = _mm_clmulepi64_si128(acc, keys, 0x00);
+  const auto hi = _mm_clmulepi64_si128(acc, keys, 0x11);
+  return _mm_xor_si128(_mm_xor_si128(hi, lo), next);
+}
+
+/**
+ * Fold 64 bytes at a time in four lanes, then those lanes into one,
+ * then 16 bytes at a time, and finish with a Barrett reduction: the
+ * method of Gopal et al., "Fast CRC Computation for Generic
+ * Polynomials Using PCLMULQDQ Instruction", with its constants for
+ * the reflected IEEE polynomial.
+ */
+__attribute__((target("pclmul,sse4.1"))) uint32_t
+update_clmul(uint32_t state, const unsigned char *bytes, size_t size) {
+  alignas(16) static constexpr uint64_t c_k1k2[] = {0x0154442bd4,
+                                                     0x01c6e41596};
+  alignas(16) static constexpr uint64_t c_k3k4[] = {0x01751997d0,
+                                                     0x00ccaa009e};
+  alignas(16) static constexpr uint64_t c_k5k0[] = {0x0163cd6124,
+                                                     0x0000000000};
+  alignas(16) static constexpr uint64_t c_poly[] = {0x01db710641,
+                                                     0x01f7011641};
+
+  const auto load = [](const unsigned char *ptr) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+  };
+
+  auto x1 = _mm_xor_si128(load(bytes), _mm_cvtsi32_si128(int(state)));
+  auto x2 = load(bytes + 16);
+  auto x3 = load(bytes + 32);
+  auto x4 = load(bytes + 48);
+  bytes += 64;
+  size -= 64;
+
+  auto keys = _mm_load_si128(reinterpret_cast<const __m128i *>(c_k1k2));
+  for (; size >= 64; size -= 64, bytes += 64) {
+    x1 = fold(x1, keys, load(bytes));
+    x2 = fold(x2, keys, load(bytes + 16));
+    x3 = fold(x3, keys, load(bytes + 32));
+    x4 = fold(x4, keys, load(bytes + 48));
+  }
+
+  keys = _mm_load_si128(reinterpret_cast<const __m128i *>(c_k3k4));
+  x1 = fold(x1, keys, x2);
+  x1 = fold(x1, keys, x3);
+  x1 = fold(x1, keys, x4);
+  for (; size >= 16; size -= 16, bytes += 16) {
+    x1 = fold(x1, keys, load(bytes));
+  }
+
+  // 128 bits to 64.
+  const auto mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+  x2 = _mm_clmulepi64_si128(x1, keys, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+  keys = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(c_k5k0));
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), keys, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  // Barrett reduction to 32 bits.
+  keys = _mm_load_si128(reinterpret_cast<const __m128i *>(c_poly));
+  x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), keys, 0x10);
+  x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask32), keys, 0x00);
+  return uint32_t(_mm_extract_epi32(_mm_xor_si128(x1, x2), 1));
+}
+
+#endif
+
+} // namespace
+
+namespace kdr {
+
+void crc32_t::process_bytes(const void *data, size_t size) {
+#if KDR_CRC32_CLMUL
+  if (c_have_clmul && size >= c_min_clmul_size) {
+    const auto folded = size & ~size_t{15};
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    m_state = ::update_clmul(m_state, bytes, folded);
+    m_state = update_table(m_state, bytes + folded, size - folded);
+    return;
+  }
+#endif
+  m_state = update_table(m_state, data, size);
+}
+
+bool crc32_t::have_clmul() {
+#if KDR_CRC32_CLMUL
+  return c_have_clmul;
+#else
+  return false;
+#endif
+}
+
+uint32_t crc32_t::update_clmul(uint32_t state, const void *data,
+                               size_t size) {
+  if (!have_clmul() || size < c_min_clmul_size || size % 16 != 0) {
+    throw std::runtime_error("crc32_t::update_clmul bogus call, size: " +
+                             std::to_string(size));
+  }
+#if KDR_CRC32_CLMUL
+  return ::update_clmul(state, static_cast<const unsigned char *>(data),
+                        size);
+#else
+  (void)data;
+  return state;
+#endif
+}
+
+uint32_t crc32_t::update_table(uint32_t state, const void *data,
+                               size_t size) {
+  const auto *bytes = static_cast<const unsigned char *>(data);
+  auto crc = state;
+  for (; size >= 8; size -= 8, bytes += 8) {
+    // Little-endian loads, as on every platform kdr targets.
+    uint32_t lo;
+    uint32_t hi;
+    std::memcpy(&lo, bytes, sizeof(lo));
+    std::memcpy(&hi, bytes + 4, sizeof(hi));
+    lo ^= crc;
+    crc = c_tables[7][lo & 0xff] ^ c_tables[6][(lo >> 8) & 0xff] ^
+          c_tables[5][(lo >> 16) & 0xff] ^ c_tables[4][lo >> 24] ^
+          c_tables[3][hi & 0xff] ^ c_tables[2][(hi >> 8) & 0xff] ^
+          c_tables[1][(hi >> 16) & 0xff] ^ c_tables[0][hi >> 24];
+  }
+  for (; size > 0; --size, ++bytes) {
+    crc = (crc >> 8) ^ c_tables[0][(crc ^ *bytes) & 0xff];
+  }
+  return crc;
+}
+
+} // namespace kdr
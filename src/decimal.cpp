@@ -1,145 +1,407 @@
 #include "decimal.hpp"
 
-#include <cassert>
-#include <cstdlib>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <limits>
 #include <sstream>
+#include <stdexcept>
 
-#include <iostream> // !@#
+#if defined(__x86_64__) && defined(__GNUC__)
+#define KDR_DECIMAL_SSE41 1
+#include <immintrin.h>
+#else
+#define KDR_DECIMAL_SSE41 0
+#endif
 
 namespace {
-uint64_t to_int(std::string_view view) {
-  uint64_t result = 0;
-  for (const char ch : view) {
-    result *= 10;
-    result += ch - '0';
+
+constexpr std::array<uint64_t, 20> c_pow10 = [] {
+  auto result = std::array<uint64_t, 20>{};
+  uint64_t value = 1;
+  for (auto &pow : result) {
+    pow = value;
+    value *= 10;
   }
   return result;
-}
+}();
 
-} // namespace
+constexpr uint64_t c_max_mantissa =
+    uint64_t(std::numeric_limits<int64_t>::max());
 
-namespace kdr {
+bool is_digit(char ch) { return ch >= '0' && ch <= '9'; }
 
-auto decimal_t::operator<=>(const decimal_t &rhs) const {
-  const std::string_view lhs_int_view = int_part();
-  const std::string_view rhs_int_view = rhs.int_part();
-  const auto lhs_int = to_int(lhs_int_view);
-  const auto rhs_int = to_int(rhs_int_view);
-  auto result = lhs_int <=> rhs_int;
-  if (result != std::strong_ordering::equal) {
-    return result;
-  }
-
-  const std::string_view lhs_frac_view = frac_part();
-  const std::string_view rhs_frac_view = rhs.frac_part();
-  const auto size = std::max(lhs_frac_view.size(), rhs_frac_view.size());
-  for (size_t idx = 0; idx < size; ++idx) {
-    const auto lhs_digit =
-        idx < lhs_frac_view.size() ? (lhs_frac_view[idx] - '0') : 0;
-    const auto rhs_digit =
-        idx < rhs_frac_view.size() ? (rhs_frac_view[idx] - '0') : 0;
-    result = lhs_digit <=> rhs_digit;
-    if (result != std::strong_ordering::equal) {
-      return result;
+/** Multiply by 10^num_digits, refusing to leave int64 range. */
+uint64_t shift(uint64_t mantissa, size_t num_digits) {
+  for (size_t idx = 0; idx < num_digits; ++idx) {
+    if (mantissa > c_max_mantissa / 10) {
+      throw std::runtime_error("decimal_t too many digits");
     }
+    mantissa *= 10;
   }
-  return std::strong_ordering::equal;
+  return mantissa;
 }
 
-bool decimal_t::operator<(const decimal_t &rhs) const {
-  return (*this <=> rhs) == std::strong_ordering::less;
-}
-bool decimal_t::operator>(const decimal_t &rhs) const {
-  return (*this <=> rhs) == std::strong_ordering::greater;
-}
-bool decimal_t::operator==(const decimal_t &rhs) const {
-  return (*this <=> rhs) == std::strong_ordering::equal;
-}
-bool decimal_t::operator!=(const decimal_t &rhs) const {
-  return (*this <=> rhs) != std::strong_ordering::equal;
+void check_precision(kdr::integer_t precision) {
+  if (precision < 0 || precision > kdr::decimal_t::c_max_scale) {
+    throw std::runtime_error("decimal_t bogus precision: " +
+                             std::to_string(precision));
+  }
 }
 
-bool decimal_t::is_zero() const {
-  const auto int_part_view = int_part();
-  if (int_part_view.size() > 0 && to_int(int_part_view) != 0) {
+#if KDR_DECIMAL_SSE41
+
+const bool c_have_sse41 = [] {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.1") != 0;
+}();
+
+/**
+ * Parse a plain "ddd.ddd" token of fewer than 16 chars in one 16 byte
+ * register: classify every char at once, gather the significant
+ * digits right-aligned (skipping the decimal point) and combine them
+ * pairwise into two 8 digit halves. Anything unusual (exponents,
+ * stray chars, long tokens) is left to the scalar parser.
+ */
+__attribute__((target("sse4.1"), no_sanitize_address)) bool
+parse_sse41(std::string_view str, uint64_t &mantissa, uint8_t &scale) {
+  if (str.size() >= 16 || str.empty() || !is_digit(str.front())) {
     return false;
   }
-  const auto frac_part_view = frac_part();
-  if (frac_part_view.size() > 0 && to_int(frac_part_view) != 0) {
+  // Load 16 bytes straight from the token when that can't cross into
+  // another page, and blank the lanes past its end.
+  const auto lanes =
+      _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  __m128i input;
+  if ((reinterpret_cast<uintptr_t>(str.data()) & 4095) <= 4096 - 16) {
+    input = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str.data()));
+  } else {
+    alignas(16) char buffer[16] = {};
+    std::memcpy(buffer, str.data(), str.size());
+    input = _mm_load_si128(reinterpret_cast<const __m128i *>(buffer));
+  }
+  input = _mm_and_si128(
+      input, _mm_cmpgt_epi8(_mm_set1_epi8(char(str.size())), lanes));
+  const auto values = _mm_sub_epi8(input, _mm_set1_epi8('0'));
+  const auto is_digit_vec =
+      _mm_cmpeq_epi8(_mm_min_epu8(values, _mm_set1_epi8(9)), values);
+  const auto is_dot_vec = _mm_cmpeq_epi8(input, _mm_set1_epi8('.'));
+  const auto is_zero_vec = _mm_cmpeq_epi8(input, _mm_set1_epi8('0'));
+
+  uint32_t digits = uint32_t(_mm_movemask_epi8(is_digit_vec));
+  uint32_t dots = uint32_t(_mm_movemask_epi8(is_dot_vec));
+  // The last lane is always blank, so there is a terminator.
+  const auto end = std::countr_zero(~(digits | dots) & 0xffffu);
+  const auto in_token = (1u << end) - 1;
+  digits &= in_token;
+  dots &= in_token;
+
+  if ((dots & (dots - 1)) != 0) {
     return false;
   }
+  if (size_t(end) < str.size()) {
+    const char ch = str[end];
+    if (dots == 0 || ch == 'e' || ch == 'E') {
+      return false;
+    }
+  }
+
+  const auto nonzero =
+      digits & ~uint32_t(_mm_movemask_epi8(is_zero_vec)) & in_token;
+  if (nonzero == 0) {
+    mantissa = 0;
+    scale = 0;
+    return true;
+  }
+
+  // Integer digits always count; fractional ones only up to the last
+  // nonzero digit.
+  const auto dot = dots != 0 ? std::countr_zero(dots) : 16;
+  const auto last = 31 - std::countl_zero(nonzero);
+  const auto stop = last > dot ? last + 1 : std::min(dot, end);
+  // Everything before `end` is a digit or the one decimal point.
+  const auto num_digits = stop - (dot < stop ? 1 : 0);
+  scale = uint8_t(last > dot ? last - dot : 0);
+
+  // Lane i takes digit i + num_digits - 16, i.e. the char one further
+  // along once past the decimal point; negative indices yield zero.
+  auto index = _mm_add_epi8(lanes, _mm_set1_epi8(char(num_digits - 16)));
+  index = _mm_sub_epi8(index,
+                       _mm_cmpgt_epi8(index, _mm_set1_epi8(char(dot - 1))));
+  const auto aligned = _mm_shuffle_epi8(values, index);
+
+  const auto pairs = _mm_maddubs_epi16(
+      aligned, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1,
+                             10, 1));
+  const auto quads =
+      _mm_madd_epi16(pairs, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+  const auto packed = _mm_packus_epi32(quads, quads);
+  const auto octets = _mm_madd_epi16(
+      packed, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+
+  mantissa = uint64_t(uint32_t(_mm_cvtsi128_si32(octets))) * 100000000 +
+             uint32_t(_mm_extract_epi32(octets, 1));
   return true;
 }
 
-std::string decimal_t::str(integer_t precision) const {
-  assert(precision >= 0);
+#endif
 
-  auto result = std::string(m_view.data(), m_view.size());
-  const auto decimal_pos = result.find('.');
+} // namespace
 
-  if (decimal_pos == std::string::npos) {
-    result += '.';
-    result += std::string(precision, '0');
-    return result;
+namespace kdr {
+
+decimal_t::decimal_t(std::string_view str) {
+  if (str.size() > c_max_num_chars) {
+    std::ostringstream os;
+    os << __FUNCTION__ << " str size: " << str.size()
+       << " exceeds max allowed size: " << c_max_num_chars;
+    throw std::runtime_error(os.str());
   }
+  if (!parse_simd(str, *this)) {
+    *this = parse_scalar(str);
+  }
+}
 
-  const auto chars_after_decimal = result.size() - (decimal_pos + 1);
-  if (size_t(precision) > chars_after_decimal) {
-    const auto zeros_to_add = precision - chars_after_decimal;
-    result += std::string(zeros_to_add, '0');
-  } else {
-    result = result.substr(0, decimal_pos + 1 + precision);
+decimal_t decimal_t::parse_scalar(std::string_view str) {
+  enum state_t {
+    c_before_digit,
+    c_before_decimal,
+    c_after_decimal,
+    c_after_value
+  };
+
+  // Fractional zeros are held back until a nonzero digit follows so
+  // that trailing ones never reach the mantissa.
+  uint64_t mantissa = 0;
+  int64_t scale = 0;
+  size_t pending_zeros = 0;
+  state_t state = c_before_digit;
+
+  for (size_t idx = 0; idx < str.size() && state != c_after_value; ++idx) {
+    const char ch = str[idx];
+    if ((ch == 'e' || ch == 'E') &&
+        (state == c_before_decimal || state == c_after_decimal)) {
+      // e.g. the 1E-8 that Kraken sends for some increments
+      int64_t exponent = 0;
+      const auto *begin = str.data() + idx + 1;
+      const auto *end = str.data() + str.size();
+      if (begin != end && *begin == '+') {
+        ++begin;
+      }
+      if (std::from_chars(begin, end, exponent).ec != std::errc{}) {
+        throw std::runtime_error("decimal_t bad exponent");
+      }
+      if (mantissa == 0) {
+        break; // zero whatever the exponent
+      }
+      // A nonzero int64 mantissa can be shifted left by at most 18
+      // digits, and lose at most 18 trailing zeros to a shift right:
+      // past that the value is out of range, whatever its digits, and
+      // subtracting the exponent could overflow.
+      if (exponent > scale + c_max_scale ||
+          exponent < scale - 2 * c_max_scale) {
+        throw std::runtime_error("decimal_t exponent out of range");
+      }
+      scale -= exponent;
+      break;
+    }
+    switch (state) {
+    case c_before_digit:
+      // Skip anything up to the first digit, and leading zeros.
+      if (is_digit(ch) &&
+          (ch != '0' || idx + 1 == str.size() || str[idx + 1] == '.')) {
+        mantissa = ch - '0';
+        state = c_before_decimal;
+      }
+      break;
+    case c_before_decimal:
+      if (is_digit(ch)) {
+        mantissa = shift(mantissa, 1) + (ch - '0');
+      } else if (ch == '.') {
+        state = c_after_decimal;
+      } else {
+        throw std::runtime_error("invalid state");
+      }
+      break;
+    case c_after_decimal:
+      if (ch == '0') {
+        ++pending_zeros;
+      } else if (is_digit(ch)) {
+        mantissa = shift(mantissa, pending_zeros + 1) + (ch - '0');
+        scale += pending_zeros + 1;
+        pending_zeros = 0;
+      } else {
+        state = c_after_value;
+      }
+      break;
+    case c_after_value:
+      break;
+    }
   }
 
+  if (mantissa == 0) {
+    return decimal_t{};
+  }
+  if (scale < 0) {
+    mantissa = shift(mantissa, -scale);
+    scale = 0;
+  }
+  while (scale > 0 && mantissa % 10 == 0) {
+    mantissa /= 10;
+    --scale;
+  }
+  if (scale > c_max_scale) {
+    throw std::runtime_error("decimal_t too many digits after decimal point");
+  }
+
+  auto result = decimal_t{};
+  result.m_mantissa = mantissa;
+  result.m_scale = uint8_t(scale);
   return result;
 }
 
-std::string_view decimal_t::str_view(integer_t precision) const {
-  assert(precision >= 0);
+bool decimal_t::have_simd() {
+#if KDR_DECIMAL_SSE41
+  return c_have_sse41;
+#else
+  return false;
+#endif
+}
 
-  auto result = std::string_view(m_view.data(), m_view.size());
-  const auto decimal_pos = result.find('.');
+bool decimal_t::parse_simd(std::string_view str, decimal_t &result) {
+#if KDR_DECIMAL_SSE41
+  if (c_have_sse41 && parse_sse41(str, result.m_mantissa, result.m_scale)) {
+    return true;
+  }
+#else
+  (void)str;
+  (void)result;
+#endif
+  return false;
+}
 
-  if (decimal_pos == std::string::npos) {
-    m_chars[result.size()] = '.';
-    result = std::string_view(result.data(), result.size() + precision + 1);
+std::strong_ordering decimal_t::compare_scaled(const decimal_t &rhs) const {
+  // Compare integer parts and then fractional parts at the larger of
+  // the two scales, neither of which can overflow.
+  const auto lhs_pow = c_pow10[m_scale];
+  const auto rhs_pow = c_pow10[rhs.m_scale];
+  const auto result = m_mantissa / lhs_pow <=> rhs.m_mantissa / rhs_pow;
+  if (result != std::strong_ordering::equal) {
     return result;
   }
+  const auto scale = std::max(m_scale, rhs.m_scale);
+  const auto lhs_frac = (m_mantissa % lhs_pow) * c_pow10[scale - m_scale];
+  const auto rhs_frac =
+      (rhs.m_mantissa % rhs_pow) * c_pow10[scale - rhs.m_scale];
+  return lhs_frac <=> rhs_frac;
+}
 
-  const auto chars_after_decimal = result.size() - (decimal_pos + 1);
-  if (size_t(precision) > chars_after_decimal) {
-    const auto zeros_to_add = precision - chars_after_decimal;
-    result = std::string_view(result.data(), result.size() + zeros_to_add);
-  } else {
-    result = result.substr(0, decimal_pos + 1 + precision);
+double decimal_t::double_value(integer_t precision) const {
+  check_precision(precision);
+  if (precision >= m_scale) {
+    return double(m_mantissa) / double(c_pow10[m_scale]);
+  }
+  return double(m_mantissa / c_pow10[m_scale - precision]) /
+         double(c_pow10[precision]);
+}
+
+int64_t decimal_t::units(integer_t precision) const {
+  check_precision(precision);
+  if (precision >= m_scale) {
+    return int64_t(shift(m_mantissa, size_t(precision - m_scale)));
+  }
+  return int64_t(m_mantissa / c_pow10[m_scale - precision]);
+}
+
+decimal_t decimal_t::from_units(int64_t units, integer_t precision) {
+  check_precision(precision);
+  if (units < 0) {
+    throw std::runtime_error("decimal_t negative units: " +
+                             std::to_string(units));
   }
+  auto result = decimal_t{};
+  if (units == 0) {
+    return result;
+  }
+  auto mantissa = uint64_t(units);
+  auto scale = precision;
+  while (scale > 0 && mantissa % 10 == 0) {
+    mantissa /= 10;
+    --scale;
+  }
+  result.m_mantissa = mantissa;
+  result.m_scale = uint8_t(scale);
   return result;
 }
 
-void decimal_t::process(boost::crc_32_type &crc32, int64_t precision) const {
-  const auto chars = str_view(precision);
-  auto in_leading_zeros = true;
-  auto in_trailing_digits = false;
-  auto num_trailing_digits = int64_t{0};
-  for (const auto ch : chars) {
-    if (in_trailing_digits && num_trailing_digits >= precision) {
-      return;
-    }
-    if (std::isdigit(ch) != 0) {
-      if (!in_leading_zeros) {
-        crc32.process_byte(ch);
-        if (in_trailing_digits) {
-          ++num_trailing_digits;
-        }
-      } else if (ch != '0') {
-        in_leading_zeros = false;
-        crc32.process_byte(ch);
-      }
-    }
-    if (ch == '.') {
-      in_trailing_digits = true;
+std::string decimal_t::str() const {
+  if (m_mantissa == 0) {
+    return "0.0";
+  }
+  chars_t buffer;
+  return std::string{to_chars(buffer, m_scale)};
+}
+
+std::string decimal_t::str(integer_t precision) const {
+  chars_t buffer;
+  return std::string{to_chars(buffer, precision)};
+}
+
+std::string_view decimal_t::to_chars(chars_t &buffer,
+                                     integer_t precision) const {
+  check_precision(precision);
+  const auto pow = c_pow10[m_scale];
+  auto *const begin = buffer.data();
+  auto *ptr = std::to_chars(begin, begin + buffer.size(), m_mantissa / pow).ptr;
+  if (precision == 0) {
+    return std::string_view(begin, ptr - begin);
+  }
+
+  *ptr++ = '.';
+  // Left-pad the fraction to m_scale digits, then truncate or
+  // zero-extend it to `precision`.
+  auto frac = std::array<char, 20>{};
+  const auto frac_end =
+      std::to_chars(frac.data(), frac.data() + frac.size(), m_mantissa % pow)
+          .ptr;
+  const auto frac_size = size_t(frac_end - frac.data());
+  const auto num_leading = m_scale > 0 ? m_scale - frac_size : 0;
+  for (integer_t idx = 0; idx < precision; ++idx) {
+    const auto digit = size_t(idx);
+    if (digit < num_leading || digit >= size_t(m_scale)) {
+      *ptr++ = '0';
+    } else {
+      *ptr++ = frac[digit - num_leading];
     }
   }
+  return std::string_view(begin, ptr - begin);
+}
+
+std::string_view decimal_t::crc_chars(chars_t &buffer,
+                                      integer_t precision) const {
+  check_precision(precision);
+  // The checksum covers the value as an integer count of units of
+  // 10^-precision, without leading zeros (so zero contributes nothing).
+  const auto units = precision >= m_scale
+                         ? m_mantissa
+                         : m_mantissa / c_pow10[m_scale - precision];
+  if (units == 0) {
+    return std::string_view{};
+  }
+  auto *const begin = buffer.data();
+  auto *ptr = std::to_chars(begin, begin + buffer.size(), units).ptr;
+  if (precision > m_scale) {
+    const auto num_zeros = size_t(precision - m_scale);
+    std::memset(ptr, '0', num_zeros);
+    ptr += num_zeros;
+  }
+  return std::string_view(begin, ptr - begin);
+}
+
+void decimal_t::process(crc32_t &crc32, integer_t precision) const {
+  chars_t buffer;
+  const auto chars = crc_chars(buffer, precision);
+  crc32.process_bytes(chars);
 }
 
 } // namespace kdr
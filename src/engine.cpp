@@ -1,26 +1,47 @@
 #include "engine.hpp"
 
+#include "alloc_counter.hpp"
 #include "book.hpp"
 #include "constants.hpp"
 #include "header.hpp"
 #include "instrument.hpp"
 #include "pong.hpp"
+#include "sides.hpp"
 
 #include <boost/log/trivial.hpp>
 #include <simdjson.h>
 
 #include <algorithm>
-#include <cassert>
+#include <iterator>
 #include <ranges>
+#include <string_view>
+#include <thread>
 #include <vector>
 
 namespace kdr {
 
 engine_t::engine_t(ssl_context_t &ssl_context, const config_t &config,
-                   const sink_t &sink)
-    : m_session{ssl_context, config}, m_config{config},
-      m_metrics_timer{m_session.ioc()}, m_ping_timer{m_session.ioc()},
-      m_process_timer{m_session.ioc()}, m_sink(sink) {
+                   const model::symbol_table_t &symbols, const sink_t &sink,
+                   shard_id_t shard)
+    : m_session{ssl_context, config}, m_config{config}, m_symbols{symbols},
+      m_shard{shard},
+      m_ring{config.io_thread() ? std::make_unique<msg_ring_t>(c_ring_capacity)
+                                : nullptr},
+      m_metrics_timer{processing_ioc()}, m_ping_timer{processing_ioc()},
+      m_subscribe_timer{processing_ioc()}, m_subscriptions{config},
+      m_book_stream{
+          [this](const response::header_t &header, symbol_id_t id,
+                 const std::string &symbol) {
+            return begin_book(header, id, symbol);
+          },
+          [this](const bid_t &bid) { m_sink.book_stream().accept_bid(bid); },
+          [this](const ask_t &ask) { m_sink.book_stream().accept_ask(ask); },
+          [this](const std::string &symbol, uint64_t crc32,
+                 timestamp_t timestamp) {
+            m_sink.book_stream().end(symbol, crc32, timestamp);
+            m_book_open = false;
+          }},
+      m_sink(sink) {
 
   if (m_config.ping_interval_secs() < 1) {
     BOOST_LOG_TRIVIAL(error)
@@ -31,81 +52,232 @@ engine_t::engine_t(ssl_context_t &ssl_context, const config_t &config,
 }
 
 void engine_t::start_processing(const recv_cb_t &recv_cb) {
-
+  // The session calls back on its own thread, so hop over to the
+  // processing thread before touching any timers.
   const auto connected_cb = [this]() {
     BOOST_LOG_TRIVIAL(debug) << "engine_t connected!";
-
-    BOOST_LOG_TRIVIAL(debug) << "starting metrics timer...";
-    m_metrics_timer.expires_from_now(
-        boost::posix_time::seconds(c_metrics_interval_secs));
-    m_metrics_timer.async_wait(
-        [this](error_code ec) { this->on_metrics_timer(ec); });
-
-    BOOST_LOG_TRIVIAL(debug) << "starting processing timer...";
-    m_process_timer.expires_after(
-        std::chrono::microseconds(c_process_interval_micros));
-    m_process_timer.async_wait([this](error_code ec) {
-      this->on_process_timer(ec);
-      // Defer subscriptions until we know we're processing
-      const request::subscribe_instrument_t subscribe_inst{++m_inst_req_id};
-      m_session.send(subscribe_inst.str());
-    });
-
-    BOOST_LOG_TRIVIAL(debug) << "starting ping timer...";
-    m_ping_timer.expires_from_now(
-        boost::posix_time::seconds(m_config.ping_interval_secs()));
-    m_ping_timer.async_wait([this](error_code ec) { this->on_ping_timer(ec); });
+    boost::asio::post(processing_ioc(), [this]() { on_connected(); });
+  };
+  const auto disconnected_cb = [this]() {
+    BOOST_LOG_TRIVIAL(warning) << "engine_t disconnected!";
+    boost::asio::post(processing_ioc(), [this]() { on_disconnected(); });
   };
 
-  m_session.start_processing(connected_cb, recv_cb);
+  if (m_ring) {
+    BOOST_LOG_TRIVIAL(info)
+        << __FUNCTION__ << ": using dedicated I/O thread with ring capacity: "
+        << m_ring->capacity();
+    m_recv_cb = recv_cb;
+    m_session.start_processing(
+        connected_cb,
+        [this](padded_msg_t msg, timestamp_t recv_tm) {
+          return enqueue_msg(msg, recv_tm);
+        },
+        disconnected_cb);
+  } else {
+    m_session.start_processing(connected_cb, recv_cb, disconnected_cb);
+  }
 }
 
-bool engine_t::handle_msg(msg_t msg) {
-  m_metrics.accept(msg);
+void engine_t::run(const std::atomic<bool> &shutting_down) {
+  if (!m_ring) {
+    while (!shutting_down && keep_processing()) {
+      m_session.ioc().run_one();
+    }
+    return;
+  }
 
-  try {
-    simdjson::padded_string padded_msg{msg};
-    simdjson::ondemand::document doc = m_parser.iterate(padded_msg);
+  // Keep the engine's io_context from running out of work between
+  // drains and before the session has connected.
+  const auto work_guard = boost::asio::make_work_guard(m_engine_ioc);
 
-    auto buffer = std::string_view{};
-    if (doc[c_response_channel].get(buffer) == simdjson::SUCCESS) {
-      if (buffer == c_channel_instrument) {
-        return handle_instrument_msg(doc);
-      }
-      if (buffer == c_channel_book) {
-        return handle_book_msg(doc);
-      }
-      if (buffer == c_channel_trade) {
-        return handle_trade_msg(doc);
-      }
-      if (buffer == c_channel_heartbeat) {
-        return handle_heartbeat_msg(doc);
-      }
-    } else if (doc[c_response_method].get(buffer) == simdjson::SUCCESS) {
-      assert(buffer == c_method_pong || buffer = c_method_subscribe);
-      if (buffer == c_method_pong) {
-        // We have to crack the message to know that it's a pong, but
-        // then we have to reparse it so that the pong_t deserializer
-        // can see the method field.
-        simdjson::padded_string padded_pong_msg{msg};
-        simdjson::ondemand::document pong_doc =
-            m_parser.iterate(padded_pong_msg);
-        return handle_pong_msg(pong_doc);
-      }
-      if (buffer == c_method_subscribe) {
-        // !@# TODO: ultimately we will want to crack open 'subscribe'
-        simdjson::padded_string padded_msg{msg};
-        simdjson::ondemand::document doc = m_parser.iterate(padded_msg);
-        BOOST_LOG_TRIVIAL(debug)
-            << __FUNCTION__ << ": " << simdjson::to_json_string(doc);
-        return true;
+  std::thread io_thread{[this, &shutting_down]() {
+    while (!shutting_down && keep_processing()) {
+      m_session.ioc().run_one();
+    }
+  }};
+
+  // Block until a drain or timer is ready; the bound only limits how
+  // long it takes to notice shutdown.
+  while (!shutting_down && keep_processing()) {
+    m_engine_ioc.run_one_for(std::chrono::milliseconds(c_idle_wait_millis));
+  }
+
+  // Release the I/O thread whether it is waiting on the socket or on
+  // space in the ring.
+  m_session.stop_processing();
+  m_session.ioc().stop();
+  io_thread.join();
+}
+
+void engine_t::send(std::string msg) {
+  if (!m_ring) {
+    m_session.send(msg);
+    return;
+  }
+  boost::asio::post(m_session.ioc(), [this, msg = std::move(msg)]() {
+    m_session.send(msg);
+  });
+}
+
+bool engine_t::enqueue_msg(padded_msg_t msg, timestamp_t recv_tm) {
+  auto *slot = m_ring->back();
+  if (slot == nullptr) {
+    // Rather than drop data, which would corrupt our books, hold off
+    // reading from the socket until the engine thread catches up.
+    m_ring_overflows.fetch_add(1, std::memory_order_relaxed);
+    while ((slot = m_ring->back()) == nullptr) {
+      if (!keep_processing()) {
+        return false;
       }
-    } else {
+      std::this_thread::yield();
+    }
+  }
+  slot->assign(msg, recv_tm);
+  m_ring->push();
+  post_drain();
+  return true;
+}
+
+void engine_t::post_drain() {
+  // Pairs with the exchange in drain_ring(): either the consumer's
+  // drain sees our push or we see that no drain is pending.
+  if (!m_drain_pending.exchange(true)) {
+    boost::asio::post(m_engine_ioc, [this]() { drain_ring(); });
+  }
+}
+
+void engine_t::drain_ring() {
+  m_drain_pending.exchange(false);
+
+  size_t num_drained = 0;
+  while (num_drained < m_drain_batch) {
+    const auto *slot = m_ring->front();
+    if (slot == nullptr) {
+      break;
+    }
+    const auto keep_going = m_recv_cb(slot->msg(), slot->recv_tm());
+    m_ring->pop();
+    ++num_drained;
+    if (!keep_going) {
+      BOOST_LOG_TRIVIAL(error)
+          << __FUNCTION__ << ": recv_cb returned false -- stop processing";
+      m_session.stop_processing();
+      return;
+    }
+  }
+
+  const auto depth = m_ring->size();
+  m_metrics.set_ring_depth(depth);
+  if (depth > 0) {
+    m_drain_batch = std::min(m_drain_batch * 2, m_ring->capacity());
+    post_drain();
+  } else {
+    m_drain_batch = std::max(m_drain_batch / 2, c_min_drain_batch);
+  }
+}
+
+void engine_t::on_connected() {
+  if (m_timers_started) {
+    return on_reconnected();
+  }
+  m_timers_started = true;
+
+  BOOST_LOG_TRIVIAL(debug) << "starting metrics timer...";
+  m_metrics_timer.expires_from_now(
+      boost::posix_time::seconds(c_metrics_interval_secs));
+  m_metrics_timer.async_wait(
+      [this](error_code ec) { this->on_metrics_timer(ec); });
+
+  // Followers receive their instruments from the leader, possibly
+  // before they have connected themselves.
+  if (leader()) {
+    const request::subscribe_instrument_t subscribe_inst{++m_req_id};
+    send(subscribe_inst.str());
+  }
+  send_subscriptions();
+
+  BOOST_LOG_TRIVIAL(debug) << "starting ping timer...";
+  m_ping_timer.expires_from_now(
+      boost::posix_time::seconds(m_config.ping_interval_secs()));
+  m_ping_timer.async_wait([this](error_code ec) { this->on_ping_timer(ec); });
+}
+
+void engine_t::on_reconnected() {
+  m_metrics.reconnect();
+
+  // Whatever was still queued is in the symbol sets and is about to
+  // be requeued along with everything that was live.
+  m_subscriptions.clear();
+  m_subscribing = false;
+
+  BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << ": resubscribing to "
+                          << m_book_symbols.size() << " book and "
+                          << m_trade_symbols.size() << " trade symbols";
+  if (leader()) {
+    const request::subscribe_instrument_t subscribe_inst{++m_req_id};
+    send(subscribe_inst.str());
+  }
+  queue_book_subscriptions(m_book_symbols);
+  queue_trade_subscriptions(m_trade_symbols);
+}
+
+void engine_t::on_disconnected() {
+  // In io_thread mode the ring may still hold updates read before the
+  // connection dropped; they must be applied before the gap clears
+  // the books. Nothing more arrives until we reconnect.
+  if (m_ring && !m_ring->empty()) {
+    boost::asio::post(processing_ioc(), [this]() { on_disconnected(); });
+    return;
+  }
+
+  const auto recv_tm = timestamp_t::now();
+  for (const auto &symbol : m_live_book_symbols) {
+    m_sink.accept(response::book_t::gap(symbol, recv_tm), m_symbols);
+  }
+  BOOST_LOG_TRIVIAL(warning) << __FUNCTION__ << ": recorded gaps for "
+                             << m_live_book_symbols.size() << " symbols";
+  m_live_book_symbols.clear();
+}
+
+bool engine_t::handle_msg(padded_msg_t msg, timestamp_t recv_tm) {
+  m_metrics.accept(msg);
+
+  try {
+    simdjson::ondemand::document doc = m_parser.iterate(msg);
+
+    // Classify the message from its first discriminating field and
+    // then rewind so that the handler sees the whole document. This
+    // reuses the structural index from the first pass rather than
+    // re-padding and re-parsing.
+    const auto route = route_msg(doc);
+    doc.rewind();
+
+    switch (route) {
+    case route_t::book:
+      return handle_book_msg(doc, recv_tm);
+    case route_t::trade:
+      return handle_trade_msg(doc, recv_tm);
+    case route_t::instrument:
+      return handle_instrument_msg(doc, recv_tm);
+    case route_t::heartbeat:
+      return handle_heartbeat_msg(doc);
+    case route_t::pong:
+      return handle_pong_msg(doc);
+    case route_t::subscribe:
+      return handle_subscribe_msg(doc);
+    case route_t::unsubscribe:
+      BOOST_LOG_TRIVIAL(debug)
+          << __FUNCTION__ << ": " << simdjson::to_json_string(doc);
+      return true;
+    case route_t::unrouted:
+      return true;
+    case route_t::unknown:
       BOOST_LOG_TRIVIAL(warning)
           << __FUNCTION__
           << ": unexpected message: " << simdjson::to_json_string(doc);
+      return true;
     }
-
   } catch (const std::exception &ex) {
     BOOST_LOG_TRIVIAL(error)
         << __FUNCTION__ << ": " << ex.what() << " msg: " << msg;
@@ -115,7 +287,71 @@ bool engine_t::handle_msg(msg_t msg) {
   return true;
 }
 
-bool engine_t::handle_instrument_msg(doc_t &doc) {
+engine_t::route_t engine_t::route_channel(std::string_view channel) {
+  switch (channel.size()) {
+  case std::size(c_channel_book) - 1:
+    if (channel[0] == c_channel_book[0] && channel == c_channel_book) {
+      return route_t::book;
+    }
+    break;
+  case std::size(c_channel_trade) - 1:
+    if (channel[0] == c_channel_trade[0] && channel == c_channel_trade) {
+      return route_t::trade;
+    }
+    break;
+  case std::size(c_channel_heartbeat) - 1:
+    if (channel[0] == c_channel_heartbeat[0] &&
+        channel == c_channel_heartbeat) {
+      return route_t::heartbeat;
+    }
+    break;
+  case std::size(c_channel_instrument) - 1:
+    if (channel[0] == c_channel_instrument[0] &&
+        channel == c_channel_instrument) {
+      return route_t::instrument;
+    }
+    break;
+  }
+  return route_t::unrouted;
+}
+
+engine_t::route_t engine_t::route_method(std::string_view method) {
+  switch (method.size()) {
+  case std::size(c_method_pong) - 1:
+    if (method[0] == c_method_pong[0] && method == c_method_pong) {
+      return route_t::pong;
+    }
+    break;
+  case std::size(c_method_subscribe) - 1:
+    if (method[0] == c_method_subscribe[0] && method == c_method_subscribe) {
+      return route_t::subscribe;
+    }
+    break;
+  case std::size(c_method_unsubscribe) - 1:
+    if (method[0] == c_method_unsubscribe[0] &&
+        method == c_method_unsubscribe) {
+      return route_t::unsubscribe;
+    }
+    break;
+  }
+  return route_t::unrouted;
+}
+
+engine_t::route_t engine_t::route_msg(doc_t &doc) {
+  simdjson::ondemand::object obj = doc.get_object();
+  for (auto field : obj) {
+    const std::string_view key = field.unescaped_key();
+    if (key == c_response_channel) {
+      return route_channel(field.value().get_string());
+    }
+    if (key == c_response_method) {
+      return route_method(field.value().get_string());
+    }
+  }
+  return route_t::unknown;
+}
+
+bool engine_t::handle_instrument_msg(doc_t &doc, timestamp_t recv_tm) {
   auto buffer = std::string_view{};
   if (doc[response::header_t::c_type].get(buffer) != simdjson::SUCCESS) {
     BOOST_LOG_TRIVIAL(error)
@@ -124,19 +360,29 @@ bool engine_t::handle_instrument_msg(doc_t &doc) {
   }
 
   if (buffer == c_instrument_snapshot) {
-    return handle_instrument_snapshot(doc);
+    return handle_instrument_snapshot(doc, recv_tm);
   } else if (buffer == c_instrument_update) {
-    return handle_instrument_update(doc);
+    return handle_instrument_update(doc, recv_tm);
   }
 
   BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ": unknown 'type' " << buffer;
   return false;
 }
 
-bool engine_t::handle_instrument_snapshot(doc_t &doc) {
-  const auto response = response::instrument_t::from_json(doc);
+bool engine_t::handle_instrument_snapshot(doc_t &doc, timestamp_t recv_tm) {
+  const auto response = response::instrument_t::from_json(doc, recv_tm);
   m_sink.accept(response);
 
+  if (m_have_instruments) {
+    // We resubscribed after a reconnect: refresh refdata but replay
+    // the subscriptions we already hold rather than starting over.
+    for (auto *follower : m_followers) {
+      follower->post_instrument(response, {});
+    }
+    return true;
+  }
+  m_have_instruments = true;
+
   const auto &pairs = response.pairs();
   auto symbols = std::vector<std::string>{};
   std::transform(pairs.begin(), pairs.end(), std::back_inserter(symbols),
@@ -152,46 +398,130 @@ bool engine_t::handle_instrument_snapshot(doc_t &doc) {
     symbols.erase(end, symbols.end());
   };
 
-  auto begin = symbols.begin();
-  while (begin != symbols.end()) {
-    // !@# TODO: clean up a little...
-    auto end =
-        begin +
-        std::min(size_t{c_subscription_batch_size},
-                 static_cast<std::size_t>(std::distance(begin, symbols.end())));
-    if (m_config.capture_book()) {
-      const request::subscribe_book_t subscribe_book{
-          ++m_book_req_id, m_config.book_depth(), true,
-          std::vector<std::string>{begin, end}};
-      m_book_subs.push(subscribe_book);
-    }
-
-    if (m_config.capture_trades()) {
-      const request::subscribe_trade_t subscribe_trade{
-          ++m_trade_req_id, true, std::vector<std::string>{begin, end}};
-      m_trade_subs.push(subscribe_trade);
-    }
+  const auto num_shards = m_config.num_shards();
+  if (m_followers.empty() || num_shards < 2) {
+    queue_subscriptions(symbols);
+    return true;
+  }
 
-    begin = end;
+  auto shard_symbols = std::vector<std::vector<std::string>>(num_shards);
+  for (auto &symbol : symbols) {
+    const auto shard = shard_of(symbol, num_shards);
+    shard_symbols[shard].push_back(std::move(symbol));
+  }
+  queue_subscriptions(shard_symbols[m_shard]);
+  for (auto *follower : m_followers) {
+    BOOST_LOG_TRIVIAL(info)
+        << __FUNCTION__ << ": assigning "
+        << shard_symbols[follower->shard()].size()
+        << " symbols to shard: " << follower->shard();
+    follower->post_instrument(response,
+                              std::move(shard_symbols[follower->shard()]));
   }
 
   return true;
 }
 
-bool engine_t::handle_instrument_update(doc_t &doc) {
-  const auto response = response::instrument_t::from_json(doc);
+bool engine_t::handle_instrument_update(doc_t &doc, timestamp_t recv_tm) {
+  const auto response = response::instrument_t::from_json(doc, recv_tm);
   m_sink.accept(response);
+  for (auto *follower : m_followers) {
+    follower->post_instrument(response, {});
+  }
   return true;
 }
 
-bool engine_t::handle_book_msg(doc_t &doc) {
-  m_book_responses.push(response::book_t::from_json(doc));
+void engine_t::queue_subscriptions(const std::vector<std::string> &symbols) {
+  const auto new_symbols = symbol_set_t{symbols.begin(), symbols.end()};
+  if (m_config.capture_book()) {
+    m_book_symbols.insert(new_symbols.begin(), new_symbols.end());
+    queue_book_subscriptions(new_symbols);
+  }
+  if (m_config.capture_trades()) {
+    m_trade_symbols.insert(new_symbols.begin(), new_symbols.end());
+    queue_trade_subscriptions(new_symbols);
+  }
+}
+
+void engine_t::queue_book_subscriptions(const symbol_set_t &symbols) {
+  m_subscriptions.queue(subscription_scheduler_t::channel_t::book,
+                        {symbols.begin(), symbols.end()},
+                        subscription_scheduler_t::clock_t::now());
+  send_subscriptions();
+}
+
+void engine_t::queue_trade_subscriptions(const symbol_set_t &symbols) {
+  m_subscriptions.queue(subscription_scheduler_t::channel_t::trade,
+                        {symbols.begin(), symbols.end()},
+                        subscription_scheduler_t::clock_t::now());
+  send_subscriptions();
+}
+
+void engine_t::post_instrument(const response::instrument_t &response,
+                               std::vector<std::string> symbols) {
+  boost::asio::post(processing_ioc(),
+                    [this, response, symbols = std::move(symbols)]() {
+                      m_sink.accept(response);
+                      queue_subscriptions(symbols);
+                    });
+}
+
+bool engine_t::handle_book_msg(doc_t &doc, timestamp_t recv_tm) {
+  m_book_open = false;
+  try {
+    response::book_t::stream_json(doc, recv_tm, m_symbols, m_book_stream);
+  } catch (const std::exception &ex) {
+    if (!m_book_open) {
+      throw; // nothing was applied
+    }
+    // The sink drops the part of the message it has staged; the level
+    // book has applied it in part, so the symbol needs a new snapshot
+    // whatever went wrong, a checksum mismatch or a bad level.
+    m_book_open = false;
+    m_sink.book_stream().abort();
+    BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ": " << ex.what()
+                             << " -- resyncing symbol: "
+                             << m_symbols.symbol(m_book_symbol);
+    resync_book(m_book_symbol, recv_tm);
+  }
   return true;
 }
 
-bool engine_t::handle_trade_msg(doc_t &doc) {
-  const auto response = response::trades_t::from_json(doc);
-  m_sink.accept(response);
+bool engine_t::begin_book(const response::header_t &header, symbol_id_t id,
+                          const std::string &symbol) {
+  m_book_symbol = id;
+  if (!m_stale_book_symbols.empty() && m_stale_book_symbols.contains(id)) {
+    if (header.type() != model::msg_type_snapshot) {
+      m_metrics.stale_drop();
+      return false;
+    }
+    BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << ": resynced: " << symbol;
+    m_stale_book_symbols.erase(id);
+  }
+  m_book_open = m_sink.book_stream().begin(header, id, symbol);
+  return m_book_open;
+}
+
+void engine_t::resync_book(symbol_id_t id, timestamp_t recv_tm) {
+  m_metrics.resync();
+  m_stale_book_symbols.insert(id);
+  const auto &symbol = m_symbols.symbol(id);
+  m_sink.accept(response::book_t::gap(symbol, recv_tm), m_symbols);
+
+  // The venue handles these in order, so no update from the old
+  // subscription follows the new snapshot.
+  const auto symbols = std::vector<std::string>{symbol};
+  const request::unsubscribe_book_t unsubscribe{++m_req_id,
+                                                m_config.book_depth(), symbols};
+  send(unsubscribe.str());
+  const request::subscribe_book_t subscribe{
+      ++m_req_id, m_config.book_depth(), true, symbols};
+  send(subscribe.str());
+}
+
+bool engine_t::handle_trade_msg(doc_t &doc, timestamp_t recv_tm) {
+  response::trades_t::from_json(doc, recv_tm, m_trades);
+  m_sink.accept(m_trades);
   return true;
 }
 
@@ -201,7 +531,7 @@ bool engine_t::handle_heartbeat_msg(doc_t &) {
 }
 
 bool engine_t::handle_pong_msg(doc_t &doc) {
-  simdjson::fallback::ondemand::object obj = doc.get_object();
+  simdjson::ondemand::object obj = doc.get_object();
   const auto pong = model::pong_t::from_json(obj);
   BOOST_LOG_TRIVIAL(info) << pong.str();
 
@@ -209,11 +539,70 @@ bool engine_t::handle_pong_msg(doc_t &doc) {
   return true;
 }
 
+bool engine_t::handle_subscribe_msg(doc_t &doc) {
+  auto success = false;
+  auto channel = std::string_view{};
+  auto symbol = std::string_view{};
+  auto error = std::string_view{};
+  auto req_id = req_id_t{0};
+
+  // Acks carry channel and symbol in 'result'; errors carry the
+  // symbol at top level.
+  simdjson::ondemand::object obj = doc.get_object();
+  for (auto field : obj) {
+    const std::string_view key = field.unescaped_key();
+    if (key == c_response_success) {
+      success = field.value().get_bool();
+    } else if (key == c_request_req_id) {
+      req_id = field.value().get_int64();
+    } else if (key == c_response_error) {
+      error = field.value().get_string();
+    } else if (key == c_param_symbol) {
+      symbol = field.value().get_string();
+    } else if (key == c_response_result) {
+      simdjson::ondemand::object result = field.value().get_object();
+      for (auto result_field : result) {
+        const std::string_view result_key = result_field.unescaped_key();
+        if (result_key == c_response_channel) {
+          channel = result_field.value().get_string();
+        } else if (result_key == c_param_symbol) {
+          symbol = result_field.value().get_string();
+        }
+      }
+    }
+  }
+
+  // A failed subscription is still an answer, so it too releases the
+  // next batch.
+  m_subscriptions.ack(req_id, subscription_scheduler_t::clock_t::now());
+  send_subscriptions();
+
+  if (!success) {
+    BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ": failed for symbol: '"
+                             << symbol << "' error: " << error;
+    return true;
+  }
+
+  BOOST_LOG_TRIVIAL(debug) << __FUNCTION__ << ": channel: " << channel
+                           << " symbol: " << symbol;
+  if (channel == c_channel_book) {
+    m_live_book_symbols.emplace(symbol);
+  }
+  return true;
+}
+
 void engine_t::on_metrics_timer(error_code ec) {
   if (ec) {
     BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << " " << ec.message();
   }
 
+  if (m_ring) {
+    m_metrics.set_ring_overflows(
+        m_ring_overflows.load(std::memory_order_relaxed));
+  }
+  // This timer runs on the processing thread, so these are its counts.
+  m_metrics.set_allocs(thread_allocs(), thread_frees());
+  m_sink.report(m_metrics);
   BOOST_LOG_TRIVIAL(info) << m_metrics.str();
   m_metrics_timer.expires_from_now(
       boost::posix_time::seconds(c_metrics_interval_secs));
@@ -227,8 +616,7 @@ void engine_t::on_ping_timer(error_code ec) {
   }
 
   const auto ping = request::ping_t{++m_ping_req_id};
-  const auto msg = ping.str();
-  m_session.send(msg);
+  send(ping.str());
   m_metrics.ping();
 
   m_ping_timer.expires_from_now(
@@ -236,44 +624,63 @@ void engine_t::on_ping_timer(error_code ec) {
   m_ping_timer.async_wait([this](error_code ec) { this->on_ping_timer(ec); });
 }
 
-void engine_t::on_process_timer(error_code ec) {
-  if (ec) {
-    BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << " " << ec.message();
+void engine_t::send_subscriptions() {
+  // Hold subscriptions while disconnected; connecting sends them (and
+  // a reconnect requeues them in full).
+  if (!m_session.connected()) {
+    return;
   }
 
-  m_metrics.set_book_queue_depth(m_book_responses.size());
-  size_t num_to_process =
-      std::min(c_process_batch_size, m_book_responses.size());
-  if (num_to_process > 0) {
-    size_t num_processed = 0;
-    const timestamp_t begin = timestamp_t::now();
-    while (num_to_process > 0) {
-      m_sink.accept(m_book_responses.front());
-      m_book_responses.pop();
-      --num_to_process;
-      ++num_processed;
+  using channel_t = subscription_scheduler_t::channel_t;
+  const auto now = subscription_scheduler_t::clock_t::now();
+  while (auto batch = m_subscriptions.next(now, m_req_id + 1)) {
+    ++m_req_id;
+    if (batch->channel == channel_t::book) {
+      const request::subscribe_book_t subscribe{
+          batch->req_id, m_config.book_depth(), true, batch->symbols};
+      send(subscribe.str());
+    } else {
+      const request::subscribe_trade_t subscribe{batch->req_id, true,
+                                                 batch->symbols};
+      send(subscribe.str());
     }
-    const timestamp_t end = timestamp_t::now();
-    m_metrics.set_book_last_process_micros(end.micros() - begin.micros());
-    m_metrics.set_book_last_consumed(num_processed);
+    m_subscribing = true;
   }
 
-  if (!m_book_subs.empty()) {
-    const auto &book_sub = m_book_subs.front();
-    m_session.send(book_sub.str());
-    m_book_subs.pop();
+  m_metrics.set_subscribe_timeouts(m_subscriptions.num_timeouts());
+  if (m_subscribing && m_subscriptions.idle()) {
+    m_subscribing = false;
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        m_subscriptions.last_cycle().value_or(
+            subscription_scheduler_t::clock_t::duration::zero()));
+    m_metrics.set_subscribe_micros(elapsed.count());
+    BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << ": fully subscribed in "
+                            << elapsed.count() << " micros";
   }
 
-  if (!m_trade_subs.empty()) {
-    const auto &trade_sub = m_trade_subs.front();
-    m_session.send(trade_sub.str());
-    m_trade_subs.pop();
+  const auto wake_time = m_subscriptions.wake_time();
+  if (!wake_time ||
+      (m_subscribe_armed && m_subscribe_timer.expiry() <= *wake_time)) {
+    return;
   }
+  // Rearming cancels any later wait, whose handler then sees
+  // operation_aborted.
+  m_subscribe_armed = true;
+  m_subscribe_timer.expires_at(*wake_time);
+  m_subscribe_timer.async_wait(
+      [this](error_code ec) { this->on_subscribe_timer(ec); });
+}
 
-  m_process_timer.expires_after(
-      std::chrono::microseconds(c_process_interval_micros));
-  m_process_timer.async_wait(
-      [this](error_code ec) { this->on_process_timer(ec); });
+void engine_t::on_subscribe_timer(error_code ec) {
+  if (ec == boost::asio::error::operation_aborted) {
+    return;
+  }
+  m_subscribe_armed = false;
+  if (ec) {
+    BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << " " << ec.message();
+    return;
+  }
+  send_subscriptions();
 }
 
 } // namespace kdr
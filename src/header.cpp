@@ -18,13 +18,15 @@ const std::string_view header_t::c_channel{c_channel_field.data(),
 const std::string_view header_t::c_type{c_type_field.data(),
                                         c_type_field.size() - 1};
 
-header_t::header_t(timestamp_t recv_tm, std::string channel, std::string type)
-    : m_recv_tm(recv_tm), m_channel(std::move(channel)),
-      m_type(std::move(type)) {}
+header_t::header_t(timestamp_t recv_tm, model::channel_t channel,
+                   model::msg_type_t type)
+    : m_recv_tm(recv_tm), m_channel(channel), m_type(type) {}
 
 boost::json::object header_t::to_json_obj() const {
   const boost::json::object result = {
-      {c_recv_tm, recv_tm().str()}, {c_channel, channel()}, {c_type, type()}};
+      {c_recv_tm, recv_tm().str()},
+      {c_channel, model::channel_t_to_str(channel())},
+      {c_type, model::msg_type_t_to_str(type())}};
   return result;
 }
 
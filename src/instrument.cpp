@@ -5,23 +5,20 @@
 namespace kdr {
 namespace response {
 
-instrument_t instrument_t::from_json(simdjson::ondemand::document &response) {
+instrument_t instrument_t::from_json(simdjson::ondemand::document &response,
+                                     timestamp_t recv_tm) {
   auto result = instrument_t{};
-  auto buffer = std::string_view{};
+  const std::string_view type = response[header_t::c_type].get_string();
+  result.m_header = header_t{recv_tm, model::channel_instrument,
+                             model::str_view_to_msg_type_t(type)};
 
-  buffer = response[header_t::c_channel].get_string();
-  const auto channel = std::string{buffer.begin(), buffer.end()};
-  buffer = response[header_t::c_type].get_string();
-  const auto type = std::string{buffer.begin(), buffer.end()};
-  result.m_header = header_t{timestamp_t::now(), channel, type};
-
-  for (simdjson::fallback::ondemand::object obj :
+  for (simdjson::ondemand::object obj :
        response[c_response_data][c_instrument_assets]) {
     const auto asset = model::asset_t::from_json(obj);
     result.m_assets.push_back(asset);
   }
 
-  for (simdjson::fallback::ondemand::object obj :
+  for (simdjson::ondemand::object obj :
        response[c_response_data][c_instrument_pairs]) {
     const auto pair = model::pair_t::from_json(obj);
     result.m_pairs.push_back(pair);
@@ -44,9 +41,10 @@ boost::json::object instrument_t::to_json_obj() const {
   data[c_instrument_pairs] = pairs;
   data[c_instrument_assets] = assets;
 
-  const boost::json::object result = {{header_t::c_channel, m_header.channel()},
-                                      {c_response_data, data},
-                                      {header_t::c_type, m_header.type()}};
+  const boost::json::object result = {
+      {header_t::c_channel, model::channel_t_to_str(m_header.channel())},
+      {c_response_data, data},
+      {header_t::c_type, model::msg_type_t_to_str(m_header.type())}};
 
   return result;
 }
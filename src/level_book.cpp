@@ -2,69 +2,82 @@
 
 #include <boost/log/trivial.hpp>
 
+#include <utility>
+
 namespace kdr {
 namespace model {
 
-const sides_t &level_book_t::sides(symbol_t symbol) const {
-  const auto it = m_sides.find(symbol);
-  if (it == m_sides.end()) {
-    const auto message = "unknown symbol: " + symbol;
+const sides_t &level_book_t::sides(symbol_id_t id) const {
+  if (id >= m_sides.size() || !m_sides[id]) {
+    const auto message = "unknown symbol: " + m_symbols.symbol(id);
     throw std::runtime_error(message);
   }
-  return it->second;
+  return *m_sides[id];
+}
+
+sides_t &level_book_t::mutable_sides(symbol_id_t id) {
+  const auto &result = std::as_const(*this).sides(id);
+  return const_cast<sides_t &>(result);
+}
+
+const sides_t &level_book_t::sides(const symbol_t &symbol) const {
+  return sides(m_symbols.id(symbol));
 }
 
 void level_book_t::accept(const model::pair_t &pair) {
-  auto it = m_sides.find(pair.symbol());
-  if (it == m_sides.end()) {
+  const auto id = m_symbols.intern(pair.symbol());
+  if (id >= m_sides.size()) {
+    m_sides.resize(id + 1);
+  }
+  auto &existing_sides = m_sides[id];
+  if (!existing_sides) {
     // The expected case: we receive a pair for which we have not
     // created sides.
-    auto sides = sides_t{m_book_depth, pair.price_precision(),
-                         pair.qty_precision(), bid_side_t{}, ask_side_t{}};
-    m_sides.emplace(std::make_pair(pair.symbol(), sides));
+    existing_sides.emplace(m_book_depth, pair.price_precision(),
+                           pair.qty_precision(), bid_side_t{}, ask_side_t{});
   } else {
     // The less expected case: we receive a pair response for a symbol
     // we have already seen. In this case, we only need to replacd it
     // if the precisions have changed.
-    const auto &existing_sides = it->second;
-    if (pair.price_precision() != existing_sides.price_precision() ||
-        pair.qty_precision() != existing_sides.qty_precision()) {
+    if (pair.price_precision() != existing_sides->price_precision() ||
+        pair.qty_precision() != existing_sides->qty_precision()) {
       auto new_sides =
           sides_t{m_book_depth, pair.price_precision(), pair.qty_precision(),
-                  existing_sides.bids(), existing_sides.asks()};
-      it->second = new_sides;
+                  existing_sides->bids(), existing_sides->asks()};
+      existing_sides = new_sides;
     }
   }
+  // Growing m_sides may have moved the sides being streamed into.
+  m_current = nullptr;
 }
 
 void level_book_t::accept(const response::book_t &book) {
-  auto it = m_sides.find(book.symbol());
-  if (it == m_sides.end()) {
-    const auto message = "unknown symbol: " + book.symbol();
-    throw std::runtime_error(message);
+  begin(book.header(), book.symbol());
+  for (const auto &bid : book.bids()) {
+    accept_bid(bid);
   }
-  auto &sides = it->second;
-  const auto type = book.header().type();
-  if (type == response::book_t::c_snapshot) {
-    return sides.accept_snapshot(book);
+  for (const auto &ask : book.asks()) {
+    accept_ask(ask);
   }
-  if (type == response::book_t::c_update) {
-    return sides.accept_update(book);
-  }
-  throw std::runtime_error("bogus book channel type: '" + type + "'");
+  end(book.crc32());
+}
+
+void level_book_t::begin(const response::header_t &header, symbol_id_t id) {
+  m_current = &mutable_sides(id);
+  m_current->begin(header.type());
+}
+
+void level_book_t::begin(const response::header_t &header,
+                         const symbol_t &symbol) {
+  begin(header, m_symbols.id(symbol));
 }
 
 uint64_t level_book_t::crc32(symbol_t symbol) const {
-  const auto it = m_sides.find(symbol);
-  if (it == m_sides.end()) {
-    throw std::runtime_error("bogus symbol: " + symbol);
-  }
-  const auto &sides = it->second;
-  return sides.crc32();
+  return sides(symbol).crc32();
 }
 
 std::string level_book_t::str(std::string symbol) const {
-  const auto &side = m_sides.at(symbol);
+  const auto &side = sides(symbol);
   const boost::json::object result{{response::book_t::c_symbol, symbol},
                                    {response::book_t::c_side, side.str()}};
   return boost::json::serialize(result);
@@ -13,13 +13,27 @@ boost::json::object metrics_t::to_json_obj() const {
   const boost::json::object result = {
       {c_num_msgs, m_num_msgs},
       {c_num_bytes, m_num_bytes},
-      {c_book_queue_depth, m_book_queue_depth},
-      {c_book_max_queue_depth, m_book_max_queue_depth},
-      {c_book_last_consumed, m_book_last_consumed},
-      {c_book_last_process_micros, m_book_last_process_micros},
       {c_num_heartbeats, m_num_heartbeats},
       {c_num_pings, m_num_pings},
       {c_num_pongs, m_num_pongs},
+      {c_num_reconnects, m_num_reconnects},
+      {c_num_resyncs, m_num_resyncs},
+      {c_num_stale_drops, m_num_stale_drops},
+      {c_ring_depth, m_ring_depth},
+      {c_ring_max_depth, m_ring_max_depth},
+      {c_ring_overflows, m_ring_overflows},
+      {c_subscribe_micros, m_subscribe_micros},
+      {c_subscribe_timeouts, m_subscribe_timeouts},
+      {c_num_allocs, m_num_allocs},
+      {c_num_frees, m_num_frees},
+      {c_writer_queue_depth, m_writer_queue_depth},
+      {c_writer_max_queue_depth, m_writer_max_queue_depth},
+      {c_writer_waits, m_writer_waits},
+      {c_writer_wait_micros, m_writer_wait_micros},
+      {c_write_micros, m_write_micros},
+      {c_write_max_micros, m_write_max_micros},
+      {c_writer_errors, m_writer_errors},
+      {c_partition_evictions, m_partition_evictions},
   };
   return result;
 }
@@ -4,20 +4,25 @@ namespace kdr {
 namespace model {
 
 void refdata_t::accept(const response::instrument_t &instrument) {
+  const std::unique_lock lock{m_mutex};
   for (const auto &asset : instrument.assets()) {
     m_assets[asset.id()] = asset;
   }
   for (const auto &pair : instrument.pairs()) {
-    m_pairs[pair.symbol()] = pair;
+    const auto id = m_symbols.intern(pair.symbol());
+    if (id >= m_pairs.size()) {
+      m_pairs.resize(id + 1);
+    }
+    m_pairs[id] = pair;
   }
 }
 
 std::optional<refdata_t::pair_precision_t>
-refdata_t::pair_precision(const std::string &symbol) const {
+refdata_t::pair_precision(symbol_id_t id) const {
   std::optional<pair_precision_t> result;
-  const auto it = m_pairs.find(symbol);
-  if (it != m_pairs.end()) {
-    const model::pair_t &pair{it->second};
+  const std::shared_lock lock{m_mutex};
+  if (id < m_pairs.size() && m_pairs[id]) {
+    const model::pair_t &pair{*m_pairs[id]};
     const pair_precision_t precision{pair.price_precision(),
                                      pair.qty_precision()};
     result = std::make_optional(precision);
@@ -25,5 +30,11 @@ refdata_t::pair_precision(const std::string &symbol) const {
   return result;
 }
 
+std::optional<refdata_t::pair_precision_t>
+refdata_t::pair_precision(const std::string &symbol) const {
+  const auto id = m_symbols.find(symbol);
+  return id ? pair_precision(*id) : std::nullopt;
+}
+
 } // namespace model
 } // namespace kdr
@@ -5,7 +5,9 @@
 
 #include <boost/log/trivial.hpp>
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <format>
 #include <memory>
 
@@ -16,34 +18,92 @@ namespace ws = bst::websocket;
 namespace kdr {
 
 session_t::session_t(ssl_context_t &ssl_context, const config_t &config)
-    : m_resolver{m_ioc}, m_ws{m_ioc, ssl_context}, m_config{config} {}
+    : m_ssl_context{ssl_context}, m_resolver{m_ioc},
+      m_reconnect_timer{m_ioc}, m_config{config} {}
 
 void session_t::fail(bst::error_code ec, char const *what) {
   BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << what << ": " << ec.message();
-  m_keep_processing = false;
+  const auto was_connected = m_connected.exchange(false);
+  if (!m_keep_processing) {
+    return;
+  }
+  if (!m_config.reconnect()) {
+    m_keep_processing = false;
+    return;
+  }
+  if (was_connected) {
+    m_handle_disconnected();
+  }
+  schedule_reconnect();
 }
 
 void session_t::start_processing(const connected_cb_t &handle_connected,
-                                 const recv_cb_t &handle_recv) {
+                                 const recv_cb_t &handle_recv,
+                                 const disconnected_cb_t &handle_disconnected) {
   m_handle_connected = handle_connected;
   m_handle_recv = handle_recv;
+  m_handle_disconnected = handle_disconnected;
   m_keep_processing = true;
-  m_resolver.async_resolve(m_config.kraken_host(), m_config.kraken_port(),
-                           [this](error_code ec, resolver::results_type rt) {
-                             if (!ec) {
-                               BOOST_LOG_TRIVIAL(info) << "resolve suceeded";
-                             }
-                             this->on_resolve(ec, rt);
-                           });
+  connect();
+}
+
+void session_t::connect() {
+  m_retired_ws = std::move(m_ws);
+  m_ws = std::make_unique<websocket_t>(m_ioc, m_ssl_context);
+  m_read_buffer.clear();
+
+  const auto generation = ++m_generation;
+  m_resolver.async_resolve(
+      m_config.kraken_host(), m_config.kraken_port(),
+      [this, generation](error_code ec, resolver::results_type rt) {
+        if (generation != m_generation) {
+          return;
+        }
+        if (!ec) {
+          BOOST_LOG_TRIVIAL(info) << "resolve suceeded";
+        }
+        this->on_resolve(ec, rt);
+      });
+}
+
+void session_t::schedule_reconnect() {
+  if (m_reconnect_pending) {
+    return;
+  }
+  m_reconnect_pending = true;
+
+  // Cancel whatever is outstanding on the failed connection; those
+  // handlers will complete with an error and find the reconnect
+  // already pending.
+  bst::get_lowest_layer(*m_ws).close();
+
+  BOOST_LOG_TRIVIAL(warning) << __FUNCTION__ << ": reconnecting in "
+                             << m_backoff.count() << "s";
+  m_reconnect_timer.expires_after(m_backoff);
+  m_reconnect_timer.async_wait([this](error_code ec) {
+    if (ec || !m_keep_processing) {
+      return;
+    }
+    ++m_num_reconnects;
+    m_reconnect_pending = false;
+    connect();
+  });
+  m_backoff = std::min(m_backoff * 2, c_max_backoff);
 }
 
 void session_t::send(msg_t msg) {
+  if (!m_connected) {
+    BOOST_LOG_TRIVIAL(warning)
+        << __FUNCTION__ << ": not connected -- dropping: " << msg;
+    return;
+  }
   BOOST_LOG_TRIVIAL(debug) << __FUNCTION__ << ": " << msg;
   error_code ec;
   const auto num_bytes_written =
-      m_ws.write(asio::buffer(msg.data(), msg.size()), ec);
+      m_ws->write(asio::buffer(msg.data(), msg.size()), ec);
   if (ec) {
     fail(ec, "session_t::send async_write failed");
+    return;
   }
   if (num_bytes_written != msg.size()) {
     const std::string message = std::string(__FUNCTION__) + " short write: " +
@@ -56,12 +116,17 @@ void session_t::send(msg_t msg) {
 void session_t::on_resolve(error_code ec, resolver::results_type results) {
   if (ec) {
     fail(ec, __FUNCTION__);
+    return;
   }
-  boost::beast::get_lowest_layer(m_ws).expires_after(
+  boost::beast::get_lowest_layer(*m_ws).expires_after(
       std::chrono::seconds(30)); // TODO: constants
-  boost::beast::get_lowest_layer(m_ws).async_connect(
-      results,
-      [this](error_code ec, resolver::results_type::endpoint_type endpoint) {
+  boost::beast::get_lowest_layer(*m_ws).async_connect(
+      results, [this, generation = m_generation](
+                   error_code ec,
+                   resolver::results_type::endpoint_type endpoint) {
+        if (generation != m_generation) {
+          return;
+        }
         if (!ec) {
           BOOST_LOG_TRIVIAL(info) << "connect succeeded";
         }
@@ -73,21 +138,28 @@ void session_t::on_connect(error_code ec,
                            resolver::results_type::endpoint_type endpoint) {
   if (ec) {
     fail(ec, __FUNCTION__);
+    return;
   }
 
   auto host = m_config.kraken_host();
 
-  boost::beast::get_lowest_layer(m_ws).expires_after(std::chrono::seconds(30));
-  if (!SSL_set_tlsext_host_name(m_ws.next_layer().native_handle(),
+  boost::beast::get_lowest_layer(*m_ws).expires_after(
+      std::chrono::seconds(30));
+  if (!SSL_set_tlsext_host_name(m_ws->next_layer().native_handle(),
                                 host.c_str())) {
     ec = boost::beast::error_code(static_cast<int>(::ERR_get_error()),
                                   asio::error::get_ssl_category());
     fail(ec, __FUNCTION__);
+    return;
   }
 
   host += ':' + std::to_string(endpoint.port());
-  m_ws.next_layer().async_handshake(
-      asio::ssl::stream_base::client, [this](error_code ec) {
+  m_ws->next_layer().async_handshake(
+      asio::ssl::stream_base::client,
+      [this, generation = m_generation](error_code ec) {
+        if (generation != m_generation) {
+          return;
+        }
         if (!ec) {
           BOOST_LOG_TRIVIAL(info) << "ssl handshake succeeded";
         }
@@ -98,40 +170,56 @@ void session_t::on_connect(error_code ec,
 void session_t::on_ssl_handshake(error_code ec) {
   if (ec) {
     fail(ec, __FUNCTION__);
+    return;
   }
 
-  boost::beast::get_lowest_layer(m_ws).expires_never();
+  boost::beast::get_lowest_layer(*m_ws).expires_never();
 
-  m_ws.set_option(
-      ws::stream_base::timeout::suggested(boost::beast::role_type::client));
+  // Without an idle timeout a half-open connection would never fail
+  // and so never be reconnected.
+  auto timeout =
+      ws::stream_base::timeout::suggested(boost::beast::role_type::client);
+  timeout.idle_timeout = std::chrono::seconds(30);
+  timeout.keep_alive_pings = true;
+  m_ws->set_option(timeout);
 
-  m_ws.set_option(ws::stream_base::decorator([](ws::request_type &req) {
+  m_ws->set_option(ws::stream_base::decorator([](ws::request_type &req) {
     req.set(boost::beast::http::field::user_agent,
             std::string(BOOST_BEAST_VERSION_STRING) +
                 " websocket-client-async-ssl");
   }));
 
-  m_ws.async_handshake(m_config.kraken_host(), "/v2", [this](error_code ec) {
-    if (!ec) {
-      BOOST_LOG_TRIVIAL(info) << "handshake succeeded";
-    }
-    this->on_handshake(ec);
-  });
+  m_ws->async_handshake(m_config.kraken_host(), "/v2",
+                        [this, generation = m_generation](error_code ec) {
+                          if (generation != m_generation) {
+                            return;
+                          }
+                          if (!ec) {
+                            BOOST_LOG_TRIVIAL(info) << "handshake succeeded";
+                          }
+                          this->on_handshake(ec);
+                        });
 }
 
 void session_t::on_handshake(error_code ec) {
   if (ec) {
     fail(ec, __FUNCTION__);
+    return;
   }
 
-  m_keep_processing = true;
+  m_connected = true;
+  m_backoff = c_min_backoff;
 
   m_handle_connected();
 
   m_read_buffer.clear();
-  m_ws.async_read(m_read_buffer, [this](error_code ec, size_t size) {
-    this->on_read(ec, size);
-  });
+  m_ws->async_read(m_read_buffer,
+                   [this, generation = m_generation](error_code ec,
+                                                     size_t size) {
+                     if (generation == m_generation) {
+                       this->on_read(ec, size);
+                     }
+                   });
 }
 
 void session_t::on_write(error_code ec, size_t size) {
@@ -142,38 +230,51 @@ void session_t::on_write(error_code ec, size_t size) {
 }
 
 void session_t::on_read(error_code ec, size_t size) {
+  const auto recv_tm = m_clock.now();
+
   if (ec) {
     fail(ec, __FUNCTION__);
+    return;
   }
 
-  // !@# TODO - see whether we can eliminate this copy by connecting
-  // simdjson's iterator directly to buffer sequence
-  m_read_msg_str = boost::beast::buffers_to_string(m_read_buffer.data());
-  if (m_read_msg_str.size() != size) {
+  if (m_read_buffer.size() != size) {
     BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << "read expected size: " << size
-                             << " but received size: " << m_read_msg_str.size();
+                             << " but received size: " << m_read_buffer.size();
     stop_processing();
     return;
   }
 
   if (size == 0) {
     BOOST_LOG_TRIVIAL(warning) << __FUNCTION__ << ": received empty message";
-    return;
-  }
-  m_read_buffer.consume(m_read_msg_str.size());
+  } else {
+    // Reserve simdjson's padding immediately past the frame so that
+    // the parser can iterate the read buffer in place. The buffer is
+    // reused across reads, so once it has grown to accommodate the
+    // largest frame this neither allocates nor copies.
+    const auto padding = m_read_buffer.prepare(simdjson::SIMDJSON_PADDING);
+    std::memset(padding.data(), 0, padding.size());
+    const auto frame = m_read_buffer.cdata();
+    const padded_msg_t msg{static_cast<const char *>(frame.data()), size,
+                           size + simdjson::SIMDJSON_PADDING};
 
-  if (!m_handle_recv(std::string_view(m_read_msg_str))) {
-    BOOST_LOG_TRIVIAL(error)
-        << __FUNCTION__ << "handle_recv() returned false -- stop processing";
-    stop_processing();
-    return;
+    const auto keep_going = m_handle_recv(msg, recv_tm);
+    m_read_buffer.consume(size);
+    if (!keep_going) {
+      BOOST_LOG_TRIVIAL(error)
+          << __FUNCTION__ << "handle_recv() returned false -- stop processing";
+      stop_processing();
+      return;
+    }
   }
 
-  if (m_keep_processing) {
-    m_read_msg_str.clear();
-    m_ws.async_read(m_read_buffer, [this](error_code ec, size_t size) {
-      this->on_read(ec, size);
-    });
+  if (m_keep_processing && m_connected) {
+    m_ws->async_read(m_read_buffer,
+                     [this, generation = m_generation](error_code ec,
+                                                       size_t size) {
+                       if (generation == m_generation) {
+                         this->on_read(ec, size);
+                       }
+                     });
   }
 }
 
@@ -0,0 +1,35 @@
+#include "shard.hpp"
+
+#include <boost/log/trivial.hpp>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace kdr {
+
+bool pin_current_thread(int cpu) {
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu, &cpu_set);
+  const auto rc =
+      pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+  if (rc != 0) {
+    BOOST_LOG_TRIVIAL(warning)
+        << __FUNCTION__ << ": failed to pin thread to cpu: " << cpu
+        << " rc: " << rc;
+    return false;
+  }
+  return true;
+#else
+  BOOST_LOG_TRIVIAL(warning) << __FUNCTION__
+                             << ": thread affinity is unsupported on this "
+                                "platform; ignoring cpu: "
+                             << cpu;
+  return false;
+#endif
+}
+
+} // namespace kdr
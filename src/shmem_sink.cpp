@@ -178,53 +178,52 @@ void shmem_sink_t::accept(const response::instrument_t &response) {
                            << " alignof(trade_content_t): "
                            << alignof(trade_content_t);
 
+  const std::unique_lock lock{m_mutex};
   for (const model::pair_t &pair : response.pairs()) {
     const std::string &symbol{pair.symbol()};
+    const auto id = m_symbols.intern(symbol);
+    if (id >= m_book_segments.size()) {
+      m_book_segments.resize(id + 1);
+      m_trade_segments.resize(id + 1);
+    }
 
-    const auto bit = m_book_segments.find(symbol);
-    if (bit == m_book_segments.end()) {
+    if (!m_book_segments[id]) {
       const shmem_names_t shmem_names{symbol,
                                       std::string{shmem_names_t::c_book_kind}};
-      book_segment_ptr book_segment =
-          std::make_unique<book_segment_t>(shmem_names);
-      m_book_segments.insert(std::make_pair(symbol, std::move(book_segment)));
+      m_book_segments[id] = std::make_unique<book_segment_t>(shmem_names);
     }
 
-    const auto tit = m_trade_segments.find(symbol);
-    if (tit == m_trade_segments.end()) {
+    if (!m_trade_segments[id]) {
       const shmem_names_t shmem_names{symbol,
                                       std::string{shmem_names_t::c_trade_kind}};
-      trade_segment_ptr trade_segment =
-          std::make_unique<trade_segment_t>(shmem_names);
-      m_trade_segments.insert(std::make_pair(symbol, std::move(trade_segment)));
+      m_trade_segments[id] = std::make_unique<trade_segment_t>(shmem_names);
     }
   }
 }
 
-void shmem_sink_t::accept(const response::book_t &response,
-                          const model::level_book_t &level_book) {
-  const auto &symbol = response.symbol();
-
+void shmem_sink_t::accept_book(symbol_id_t symbol,
+                               const model::level_book_t &level_book) {
   const model::sides_t &sides = level_book.sides(symbol);
 
-  auto it = m_book_segments.find(symbol);
-  if (it == m_book_segments.end()) {
-    const auto message = "unknown symbol: " + symbol;
+  const std::shared_lock lock{m_mutex};
+  if (symbol >= m_book_segments.size() || !m_book_segments[symbol]) {
+    const auto message = "unknown symbol: " + m_symbols.symbol(symbol);
     throw std::runtime_error(message);
   }
-  book_segment_t &segment = *(it->second);
+  book_segment_t &segment = *m_book_segments[symbol];
   segment.accept(sides);
 }
 
 void shmem_sink_t::accept(const kdr::response::trades_t &response) {
+  const std::shared_lock lock{m_mutex};
   for (const model::trade_t &trade : response) {
     const auto &symbol = trade.symbol();
-    auto it = m_trade_segments.find(symbol);
-    if (it == m_trade_segments.end()) {
+    const auto id = m_symbols.find(symbol);
+    if (!id || *id >= m_trade_segments.size() || !m_trade_segments[*id]) {
       const auto message = "unknown symbol: " + symbol;
       throw std::runtime_error(message);
     }
-    trade_segment_t &segment = *(it->second);
+    trade_segment_t &segment = *m_trade_segments[*id];
     segment.accept(trade);
   }
 }
@@ -3,7 +3,7 @@
 #include <boost/log/trivial.hpp>
 
 #include <algorithm>
-#include <string_view>
+#include <string>
 
 namespace kdr {
 namespace model {
@@ -14,22 +14,39 @@ sides_t::sides_t(depth_t book_depth, integer_t price_precision,
     : m_book_depth{book_depth}, m_price_precision(price_precision),
       m_qty_precision(qty_precision), m_bids{bids}, m_asks{asks} {}
 
-void sides_t::accept_snapshot(const response::book_t &snapshot) {
-  clear();
-  m_bids.insert(snapshot.bids().begin(), snapshot.bids().end());
-  m_asks.insert(snapshot.asks().begin(), snapshot.asks().end());
-  verify_checksum(snapshot.crc32());
+void sides_t::begin(msg_type_t type) {
+  switch (type) {
+  case msg_type_update:
+    m_verify = true;
+    return;
+  case msg_type_snapshot:
+    clear();
+    m_verify = true;
+    return;
+  case msg_type_gap:
+    clear();
+    m_verify = false;
+    return;
+  case msg_type_invalid:
+    break;
+  }
+  throw std::runtime_error("bogus book channel type: '" +
+                           msg_type_t_to_str(type) + "'");
 }
 
-void sides_t::accept_update(const response::book_t &update) {
-  apply_update(update.bids(), m_bids);
-  apply_update(update.asks(), m_asks);
-  verify_checksum(update.crc32());
+void sides_t::end(uint64_t crc32) {
+  truncate(m_bids);
+  truncate(m_asks);
+  if (m_verify) {
+    verify_checksum(crc32);
+  }
 }
 
 void sides_t::clear() {
   m_bids.clear();
   m_asks.clear();
+  m_bid_crc.stale = true;
+  m_ask_crc.stale = true;
 }
 
 void sides_t::verify_checksum(uint64_t expected_crc32) const {
@@ -38,14 +55,16 @@ void sides_t::verify_checksum(uint64_t expected_crc32) const {
     const auto message =
         "bogus crc32 expected: " + std::to_string(expected_crc32) +
         " actual: " + std::to_string(actual_crc32);
-    throw std::runtime_error(message);
+    throw checksum_error_t(message);
   }
 }
 
 uint64_t sides_t::crc32() const {
-  boost::crc_32_type result;
-  result = update_checksum(result, asks());
-  result = update_checksum(result, bids());
+  refresh_crc_bytes(asks(), m_ask_crc);
+  refresh_crc_bytes(bids(), m_bid_crc);
+  crc32_t result;
+  result.process_bytes(m_ask_crc.bytes);
+  result.process_bytes(m_bid_crc.bytes);
   return result.checksum();
 }
 
@@ -0,0 +1,147 @@
+#include "subscriptions.hpp"
+
+#include <boost/log/trivial.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+namespace kdr {
+
+namespace {
+
+using channel_t = subscription_scheduler_t::channel_t;
+
+channel_t other(channel_t channel) {
+  return channel == channel_t::book ? channel_t::trade : channel_t::book;
+}
+
+} // namespace
+
+subscription_scheduler_t::subscription_scheduler_t(const config_t &config)
+    : m_batch_size{config.subscribe_batch_size()},
+      m_max_in_flight{config.subscribe_max_in_flight()},
+      m_min_interval{
+          config.subscribe_rate() > 0
+              ? clock_t::duration{std::chrono::seconds{1}} /
+                    static_cast<clock_t::rep>(config.subscribe_rate())
+              : clock_t::duration::zero()},
+      m_timeout{std::chrono::seconds{config.subscribe_timeout_secs()}} {
+  const auto &priority_pairs = config.priority_pairs();
+  for (size_t idx = 0; idx < priority_pairs.size(); ++idx) {
+    m_ranks.emplace(priority_pairs[idx], idx);
+  }
+}
+
+void subscription_scheduler_t::queue(channel_t channel,
+                                     const std::vector<std::string> &symbols,
+                                     time_point_t now) {
+  if (symbols.empty()) {
+    return;
+  }
+  if (!m_cycle_begin) {
+    m_cycle_begin = now;
+  }
+
+  auto &to_send = pending(channel);
+  to_send.insert(to_send.end(), symbols.begin(), symbols.end());
+  if (!m_ranks.empty()) {
+    std::stable_sort(to_send.begin(), to_send.end(),
+                     [this](const std::string &lhs, const std::string &rhs) {
+                       return rank(lhs) < rank(rhs);
+                     });
+  }
+}
+
+void subscription_scheduler_t::clear() {
+  m_book_pending.clear();
+  m_trade_pending.clear();
+  m_in_flight.clear();
+  m_last_sent.reset();
+  m_cycle_begin.reset();
+}
+
+std::optional<subscription_scheduler_t::batch_t>
+subscription_scheduler_t::next(time_point_t now, req_id_t req_id) {
+  expire(now);
+
+  if (pending_size() == 0 || m_in_flight.size() >= m_max_in_flight ||
+      (m_last_sent && now < *m_last_sent + m_min_interval)) {
+    return std::nullopt;
+  }
+
+  auto channel = m_next_channel;
+  if (pending(channel).empty()) {
+    channel = other(channel);
+  }
+  m_next_channel = other(channel);
+
+  auto &to_send = pending(channel);
+  const auto num_symbols = std::min(m_batch_size, to_send.size());
+  auto result = batch_t{channel, req_id, {}};
+  result.symbols.reserve(num_symbols);
+  std::move(to_send.begin(), to_send.begin() + num_symbols,
+            std::back_inserter(result.symbols));
+  to_send.erase(to_send.begin(), to_send.begin() + num_symbols);
+
+  m_in_flight.emplace(req_id, in_flight_t{num_symbols, now + m_timeout});
+  m_last_sent = now;
+  return result;
+}
+
+std::optional<subscription_scheduler_t::time_point_t>
+subscription_scheduler_t::wake_time() const {
+  auto result = std::optional<time_point_t>{};
+  const auto consider = [&result](time_point_t when) {
+    if (!result || when < *result) {
+      result = when;
+    }
+  };
+
+  for (const auto &[req_id, in_flight] : m_in_flight) {
+    consider(in_flight.deadline);
+  }
+  if (pending_size() > 0 && m_in_flight.size() < m_max_in_flight) {
+    consider(m_last_sent ? *m_last_sent + m_min_interval : time_point_t{});
+  }
+  return result;
+}
+
+void subscription_scheduler_t::ack(req_id_t req_id, time_point_t now) {
+  const auto it = m_in_flight.find(req_id);
+  if (it == m_in_flight.end()) {
+    return;
+  }
+  if (--it->second.num_unacked == 0) {
+    m_in_flight.erase(it);
+  }
+  finish_cycle(now);
+}
+
+size_t subscription_scheduler_t::rank(const std::string &symbol) const {
+  const auto it = m_ranks.find(symbol);
+  return it == m_ranks.end() ? m_ranks.size() : it->second;
+}
+
+void subscription_scheduler_t::expire(time_point_t now) {
+  for (auto it = m_in_flight.begin(); it != m_in_flight.end();) {
+    if (it->second.deadline > now) {
+      ++it;
+      continue;
+    }
+    BOOST_LOG_TRIVIAL(warning)
+        << __FUNCTION__ << ": req_id: " << it->first << " still awaiting "
+        << it->second.num_unacked << " acks -- moving on";
+    ++m_num_timeouts;
+    it = m_in_flight.erase(it);
+  }
+  finish_cycle(now);
+}
+
+void subscription_scheduler_t::finish_cycle(time_point_t now) {
+  if (m_cycle_begin && idle()) {
+    m_last_cycle = now - *m_cycle_begin;
+    m_cycle_begin.reset();
+  }
+}
+
+} // namespace kdr
@@ -0,0 +1,57 @@
+#include "symbols.hpp"
+
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+
+namespace kdr {
+namespace model {
+
+symbol_id_t symbol_table_t::intern(std::string_view symbol) {
+  if (const auto existing = find(symbol)) {
+    return *existing;
+  }
+  const std::unique_lock lock{m_mutex};
+  const auto it = m_ids.find(symbol);
+  if (it != m_ids.end()) {
+    return it->second;
+  }
+  if (m_symbols.size() >= std::numeric_limits<symbol_id_t>::max()) {
+    throw std::runtime_error("symbol_table_t is full");
+  }
+  const auto id = static_cast<symbol_id_t>(m_symbols.size());
+  const auto &interned = m_symbols.emplace_back(symbol);
+  m_ids.emplace(interned, id);
+  return id;
+}
+
+std::optional<symbol_id_t>
+symbol_table_t::find(std::string_view symbol) const {
+  const std::shared_lock lock{m_mutex};
+  const auto it = m_ids.find(symbol);
+  return it != m_ids.end() ? std::make_optional(it->second) : std::nullopt;
+}
+
+symbol_id_t symbol_table_t::id(std::string_view symbol) const {
+  const auto result = find(symbol);
+  if (!result) {
+    throw std::runtime_error("unknown symbol: " + std::string{symbol});
+  }
+  return *result;
+}
+
+const std::string &symbol_table_t::symbol(symbol_id_t id) const {
+  const std::shared_lock lock{m_mutex};
+  if (id >= m_symbols.size()) {
+    throw std::runtime_error("unknown symbol id: " + std::to_string(id));
+  }
+  return m_symbols[id];
+}
+
+size_t symbol_table_t::size() const {
+  const std::shared_lock lock{m_mutex};
+  return m_symbols.size();
+}
+
+} // namespace model
+} // namespace kdr
@@ -0,0 +1,176 @@
+#include "timestamp.hpp"
+
+#include <stdexcept>
+
+namespace kdr {
+
+namespace {
+
+constexpr int64_t c_micros_per_sec = 1'000'000;
+constexpr int64_t c_secs_per_day = 86'400;
+
+/**
+ * Days since 1970-01-01 of a proleptic Gregorian date, and back. See
+ * Howard Hinnant, "chrono-Compatible Low-Level Date Algorithms".
+ */
+constexpr int64_t days_from_civil(int64_t year, unsigned month,
+                                  unsigned day) {
+  year -= month <= 2;
+  const int64_t era = (year >= 0 ? year : year - 399) / 400;
+  const auto yoe = static_cast<unsigned>(year - era * 400);
+  const unsigned doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 +
+                       day - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+struct civil_t final {
+  int64_t year;
+  unsigned month;
+  unsigned day;
+};
+
+constexpr civil_t civil_from_days(int64_t days) {
+  days += 719468;
+  const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  const auto doe = static_cast<unsigned>(days - era * 146097);
+  const unsigned yoe =
+      (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const unsigned mp = (5 * doy + 2) / 153;
+  const unsigned day = doy - (153 * mp + 2) / 5 + 1;
+  const unsigned month = mp < 10 ? mp + 3 : mp - 9;
+  return {static_cast<int64_t>(yoe) + era * 400 + (month <= 2), month, day};
+}
+
+static_assert(days_from_civil(1970, 1, 1) == 0);
+static_assert(days_from_civil(2000, 3, 1) == 11017);
+static_assert(civil_from_days(11017).year == 2000);
+static_assert(civil_from_days(-1).day == 31);
+
+constexpr unsigned last_day_of_month(int64_t year, unsigned month) {
+  if (month == 2) {
+    const bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+    return leap ? 29 : 28;
+  }
+  return month == 4 || month == 6 || month == 9 || month == 11 ? 30 : 31;
+}
+
+[[noreturn]] void bad_timestamp(std::string_view str) {
+  throw std::runtime_error("bad ISO 8601 timestamp: '" + std::string{str} +
+                           "'");
+}
+
+/** The `count` digits at `pos`, or -1 if any is not a digit. */
+int64_t digits(std::string_view str, size_t pos, size_t count) {
+  int64_t result = 0;
+  for (size_t idx = pos; idx < pos + count; ++idx) {
+    const auto digit = static_cast<unsigned>(str[idx] - '0');
+    if (digit > 9) {
+      return -1;
+    }
+    result = result * 10 + digit;
+  }
+  return result;
+}
+
+void put_digits(char *out, unsigned value, size_t count) {
+  for (size_t idx = count; idx-- > 0;) {
+    out[idx] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  }
+}
+
+} // namespace
+
+int64_t timestamp_t::from_iso_8601(std::string_view str) {
+  // "YYYY-MM-DDTHH:MM:SS" then an optional fraction and 'Z'.
+  constexpr size_t c_secs_end = 19;
+  if (str.size() < c_secs_end + 1 || str[4] != '-' || str[7] != '-' ||
+      str[10] != 'T' || str[13] != ':' || str[16] != ':' ||
+      str.back() != 'Z') {
+    bad_timestamp(str);
+  }
+  const auto year = digits(str, 0, 4);
+  const auto month = digits(str, 5, 2);
+  const auto day = digits(str, 8, 2);
+  const auto hour = digits(str, 11, 2);
+  const auto minute = digits(str, 14, 2);
+  const auto second = digits(str, 17, 2);
+  if (year < 0 || month < 1 || month > 12 || day < 1 ||
+      day > last_day_of_month(year, static_cast<unsigned>(month)) ||
+      hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0 ||
+      second > 59) {
+    bad_timestamp(str);
+  }
+
+  auto micros = int64_t{0};
+  const auto fraction = str.substr(c_secs_end, str.size() - c_secs_end - 1);
+  if (!fraction.empty()) {
+    if (fraction[0] != '.' || fraction.size() < 2 || fraction.size() > 10) {
+      bad_timestamp(str);
+    }
+    const auto num_digits = fraction.size() - 1;
+    const auto value = digits(fraction, 1, num_digits);
+    if (value < 0) {
+      bad_timestamp(str);
+    }
+    micros = value;
+    for (auto idx = num_digits; idx < 6; ++idx) {
+      micros *= 10;
+    }
+    for (auto idx = size_t{6}; idx < num_digits; ++idx) {
+      micros /= 10;
+    }
+  }
+
+  const auto days = days_from_civil(year, static_cast<unsigned>(month),
+                                    static_cast<unsigned>(day));
+  const auto secs = days * c_secs_per_day + hour * 3600 + minute * 60 + second;
+  return secs * c_micros_per_sec + micros;
+}
+
+std::string_view timestamp_t::to_chars(chars_t &buffer) const {
+  // Floor rather than truncate so that times before the epoch work.
+  auto secs = m_micros / c_micros_per_sec;
+  auto micros = m_micros % c_micros_per_sec;
+  if (micros < 0) {
+    micros += c_micros_per_sec;
+    --secs;
+  }
+  auto days = secs / c_secs_per_day;
+  auto secs_of_day = secs % c_secs_per_day;
+  if (secs_of_day < 0) {
+    secs_of_day += c_secs_per_day;
+    --days;
+  }
+  const auto civil = civil_from_days(days);
+  if (civil.year < 0 || civil.year > 9999) {
+    throw std::runtime_error("timestamp out of range: " +
+                             std::to_string(m_micros));
+  }
+
+  char *out = buffer.data();
+  put_digits(out, static_cast<unsigned>(civil.year), 4);
+  out[4] = '-';
+  put_digits(out + 5, civil.month, 2);
+  out[7] = '-';
+  put_digits(out + 8, civil.day, 2);
+  out[10] = 'T';
+  put_digits(out + 11, static_cast<unsigned>(secs_of_day / 3600), 2);
+  out[13] = ':';
+  put_digits(out + 14, static_cast<unsigned>(secs_of_day / 60 % 60), 2);
+  out[16] = ':';
+  put_digits(out + 17, static_cast<unsigned>(secs_of_day % 60), 2);
+  out[19] = '.';
+  put_digits(out + 20, static_cast<unsigned>(micros), 6);
+  out[26] = 'Z';
+  return {buffer.data(), buffer.size()};
+}
+
+std::string timestamp_t::to_iso_8601(int64_t micros) {
+  chars_t buffer;
+  return std::string{timestamp_t{micros}.to_chars(buffer)};
+}
+
+} // namespace kdr
@@ -7,22 +7,23 @@
 namespace kdr {
 namespace response {
 
-trades_t trades_t::from_json(simdjson::ondemand::document &response) {
+trades_t trades_t::from_json(simdjson::ondemand::document &response,
+                             timestamp_t recv_tm) {
   auto result = trades_t{};
-  auto buffer = std::string_view{};
+  from_json(response, recv_tm, result);
+  return result;
+}
 
-  buffer = response[header_t::c_channel].get_string();
-  const auto channel = std::string{buffer.begin(), buffer.end()};
-  buffer = response[header_t::c_type].get_string();
-  const auto type = std::string{buffer.begin(), buffer.end()};
-  result.m_header = header_t{timestamp_t::now(), channel, type};
+void trades_t::from_json(simdjson::ondemand::document &response,
+                         timestamp_t recv_tm, trades_t &result) {
+  const std::string_view type = response[header_t::c_type].get_string();
+  result.m_header = header_t{recv_tm, model::channel_trade,
+                             model::str_view_to_msg_type_t(type)};
 
-  for (simdjson::fallback::ondemand::object obj : response[c_response_data]) {
-    const auto trade = model::trade_t::from_json(obj);
-    result.m_trades.push_back(trade);
+  result.m_trades.clear();
+  for (simdjson::ondemand::object obj : response[c_response_data]) {
+    result.m_trades.push_back(model::trade_t::from_json(obj));
   }
-
-  return result;
 }
 
 boost::json::object trades_t::to_json_obj(integer_t price_precision,
@@ -43,9 +44,10 @@ boost::json::object trades_t::to_json_obj(integer_t price_precision,
         return result;
       });
 
-  const boost::json::object result = {{header_t::c_channel, m_header.channel()},
-                                      {c_response_data, trades},
-                                      {header_t::c_type, m_header.type()}};
+  const boost::json::object result = {
+      {header_t::c_channel, model::channel_t_to_str(m_header.channel())},
+      {c_response_data, trades},
+      {header_t::c_type, model::msg_type_t_to_str(m_header.type())}};
   return result;
 }
 
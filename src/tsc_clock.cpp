@@ -0,0 +1,120 @@
+#include "tsc_clock.hpp"
+
+#include <algorithm>
+#include <ctime>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define KDR_TSC 1
+#include <cpuid.h>
+#include <x86intrin.h>
+#else
+#define KDR_TSC 0
+#endif
+
+namespace kdr {
+
+namespace {
+
+/**
+ * Long enough for a usable first rate. Resyncs refine it, starting
+ * this often and backing off to c_resync_nanos, so that the error in
+ * each rate is small relative to the interval it is used over.
+ */
+constexpr int64_t c_calibration_nanos = 2'000'000;
+/** More than the rate can plausibly drift by between resyncs. */
+constexpr int64_t c_max_drift_nanos = 1'000'000;
+
+int64_t realtime_nanos() {
+  timespec spec;
+  clock_gettime(CLOCK_REALTIME, &spec);
+  return int64_t{spec.tv_sec} * 1'000'000'000 + spec.tv_nsec;
+}
+
+#if KDR_TSC
+
+// CPUID.80000007H:EDX[8]: the TSC ticks at a constant rate in every
+// P-, C- and T-state, so it can stand in for a clock.
+const bool c_have_invariant_tsc = [] {
+  unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+  if (__get_cpuid_max(0x80000000, nullptr) < 0x80000007) {
+    return false;
+  }
+  __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+  return (edx & (1u << 8)) != 0;
+}();
+
+uint64_t read_tsc() { return __rdtsc(); }
+
+#else
+
+const bool c_have_invariant_tsc = false;
+
+uint64_t read_tsc() { return 0; }
+
+#endif
+
+} // namespace
+
+bool tsc_clock_t::have_tsc() { return c_have_invariant_tsc; }
+
+tsc_clock_t::tsc_clock_t() {
+  if (!have_tsc()) {
+    return;
+  }
+  anchor();
+  const auto begin_tsc = m_anchor_tsc;
+  const auto begin_nanos = m_anchor_nanos;
+  while (realtime_nanos() - begin_nanos < c_calibration_nanos) {
+  }
+  anchor();
+  m_nanos_per_tick = double(m_anchor_nanos - begin_nanos) /
+                     double(m_anchor_tsc - begin_tsc);
+  m_resync_nanos = c_calibration_nanos;
+  m_resync_ticks = uint64_t(m_resync_nanos / m_nanos_per_tick);
+}
+
+void tsc_clock_t::anchor() {
+  // Bracket the system clock with two counter reads and pair it with
+  // their midpoint.
+  const auto before = read_tsc();
+  m_anchor_nanos = realtime_nanos();
+  const auto after = read_tsc();
+  m_anchor_tsc = before + (after - before) / 2;
+}
+
+int64_t tsc_clock_t::now_nanos() {
+  if (!have_tsc()) {
+    return realtime_nanos();
+  }
+
+  const auto tsc = read_tsc();
+  const auto ticks = tsc - m_anchor_tsc;
+  if (ticks >= m_resync_ticks) {
+    const auto prev_tsc = m_anchor_tsc;
+    const auto prev_nanos = m_anchor_nanos;
+    anchor();
+    const auto rate = double(m_anchor_nanos - prev_nanos) /
+                      double(m_anchor_tsc - prev_tsc);
+    // A step of the system clock would make for a wild rate, so only
+    // take plausible ones.
+    if (rate > m_nanos_per_tick * 0.99 && rate < m_nanos_per_tick * 1.01) {
+      m_nanos_per_tick = rate;
+    }
+    m_resync_nanos = std::min(m_resync_nanos * 2, c_resync_nanos);
+    m_resync_ticks = uint64_t(m_resync_nanos / m_nanos_per_tick);
+    // Absorb the drift since the last anchor but follow a real step
+    // back of the system clock.
+    if (m_anchor_nanos > m_last_nanos ||
+        m_last_nanos - m_anchor_nanos > c_max_drift_nanos) {
+      m_last_nanos = m_anchor_nanos;
+    }
+    return m_last_nanos;
+  }
+
+  const auto nanos =
+      m_anchor_nanos + static_cast<int64_t>(double(ticks) * m_nanos_per_tick);
+  m_last_nanos = std::max(m_last_nanos, nanos);
+  return m_last_nanos;
+}
+
+} // namespace kdr
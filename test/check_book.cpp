@@ -1,4 +1,5 @@
 #include "constants.hpp"
+#include "decimal_column.hpp"
 #include "io.hpp"
 #include "level_book.hpp"
 #include "types.hpp"
@@ -17,22 +18,20 @@
 using namespace kdr;
 
 std::vector<quote_t> extract(const arrow::ListArray &quotes_array,
-                             int64_t idx) {
+                             int64_t idx, const model::sides_t &sides) {
   auto result = std::vector<quote_t>{};
   const auto slice = std::dynamic_pointer_cast<arrow::StructArray>(
       quotes_array.value_slice(idx));
 
   const auto price_field = std::string{response::book_t::c_price};
   const auto qty_field = std::string{response::book_t::c_qty};
-  const auto price_array = std::dynamic_pointer_cast<arrow::StringArray>(
-      slice->GetFieldByName(price_field));
-  const auto qty_array = std::dynamic_pointer_cast<arrow::StringArray>(
-      slice->GetFieldByName(qty_field));
+  const auto price_array = slice->GetFieldByName(price_field);
+  const auto qty_array = slice->GetFieldByName(qty_field);
   for (auto sidx = 0; sidx < slice->length(); ++sidx) {
-    const auto price_view = price_array->Value(sidx);
-    const auto qty_view = qty_array->Value(sidx);
-    const auto quote =
-        std::make_pair(decimal_t{price_view}, decimal_t{qty_view});
+    const auto quote = std::make_pair(
+        pq::decimal_column_t::value(*price_array, sidx,
+                                    sides.price_precision()),
+        pq::decimal_column_t::value(*qty_array, sidx, sides.qty_precision()));
     result.push_back(quote);
   }
   return result;
@@ -169,7 +168,7 @@ void process_book(pq::reader_t &reader, model::level_book_t &level_book) {
     const auto &batch = *maybe_batch.ValueOrDie();
     const auto recv_tm_array = std::dynamic_pointer_cast<arrow::Int64Array>(
         batch.GetColumnByName(std::string{response::header_t::c_recv_tm}));
-    const auto type_array = std::dynamic_pointer_cast<arrow::StringArray>(
+    const auto type_array = std::dynamic_pointer_cast<arrow::Int8Array>(
         batch.GetColumnByName(std::string{response::header_t::c_type}));
     const auto bids_array = std::dynamic_pointer_cast<arrow::ListArray>(
         batch.GetColumnByName(std::string{response::book_t::c_bids}));
@@ -184,19 +183,25 @@ void process_book(pq::reader_t &reader, model::level_book_t &level_book) {
 
     for (auto idx = 0; idx < batch.num_rows(); ++idx) {
       const auto recv_tm = recv_tm_array->Value(idx);
-      const auto type = type_array->Value(idx);
-      const auto bids = extract(*bids_array, idx);
-      const auto asks = extract(*asks_array, idx);
+      const auto type = model::msg_type_t{type_array->Value(idx)};
       const auto crc32 = crc32_array->Value(idx);
       const auto symbol = symbol_array->Value(idx);
-      const auto timestamp = timestamp_array->Value(idx);
-      const auto header = response::header_t{
-          recv_tm, "book", std::string{type.begin(), type.end()}};
       const auto symbol_str = std::string{symbol.begin(), symbol.end()};
+      const auto &sides = level_book.sides(symbol_str);
+      const auto bids = extract(*bids_array, idx, sides);
+      const auto asks = extract(*asks_array, idx, sides);
+      const auto timestamp = timestamp_array->Value(idx);
+      const auto header =
+          response::header_t{recv_tm, model::channel_book, type};
       const auto response =
           response::book_t{header, asks, bids, crc32, symbol_str, timestamp};
       try {
         level_book.accept(response);
+      } catch (const model::checksum_error_t &ex) {
+        // The recorder writes a failing update before the gap row that
+        // marks its resync, so report it and carry on.
+        std::cerr << "idx: " << idx << " symbol: " << symbol_str << " "
+                  << ex.what() << std::endl;
       } catch (const std::exception &ex) {
         std::cerr << "idx: " << idx << " recv_tm:  " << recv_tm << std::endl;
         dump_sides(level_book.sides(symbol_str));
@@ -235,7 +240,8 @@ int main(int argc, char *argv[]) {
     const model::depth_t book_depth{atol(depth_result.ValueOrDie().c_str())};
     std::cout << "book_depth: " << book_depth << std::endl;
 
-    auto level_book = model::level_book_t{book_depth};
+    model::symbol_table_t symbols;
+    auto level_book = model::level_book_t{book_depth, symbols};
     process_pairs(pairs_filename, level_book);
     process_book(book_reader, level_book);
   } catch (const std::exception &ex) {
@@ -0,0 +1,110 @@
+#include <doctest/doctest.h>
+
+#include <alloc_counter.hpp>
+#include <level_book.hpp>
+#include <trades.hpp>
+
+#include <simdjson.h>
+
+#include <new>
+#include <string>
+
+namespace {
+
+const std::string pair_str = R"RESPONSE(
+[
+  {
+    "base": "GST",
+    "cost_min": 0.5,
+    "cost_precision": 5,
+    "has_index": false,
+    "marginable": false,
+    "price_increment": 0.001,
+    "price_precision": 3,
+    "qty_increment": 1E-8,
+    "qty_min": 200.0,
+    "qty_precision": 8,
+    "quote": "USD",
+    "status": "online",
+    "symbol": "GST/USD"
+  }
+]
+)RESPONSE";
+
+const std::string snapshot_str = R"RESPONSE(
+{"channel":"book","type":"snapshot","data":[{"symbol":"GST/USD","bids":[{"price":0.016,"qty":255965.95133811},{"price":0.015,"qty":264465.46682136},{"price":0.014,"qty":198234.50375152},{"price":0.013,"qty":263077.71115063},{"price":0.012,"qty":135283.23181445},{"price":0.011,"qty":232726.34707055},{"price":0.010,"qty":211909.56878553},{"price":0.009,"qty":16666.66666666},{"price":0.008,"qty":13600.00000000},{"price":0.007,"qty":1000.00000000}],"asks":[{"price":0.017,"qty":94510.50669693},{"price":0.018,"qty":232489.98702916},{"price":0.019,"qty":244770.01655926},{"price":0.020,"qty":103394.23779803},{"price":0.021,"qty":120226.44704447},{"price":0.022,"qty":122811.44535027},{"price":0.023,"qty":185766.68965043},{"price":0.024,"qty":95339.83830809},{"price":0.025,"qty":32960.86333331},{"price":0.026,"qty":86326.77204454}],"checksum":1931231958}]}
+)RESPONSE";
+
+const std::string trades_str = R"RESPONSE(
+{"channel":"trade","type":"update","data":[{"symbol":"MATIC/USD","side":"sell","price":0.5117,"qty":40.0,"ord_type":"market","trade_id":4665906,"timestamp":"2023-09-25T07:49:37.708706Z"},{"symbol":"MATIC/USD","side":"sell","price":0.5116,"qty":10.0,"ord_type":"limit","trade_id":4665907,"timestamp":"2023-09-25T07:49:37.708706Z"}]}
+)RESPONSE";
+
+} // namespace
+
+TEST_SUITE("alloc_counter") {
+
+  TEST_CASE("counts this thread's allocations") {
+    const auto allocs = kdr::thread_allocs();
+    const auto frees = kdr::thread_frees();
+    // Called directly, as a new-expression's allocation may be elided.
+    void *ptr = ::operator new(64);
+    CHECK(kdr::thread_allocs() == allocs + 1);
+    ::operator delete(ptr);
+    CHECK(kdr::thread_frees() == frees + 1);
+  }
+
+  TEST_CASE("recycled trades_t reuses its storage") {
+    simdjson::ondemand::parser parser;
+    simdjson::padded_string response{trades_str};
+    auto trades = kdr::response::trades_t{};
+
+    simdjson::ondemand::document warm_doc = parser.iterate(response);
+    kdr::response::trades_t::from_json(warm_doc, kdr::timestamp_t{}, trades);
+    REQUIRE(trades.size() == 2);
+    const auto *first = &*trades.begin();
+
+    simdjson::ondemand::document doc = parser.iterate(response);
+    kdr::response::trades_t::from_json(doc, kdr::timestamp_t{}, trades);
+    CHECK(trades.size() == 2);
+    CHECK(&*trades.begin() == first);
+    CHECK(trades.header().channel() == kdr::model::channel_trade);
+  }
+
+#if KDR_FLAT_SIDES
+  TEST_CASE("streaming into a warm book does not allocate") {
+    kdr::model::symbol_table_t symbols;
+    auto book = kdr::model::level_book_t{kdr::model::depth_10, symbols};
+
+    simdjson::ondemand::parser parser;
+    simdjson::padded_string pair_response{pair_str};
+    simdjson::ondemand::document pair_doc = parser.iterate(pair_response);
+    for (simdjson::ondemand::object pair_obj : pair_doc) {
+      book.accept(kdr::model::pair_t::from_json(pair_obj));
+    }
+
+    const kdr::response::book_stream_t stream{
+        [&book](const kdr::response::header_t &header, kdr::symbol_id_t id,
+                const std::string &) {
+          book.begin(header, id);
+          return true;
+        },
+        [&book](const kdr::bid_t &bid) { book.accept_bid(bid); },
+        [&book](const kdr::ask_t &ask) { book.accept_ask(ask); },
+        [&book](const std::string &, uint64_t crc32, kdr::timestamp_t) {
+          book.end(crc32);
+        }};
+
+    simdjson::padded_string snap_response{snapshot_str};
+    simdjson::ondemand::document warm_doc = parser.iterate(snap_response);
+    kdr::response::book_t::stream_json(warm_doc, kdr::timestamp_t{}, symbols,
+                                       stream);
+
+    const auto allocs = kdr::thread_allocs();
+    simdjson::ondemand::document doc = parser.iterate(snap_response);
+    kdr::response::book_t::stream_json(doc, kdr::timestamp_t{}, symbols,
+                                       stream);
+    CHECK(kdr::thread_allocs() == allocs);
+    CHECK(book.crc32("GST/USD") == 1931231958);
+  }
+#endif
+}
@@ -78,7 +78,7 @@ TEST_SUITE("asset_t") {
     simdjson::ondemand::parser parser;
     simdjson::padded_string padded{test_str};
     simdjson::ondemand::document doc = parser.iterate(padded);
-    for (simdjson::fallback::ondemand::object obj : doc) {
+    for (simdjson::ondemand::object obj : doc) {
       const asset_t actual = asset_t::from_json(obj);
       CHECK(expected == actual);
     }
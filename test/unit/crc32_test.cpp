@@ -0,0 +1,59 @@
+#include <doctest/doctest.h>
+
+#include <crc32.hpp>
+
+#include <boost/crc.hpp>
+
+#include <string>
+
+TEST_SUITE("crc32_t") {
+
+  TEST_CASE("matches boost::crc_32_type") {
+    CHECK(kdr::crc32_t{}.checksum() == boost::crc_32_type{}.checksum());
+
+    auto input = std::string{};
+    for (size_t size = 0; size < 100; ++size) {
+      boost::crc_32_type expected;
+      expected.process_bytes(input.data(), input.size());
+
+      kdr::crc32_t actual;
+      actual.process_bytes(input);
+      CHECK(actual.checksum() == expected.checksum());
+
+      // In pieces, as the book checksum is fed.
+      kdr::crc32_t pieces;
+      pieces.process_bytes(input.substr(0, size / 3));
+      pieces.process_bytes(input.substr(size / 3));
+      CHECK(pieces.checksum() == expected.checksum());
+
+      input.push_back(char('0' + size * 7 % 10));
+    }
+  }
+
+  TEST_CASE("clmul and table kernels agree") {
+    auto input = std::string(1024, '\0');
+    for (size_t idx = 0; idx < input.size(); ++idx) {
+      input[idx] = char(idx * 131 + 17);
+    }
+    for (size_t size = 0; size <= input.size(); ++size) {
+      boost::crc_32_type expected;
+      expected.process_bytes(input.data(), size);
+      kdr::crc32_t actual;
+      actual.process_bytes(input.data(), size);
+      CHECK(actual.checksum() == expected.checksum());
+
+      if (kdr::crc32_t::have_clmul() &&
+          size >= kdr::crc32_t::c_min_clmul_size && size % 16 == 0) {
+        CHECK(kdr::crc32_t::update_clmul(0x12345678, input.data(), size) ==
+              kdr::crc32_t::update_table(0x12345678, input.data(), size));
+      }
+    }
+    CHECK_THROWS(kdr::crc32_t::update_clmul(0, input.data(), 17));
+  }
+
+  TEST_CASE("known value") {
+    kdr::crc32_t crc;
+    crc.process_bytes(std::string_view{"123456789"});
+    CHECK(crc.checksum() == 0xcbf43926);
+  }
+}
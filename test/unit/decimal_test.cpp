@@ -37,7 +37,92 @@ TEST_SUITE("decimal_t") {
     CHECK(dst == decimal_t());
     dst = src;
     CHECK(dst == src);
-    CHECK(dst.str_view(3) == src.str_view(3));
+    CHECK(dst.str(3) == src.str(3));
+  }
+
+  TEST_CASE("fixed point representation") {
+    const auto value = decimal_t(std::string("0123.4500"));
+    CHECK(value.mantissa() == 12345);
+    CHECK(value.scale() == 2);
+    CHECK(decimal_t().mantissa() == 0);
+    CHECK(decimal_t(std::string("0.000")).scale() == 0);
+    CHECK(decimal_t(std::string("0.00000001")).str(8) == "0.00000001");
+    CHECK(decimal_t(std::string("123.456")).str(0) == "123");
+    CHECK(decimal_t(std::string("123.456")).double_value(2) == 123.45);
+
+    CHECK(std::hash<decimal_t>{}(decimal_t(std::string("1.10"))) ==
+          std::hash<decimal_t>{}(decimal_t(std::string("1.1"))));
+
+    CHECK_THROWS(decimal_t(std::string("12345678901234567890")));
+    CHECK_THROWS(decimal_t(std::string("0.0000000000000000001")));
+    CHECK_THROWS(decimal_t(std::string("12a")));
+  }
+
+  TEST_CASE("exponents") {
+    CHECK(decimal_t(std::string("1E-8")).str(8) == "0.00000001");
+    CHECK(decimal_t(std::string("1e-8")).scale() == 8);
+    CHECK(decimal_t(std::string("1.5e3")).str() == "1500");
+    CHECK(decimal_t(std::string("2.50E+1")).str() == "25");
+    CHECK(decimal_t(std::string("100e-2")).str() == "1");
+    CHECK_THROWS(decimal_t(std::string("1e")));
+    CHECK_THROWS(decimal_t(std::string("1e-19")));
+    CHECK(decimal_t(std::string("100e-20")).scale() == 18);
+    CHECK(decimal_t(std::string("0.0e-9223372036854775808")).str() == "0.0");
+    CHECK_THROWS(decimal_t(std::string("1e19")));
+    CHECK_THROWS(decimal_t(std::string("1e-9223372036854775808")));
+    CHECK_THROWS(decimal_t(std::string("1e9223372036854775807")));
+  }
+
+  TEST_CASE("simd and scalar parsers agree") {
+    const auto tokens = std::vector<std::string>{
+        "0",           "0.0",             "0000.0000",        "1",
+        "1.",          "10",              "1500.00",          "0.05",
+        "0.00000001",  "1234.567",        "1234.567   ",      "13600.00000000",
+        "99999.12345", "123456789012345", "12345678.9012345", "0.10000",
+        "7.000000001", "65000.1 ",        "1.5e3"};
+    for (const auto &token : tokens) {
+      const auto expected = decimal_t::parse_scalar(token);
+      auto actual = decimal_t{};
+      if (decimal_t::parse_simd(token, actual)) {
+        CHECK(actual == expected);
+      }
+      CHECK(decimal_t(token) == expected);
+    }
+
+    auto value = decimal_t{};
+    CHECK(decimal_t::parse_simd("65000.1", value) == decimal_t::have_simd());
+    CHECK_FALSE(decimal_t::parse_simd("1.5e3", value));
+    CHECK_FALSE(decimal_t::parse_simd("1234567890.1234567", value));
+  }
+
+  TEST_CASE("units") {
+    CHECK(decimal_t(std::string("123.45")).units(2) == 12345);
+    CHECK(decimal_t(std::string("123.45")).units(5) == 12345000);
+    CHECK(decimal_t(std::string("123.456")).units(2) == 12345);
+    CHECK(decimal_t(std::string("0.00001336")).units(8) == 1336);
+    CHECK(decimal_t().units(8) == 0);
+    CHECK_THROWS(decimal_t(std::string("123456789012345")).units(8));
+
+    CHECK(decimal_t::from_units(12345000, 5) ==
+          decimal_t(std::string("123.45")));
+    CHECK(decimal_t::from_units(1336, 8) ==
+          decimal_t(std::string("0.00001336")));
+    CHECK(decimal_t::from_units(0, 8) == decimal_t());
+    CHECK_THROWS(decimal_t::from_units(-1, 8));
+
+    for (const auto &token : {"2488884937.56192", "65000.1", "0.0000086"}) {
+      const auto value = decimal_t(std::string(token));
+      CHECK(decimal_t::from_units(value.units(8), 8) == value);
+    }
+  }
+
+  TEST_CASE("comparisons across scales") {
+    CHECK(decimal_t(std::string("0.016")) > decimal_t(std::string("0.01")));
+    CHECK(decimal_t(std::string("0.01")) < decimal_t(std::string("0.016")));
+    CHECK(decimal_t(std::string("2")) > decimal_t(std::string("1.99999999")));
+    CHECK(decimal_t(std::string("1.5")) < decimal_t(std::string("2")));
+    CHECK(decimal_t(std::string("100000.1")) >
+          decimal_t(std::string("99999.123456789")));
   }
 
   TEST_CASE("str with precision") {
@@ -101,10 +186,15 @@ TEST_SUITE("decimal_t") {
       const kdr::decimal_t decimal{token};
       CHECK(decimal.str(precision) == token);
 
-      const boost::crc_32_type in_crc;
-      auto actual_crc = in_crc;
+      kdr::crc32_t actual_crc;
       decimal.process(actual_crc, precision);
-      CHECK(actual_crc() == expected);
+      CHECK(actual_crc.checksum() == expected);
+
+      decimal_t::chars_t buffer;
+      auto crc_str = decimal.str(precision);
+      crc_str.erase(crc_str.find('.'), 1);
+      crc_str.erase(0, crc_str.find_first_not_of('0'));
+      CHECK(decimal.crc_chars(buffer, precision) == crc_str);
     }
   }
 }
@@ -34,13 +34,14 @@ TEST_SUITE("level_book_t") {
 )RESPONSE";
 
   TEST_CASE("book_t doc example snapshot") {
-    auto book = kdr::model::level_book_t{kdr::model::depth_10};
+    kdr::model::symbol_table_t symbols;
+    auto book = kdr::model::level_book_t{kdr::model::depth_10, symbols};
 
     simdjson::ondemand::parser parser;
 
     simdjson::padded_string pair_response{pair_str};
     simdjson::ondemand::document pair_doc = parser.iterate(pair_response);
-    for (simdjson::fallback::ondemand::object pair_obj : pair_doc) {
+    for (simdjson::ondemand::object pair_obj : pair_doc) {
       const auto pair = kdr::model::pair_t::from_json(pair_obj);
       book.accept(pair);
     }
@@ -50,4 +51,83 @@ TEST_SUITE("level_book_t") {
     const auto snap = kdr::response::book_t::from_json(snap_doc);
     book.accept(snap);
   }
+
+  TEST_CASE("checksum mismatch, gap and resync") {
+    kdr::model::symbol_table_t symbols;
+    auto book = kdr::model::level_book_t{kdr::model::depth_10, symbols};
+
+    simdjson::ondemand::parser parser;
+
+    simdjson::padded_string pair_response{pair_str};
+    simdjson::ondemand::document pair_doc = parser.iterate(pair_response);
+    for (simdjson::ondemand::object pair_obj : pair_doc) {
+      const auto pair = kdr::model::pair_t::from_json(pair_obj);
+      book.accept(pair);
+    }
+
+    auto bad_snapshot_str = snapshot_str;
+    const std::string checksum = "1931231958";
+    bad_snapshot_str.replace(bad_snapshot_str.find(checksum), checksum.size(),
+                             "1");
+    simdjson::padded_string bad_response{bad_snapshot_str};
+    simdjson::ondemand::document bad_doc = parser.iterate(bad_response);
+    const auto bad = kdr::response::book_t::from_json(bad_doc);
+    CHECK_THROWS_AS(book.accept(bad), kdr::model::checksum_error_t);
+
+    book.accept(kdr::response::book_t::gap("GST/USD", kdr::timestamp_t{}));
+    CHECK(book.sides("GST/USD").bids().empty());
+    CHECK(book.sides("GST/USD").asks().empty());
+
+    simdjson::padded_string snap_response{snapshot_str};
+    simdjson::ondemand::document snap_doc = parser.iterate(snap_response);
+    const auto snap = kdr::response::book_t::from_json(snap_doc);
+    book.accept(snap);
+    CHECK(book.crc32("GST/USD") == snap.crc32());
+  }
+
+  TEST_CASE("stream snapshot into book") {
+    kdr::model::symbol_table_t symbols;
+    auto book = kdr::model::level_book_t{kdr::model::depth_10, symbols};
+
+    simdjson::ondemand::parser parser;
+
+    simdjson::padded_string pair_response{pair_str};
+    simdjson::ondemand::document pair_doc = parser.iterate(pair_response);
+    for (simdjson::ondemand::object pair_obj : pair_doc) {
+      const auto pair = kdr::model::pair_t::from_json(pair_obj);
+      book.accept(pair);
+    }
+
+    size_t num_levels = 0;
+    const kdr::response::book_stream_t stream{
+        [&book](const kdr::response::header_t &header, kdr::symbol_id_t id,
+                const std::string &) {
+          book.begin(header, id);
+          return true;
+        },
+        [&book, &num_levels](const kdr::bid_t &bid) {
+          book.accept_bid(bid);
+          ++num_levels;
+        },
+        [&book, &num_levels](const kdr::ask_t &ask) {
+          book.accept_ask(ask);
+          ++num_levels;
+        },
+        [&book](const std::string &, uint64_t crc32, kdr::timestamp_t) {
+          book.end(crc32);
+        }};
+
+    simdjson::padded_string snap_response{snapshot_str};
+    simdjson::ondemand::document snap_doc = parser.iterate(snap_response);
+    kdr::response::book_t::stream_json(snap_doc, kdr::timestamp_t{}, symbols,
+                                       stream);
+    CHECK(num_levels == 20);
+    CHECK(book.crc32("GST/USD") == 1931231958);
+    CHECK(book.sides("GST/USD").bids().size() == 10);
+    CHECK(book.sides("GST/USD").asks().size() == 10);
+
+    const auto id = symbols.id("GST/USD");
+    CHECK(id == 0);
+    CHECK(&book.sides(id) == &book.sides("GST/USD"));
+  }
 }
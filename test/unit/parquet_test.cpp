@@ -1,13 +1,25 @@
 #include <doctest/doctest.h>
 
+#include <async_writer.hpp>
+#include <book_sink.hpp>
+#include <decimal_column.hpp>
+#include <partitioned_writer.hpp>
+
 #include <arrow/api.h>
 #include <arrow/io/api.h>
 #include <arrow/io/memory.h>
 #include <parquet/arrow/reader.h>
 #include <parquet/arrow/writer.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
 #include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
 
 TEST_SUITE("parquet") {
 
@@ -253,4 +265,595 @@ TEST_SUITE("parquet") {
         arrow::RecordBatch::Make(schema, 1, columns);
     mw.write(*batch);
   }
+
+  TEST_CASE("decimal_column_t round trip") {
+    using kdr::decimal_t;
+    using kdr::pq::decimal_column_t;
+
+    const auto values = std::vector<decimal_t>{
+        decimal_t{"0"}, decimal_t{"65000.1"}, decimal_t{"0.00001336"},
+        decimal_t{"2488884937.56192"}};
+    for (const auto format : {kdr::model::price_format_string,
+                              kdr::model::price_format_decimal128,
+                              kdr::model::price_format_int64}) {
+      auto column = decimal_column_t{format};
+      for (const auto &value : values) {
+        column.append(value, 8);
+      }
+      std::shared_ptr<arrow::Array> array;
+      column.finish(&array);
+      CHECK(array->type()->Equals(decimal_column_t::type(format)));
+      for (size_t idx = 0; idx < values.size(); ++idx) {
+        CHECK(decimal_column_t::value(*array, int64_t(idx), 8) ==
+              values[idx]);
+      }
+    }
+  }
+
+  TEST_CASE("decimal_column_t truncates every format alike") {
+    using kdr::decimal_t;
+    using kdr::pq::decimal_column_t;
+
+    const auto value = decimal_t{"0.123456789"};
+    for (const auto format : {kdr::model::price_format_string,
+                              kdr::model::price_format_decimal128,
+                              kdr::model::price_format_int64}) {
+      auto column = decimal_column_t{format};
+      column.append(value, 4);
+      std::shared_ptr<arrow::Array> array;
+      column.finish(&array);
+      CHECK(decimal_column_t::value(*array, 0, 4) == decimal_t{"0.1234"});
+      if (format == kdr::model::price_format_decimal128) {
+        // Nothing beyond the precision is stored, either.
+        CHECK(decimal_column_t::value(*array, 0, 18) == decimal_t{"0.1234"});
+      }
+    }
+  }
+
+  TEST_CASE("async_writer_t rethrows a failed write") {
+    const auto schema = arrow::schema(arrow::FieldVector{
+        arrow::field("int_field", arrow::int64(), false),
+    });
+    const auto make_batch = [](const std::shared_ptr<arrow::Schema> &schema,
+                               auto &&builder) {
+      std::shared_ptr<arrow::Array> array;
+      PARQUET_THROW_NOT_OK(builder.Finish(&array));
+      return arrow::RecordBatch::Make(
+          schema, 1, std::vector<std::shared_ptr<arrow::Array>>{array});
+    };
+    const auto filename =
+        (std::filesystem::temp_directory_path() / "async_writer_error_test.pq")
+            .string();
+    {
+      auto async_writer = kdr::pq::async_writer_t{4};
+      auto writer = kdr::pq::writer_t{filename, schema};
+
+      // Not the writer's schema.
+      const auto bad_schema = arrow::schema(arrow::FieldVector{
+          arrow::field("string_field", arrow::utf8(), false),
+      });
+      auto bad_builder = arrow::StringBuilder{};
+      PARQUET_THROW_NOT_OK(bad_builder.Append("bogus"));
+      async_writer.write(writer, make_batch(bad_schema, bad_builder), 0);
+      CHECK_THROWS(async_writer.drain());
+      CHECK(async_writer.num_errors() == 1);
+
+      // Reported once, after which writing carries on.
+      auto builder = arrow::Int64Builder{};
+      PARQUET_THROW_NOT_OK(builder.Append(1));
+      async_writer.write(writer, make_batch(schema, builder), 0);
+      async_writer.drain();
+      CHECK(async_writer.num_errors() == 1);
+    }
+    std::filesystem::remove(filename);
+  }
+
+  TEST_CASE("async_writer_t writes batches in order") {
+    const auto schema = arrow::schema(arrow::FieldVector{
+        arrow::field("int_field", arrow::int64(), false),
+    });
+    const auto filename =
+        (std::filesystem::temp_directory_path() / "async_writer_test.pq")
+            .string();
+    const auto num_batches = int64_t{20};
+    for (const auto max_queued : {size_t{0}, size_t{1}, size_t{4}}) {
+      {
+        auto async_writer = kdr::pq::async_writer_t{max_queued};
+        auto writer = kdr::pq::writer_t{filename, schema};
+        for (int64_t idx = 0; idx < num_batches; ++idx) {
+          auto builder = arrow::Int64Builder{};
+          PARQUET_THROW_NOT_OK(builder.Append(idx));
+          std::shared_ptr<arrow::Array> array;
+          PARQUET_THROW_NOT_OK(builder.Finish(&array));
+          const auto columns =
+              std::vector<std::shared_ptr<arrow::Array>>{array};
+          async_writer.write(
+              writer, arrow::RecordBatch::Make(schema, 1, columns), idx);
+        }
+        async_writer.drain();
+        CHECK(async_writer.queue_depth() == 0);
+      }
+
+      auto reader = kdr::pq::reader_t{filename};
+      auto expected = int64_t{0};
+      for (const auto &maybe_batch : *reader.record_batch_reader()) {
+        const auto &batch = *maybe_batch.ValueOrDie();
+        const auto &values =
+            static_cast<const arrow::Int64Array &>(*batch.column(0));
+        for (int64_t idx = 0; idx < values.length(); ++idx) {
+          CHECK(values.Value(idx) == expected++);
+        }
+      }
+      CHECK(expected == num_batches);
+    }
+  }
+
+  std::shared_ptr<arrow::RecordBatch> int_batch(
+      const std::shared_ptr<arrow::Schema> &schema, int64_t value) {
+    auto builder = arrow::Int64Builder{};
+    PARQUET_THROW_NOT_OK(builder.Append(value));
+    std::shared_ptr<arrow::Array> array;
+    PARQUET_THROW_NOT_OK(builder.Finish(&array));
+    return arrow::RecordBatch::Make(
+        schema, 1, std::vector<std::shared_ptr<arrow::Array>>{array});
+  }
+
+  int64_t num_rows(const std::string &filename) {
+    auto reader = kdr::pq::reader_t{filename};
+    auto result = int64_t{0};
+    for (const auto &maybe_batch : *reader.record_batch_reader()) {
+      result += maybe_batch.ValueOrDie()->num_rows();
+    }
+    return result;
+  }
+
+  std::vector<std::string> sorted_files(const std::filesystem::path &dir) {
+    auto result = std::vector<std::string>{};
+    for (const auto &entry : std::filesystem::directory_iterator{dir}) {
+      result.push_back(entry.path().string());
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+  TEST_CASE("book_sink_t carries on after a failed write") {
+    const auto dir = std::filesystem::temp_directory_path() / "kdr_book_sink";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const auto int_schema = arrow::schema(arrow::FieldVector{
+        arrow::field("int_field", arrow::int64(), false),
+    });
+
+    const auto expected_rows = 3 * 4096;
+    auto async_writer = kdr::pq::async_writer_t{4};
+    {
+      auto sink = kdr::pq::book_sink_t{dir.string(),
+                                       1,
+                                       10,
+                                       kdr::model::price_format_string,
+                                       async_writer,
+                                       {},
+                                       {},
+                                       {}};
+
+      // Another writer's failure comes back with the sink's next write.
+      auto bad_writer =
+          kdr::pq::writer_t{(dir / "bad.pq").string(), int_schema};
+      auto builder = arrow::StringBuilder{};
+      PARQUET_THROW_NOT_OK(builder.Append("bogus"));
+      std::shared_ptr<arrow::Array> array;
+      PARQUET_THROW_NOT_OK(builder.Finish(&array));
+      const auto bad_schema = arrow::schema(arrow::FieldVector{
+          arrow::field("string_field", arrow::utf8(), false),
+      });
+      async_writer.write(
+          bad_writer,
+          arrow::RecordBatch::Make(
+              bad_schema, 1, std::vector<std::shared_ptr<arrow::Array>>{array}),
+          0);
+      for (int idx = 0; idx < 5000 && async_writer.num_errors() == 0; ++idx) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+      }
+      REQUIRE(async_writer.num_errors() == 1);
+
+      const auto header = kdr::response::header_t{
+          kdr::timestamp_t{}, kdr::model::channel_book,
+          kdr::model::msg_type_update};
+      for (int idx = 0; idx < expected_rows; ++idx) {
+        sink.begin(header, "BTC/USD", 1, 8);
+        sink.accept_bid({kdr::decimal_t{"100.5"}, kdr::decimal_t{"0.25"}});
+        CHECK_NOTHROW(sink.end(0, kdr::timestamp_t{}));
+      }
+    }
+    CHECK(async_writer.num_errors() == 1);
+
+    // Every row made it, in whole batches.
+    CHECK(num_rows(kdr::pq::parquet_filename(dir.string(), "book", 1)) ==
+          expected_rows);
+  }
+
+  TEST_CASE("writer_t rotates files by size") {
+    const auto schema = arrow::schema(arrow::FieldVector{
+        arrow::field("int_field", arrow::int64(), false),
+    });
+    const auto dir = std::filesystem::temp_directory_path() / "kdr_size";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const auto filename = [&dir](int64_t start_micros) {
+      return (dir / (std::to_string(start_micros) + ".test.pq")).string();
+    };
+
+    // A row group per batch, so that each batch reaches the file and
+    // several fit below the limit.
+    auto properties = kdr::pq::writer_properties_t{};
+    properties.row_group_size = 1;
+    const auto max_bytes = int64_t{1024};
+    const auto num_batches = int64_t{40};
+    {
+      auto writer = kdr::pq::writer_t{
+          filename, schema, 1, {0, max_bytes}, properties, [] {
+            return int64_t{1000};
+          }};
+      for (int64_t idx = 0; idx < num_batches; ++idx) {
+        writer.write(*int_batch(schema, idx));
+      }
+    }
+
+    const auto filenames = sorted_files(dir);
+    REQUIRE(filenames.size() > 1);
+    CHECK(filenames.size() < size_t(num_batches));
+    CHECK(filenames.front() == filename(1));
+    auto total_rows = int64_t{0};
+    for (const auto &name : filenames) {
+      CHECK(name.ends_with(".test.pq"));
+      total_rows += num_rows(name);
+      if (name != filenames.back()) {
+        CHECK(std::filesystem::file_size(name) >= size_t(max_bytes));
+      }
+    }
+    CHECK(total_rows == num_batches);
+  }
+
+  TEST_CASE("writer_t rotates files by interval") {
+    const auto schema = arrow::schema(arrow::FieldVector{
+        arrow::field("int_field", arrow::int64(), false),
+    });
+    const auto dir = std::filesystem::temp_directory_path() / "kdr_interval";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const auto filename = [&dir](int64_t start_micros) {
+      return (dir / (std::to_string(start_micros) + ".test.pq")).string();
+    };
+
+    auto now = int64_t{500};
+    {
+      auto writer = kdr::pq::writer_t{
+          filename, schema, now, {1000, 0}, {}, [&now] { return now; }};
+      // Rows go by their own time, however late they are written.
+      now = 5000;
+      writer.write(*int_batch(schema, 0), 600);
+      writer.write(*int_batch(schema, 1), 999);
+      CHECK(writer.filename() == filename(500));
+      writer.write(*int_batch(schema, 2), 1000);
+      CHECK(writer.filename() == filename(1000));
+      CHECK(std::filesystem::exists(filename(500)));
+
+      // No more batches: the file still ends with its interval.
+      now = 1999;
+      writer.close_if_due();
+      CHECK(std::filesystem::exists(filename(1000) + ".tmp"));
+      now = 2000;
+      writer.close_if_due();
+      CHECK(writer.filename().empty());
+      CHECK(std::filesystem::exists(filename(1000)));
+    }
+
+    const auto filenames = sorted_files(dir);
+    REQUIRE(filenames.size() == 2);
+    CHECK(num_rows(filename(500)) == 2);
+    CHECK(num_rows(filename(1000)) == 1);
+  }
+
+  TEST_CASE("async_writer_t closes idle files on a tick") {
+    const auto schema = arrow::schema(arrow::FieldVector{
+        arrow::field("int_field", arrow::int64(), false),
+    });
+    const auto dir = std::filesystem::temp_directory_path() / "kdr_tick";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const auto filename = [&dir](int64_t start_micros) {
+      return (dir / (std::to_string(start_micros) + ".test.pq")).string();
+    };
+
+    auto now = std::atomic<int64_t>{500};
+    auto async_writer =
+        kdr::pq::async_writer_t{4, std::chrono::milliseconds{1}};
+    auto writer = kdr::pq::writer_t{
+        filename, schema, now, {1000, 0}, {}, [&now] { return now.load(); }};
+    async_writer.add(writer);
+    async_writer.write(writer, int_batch(schema, 0), 500);
+    async_writer.drain();
+    CHECK(std::filesystem::exists(filename(500) + ".tmp"));
+
+    now = 1000;
+    for (int idx = 0; idx < 5000 && !std::filesystem::exists(filename(500));
+         ++idx) {
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    async_writer.remove(writer);
+    CHECK(std::filesystem::exists(filename(500)));
+    CHECK(!std::filesystem::exists(filename(500) + ".tmp"));
+    CHECK(num_rows(filename(500)) == 1);
+  }
+
+  TEST_CASE("partitioned_writer_t splits batches by symbol") {
+    const auto schema = arrow::schema(arrow::FieldVector{
+        arrow::field("symbol", arrow::utf8(), false),
+        arrow::field("int_field", arrow::int64(), false),
+    });
+    const auto dir =
+        std::filesystem::temp_directory_path() / "kdr_partitioned";
+    std::filesystem::remove_all(dir);
+
+    const auto symbols =
+        std::vector<std::string>{"BTC/USD", "ETH/USD", "BTC/USD", "SOL/USD"};
+    // 2024-09-10, twice, then the day after.
+    const auto day_micros = int64_t{86'400'000'000};
+    const auto batch_micros = std::vector<int64_t>{
+        1725999834586832, 1725999834586833, 1725999834586832 + day_micros};
+    const auto num_batches = int64_t(batch_micros.size());
+
+    // Writing every batch through, either one partition per symbol,
+    // or two open at a time so that every symbol evicts the least
+    // recently written one.
+    for (const auto max_open : {size_t{0}, size_t{2}}) {
+      std::filesystem::remove_all(dir);
+      {
+        auto writer = kdr::pq::partitioned_writer_t{
+            dir.string(), "test", schema, {}, {},
+            kdr::pq::partitioning_t{true, max_open, 0}, 2};
+        for (int64_t idx = 0; idx < num_batches; ++idx) {
+          auto symbol_builder = arrow::StringBuilder{};
+          auto int_builder = arrow::Int64Builder{};
+          for (const auto &symbol : symbols) {
+            PARQUET_THROW_NOT_OK(symbol_builder.Append(symbol));
+            PARQUET_THROW_NOT_OK(int_builder.Append(idx));
+          }
+          std::shared_ptr<arrow::Array> symbol_array;
+          std::shared_ptr<arrow::Array> int_array;
+          PARQUET_THROW_NOT_OK(symbol_builder.Finish(&symbol_array));
+          PARQUET_THROW_NOT_OK(int_builder.Finish(&int_array));
+          const auto columns = std::vector<std::shared_ptr<arrow::Array>>{
+              symbol_array, int_array};
+          writer.write(*arrow::RecordBatch::Make(
+                           schema, int64_t(symbols.size()), columns),
+                       batch_micros[idx]);
+          // A new day opens new parts; the old stay open until closed.
+          CHECK(writer.num_open() ==
+                (max_open == 0 ? size_t(idx < 2 ? 3 : 6) : max_open));
+        }
+        // One eviction in the first batch, three in each after it.
+        CHECK(writer.num_evictions() == (max_open == 0 ? 0 : 7));
+      }
+
+      auto num_rows = std::map<std::string, int64_t>{};
+      auto num_date_rows = std::map<std::string, int64_t>{};
+      for (const auto &entry :
+           std::filesystem::recursive_directory_iterator{dir}) {
+        if (!entry.is_regular_file()) {
+          continue;
+        }
+        const auto name = entry.path().filename().string();
+        CHECK(name.starts_with("part-"));
+        CHECK(name.ends_with(".2.pq"));
+        const auto date_dir = entry.path().parent_path();
+        const auto symbol_dir = date_dir.parent_path().filename().string();
+        auto reader = kdr::pq::reader_t{entry.path().string()};
+        for (const auto &maybe_batch : *reader.record_batch_reader()) {
+          const auto &batch = *maybe_batch.ValueOrDie();
+          const auto &batch_symbols =
+              static_cast<const arrow::StringArray &>(*batch.column(0));
+          for (int64_t idx = 0; idx < batch.num_rows(); ++idx) {
+            auto symbol = batch_symbols.GetString(idx);
+            std::replace(symbol.begin(), symbol.end(), '/', '_');
+            CHECK(symbol_dir == "symbol=" + symbol);
+          }
+          num_rows[symbol_dir] += batch.num_rows();
+          num_date_rows[date_dir.filename().string()] += batch.num_rows();
+        }
+      }
+      CHECK(num_rows == std::map<std::string, int64_t>{
+                            {"symbol=BTC_USD", 2 * num_batches},
+                            {"symbol=ETH_USD", num_batches},
+                            {"symbol=SOL_USD", num_batches},
+                        });
+      // By the batches' time, not when they were written.
+      CHECK(num_date_rows == std::map<std::string, int64_t>{
+                                 {"date=2024-09-10", 8},
+                                 {"date=2024-09-11", 4},
+                             });
+    }
+  }
+
+  TEST_CASE("partitioned_writer_t dates parts by their rows") {
+    const auto schema = arrow::schema(arrow::FieldVector{
+        arrow::field("symbol", arrow::utf8(), false),
+    });
+    const auto dir =
+        std::filesystem::temp_directory_path() / "kdr_partition_dates";
+    std::filesystem::remove_all(dir);
+
+    // The last microsecond of 2024-09-10: every symbol opens its part
+    // at the same time, which only has to be unique per symbol.
+    const auto micros = int64_t{1726012799999999};
+    const auto symbols = std::vector<std::string>{"BTC/USD", "ETH/USD"};
+    {
+      auto writer = kdr::pq::partitioned_writer_t{
+          dir.string(), "test", schema, {}, {}, {}};
+      for (int idx = 0; idx < 2; ++idx) {
+        auto builder = arrow::StringBuilder{};
+        PARQUET_THROW_NOT_OK(builder.AppendValues(symbols));
+        std::shared_ptr<arrow::Array> array;
+        PARQUET_THROW_NOT_OK(builder.Finish(&array));
+        writer.write(*arrow::RecordBatch::Make(
+                         schema, int64_t(symbols.size()),
+                         std::vector<std::shared_ptr<arrow::Array>>{array}),
+                     micros);
+        // Reopened within the microsecond, under a new name.
+        writer.close();
+      }
+    }
+
+    for (const auto &symbol : {"BTC_USD", "ETH_USD"}) {
+      const auto date_dir =
+          dir / "test" / (std::string{"symbol="} + symbol) / "date=2024-09-10";
+      REQUIRE(std::filesystem::exists(date_dir));
+      CHECK(sorted_files(date_dir) ==
+            std::vector<std::string>{
+                (date_dir / "part-1726012799999999.pq").string(),
+                (date_dir / "part-1726012800000000.pq").string(),
+            });
+    }
+    CHECK(sorted_files(dir / "test" / "symbol=BTC_USD").size() == 1);
+  }
+
+  TEST_CASE("partitioned_writer_t buffers rows for its partitions") {
+    const auto schema = arrow::schema(arrow::FieldVector{
+        arrow::field("symbol", arrow::utf8(), false),
+    });
+    const auto dir =
+        std::filesystem::temp_directory_path() / "kdr_partition_buffers";
+    std::filesystem::remove_all(dir);
+
+    const auto symbols =
+        std::vector<std::string>{"BTC/USD", "ETH/USD", "BTC/USD", "SOL/USD"};
+    const auto batch = [&schema, &symbols] {
+      auto builder = arrow::StringBuilder{};
+      PARQUET_THROW_NOT_OK(builder.AppendValues(symbols));
+      std::shared_ptr<arrow::Array> array;
+      PARQUET_THROW_NOT_OK(builder.Finish(&array));
+      return arrow::RecordBatch::Make(
+          schema, int64_t(symbols.size()),
+          std::vector<std::shared_ptr<arrow::Array>>{array});
+    };
+    const auto micros = int64_t{1725999834586832};
+    const auto num_batches = int64_t{8};
+
+    // Parts of 4 rows, at most 6 waiting and one file open, so every
+    // part evicts the one before; unbuffered, most would have 1 row.
+    auto properties = kdr::pq::writer_properties_t{};
+    properties.row_group_size = 4;
+    {
+      auto writer = kdr::pq::partitioned_writer_t{
+          dir.string(), "test", schema, {}, properties,
+          kdr::pq::partitioning_t{true, 1, 6}};
+      for (int64_t idx = 0; idx < num_batches; ++idx) {
+        writer.write(*batch(), micros + idx);
+        CHECK(writer.num_buffered_rows() <= 6);
+        CHECK(writer.num_open() <= 1);
+      }
+      CHECK(writer.num_evictions() > 0);
+    }
+
+    auto total_rows = int64_t{0};
+    for (const auto &symbol : {"BTC_USD", "ETH_USD", "SOL_USD"}) {
+      const auto date_dir =
+          dir / "test" / (std::string{"symbol="} + symbol) / "date=2024-09-10";
+      const auto filenames = sorted_files(date_dir);
+      REQUIRE(!filenames.empty());
+      // Only the rows left over when it closed make a smaller part.
+      for (size_t idx = 0; idx + 1 < filenames.size(); ++idx) {
+        CHECK(num_rows(filenames[idx]) >= 3);
+      }
+      for (const auto &filename : filenames) {
+        total_rows += num_rows(filename);
+      }
+    }
+    CHECK(total_rows == num_batches * int64_t(symbols.size()));
+
+    // Rows wait no longer than their interval, like an open file.
+    std::filesystem::remove_all(dir);
+    auto now = micros;
+    auto writer = kdr::pq::partitioned_writer_t{
+        dir.string(), "test", schema, {1000, 0}, {}, {}, {},
+        [&now] { return now; }};
+    writer.write(*batch(), micros);
+    CHECK(writer.num_buffered_rows() == 4);
+    writer.close_if_due();
+    CHECK(writer.num_buffered_rows() == 4);
+    CHECK(!std::filesystem::exists(dir));
+
+    now = micros - micros % 1000 + 1000;
+    writer.close_if_due();
+    CHECK(writer.num_buffered_rows() == 0);
+    CHECK(writer.num_open() == 0);
+    const auto date_dir = dir / "test" / "symbol=BTC_USD" / "date=2024-09-10";
+    CHECK(sorted_files(date_dir) ==
+          std::vector<std::string>{
+              (date_dir / ("part-" + std::to_string(micros) + ".pq")).string(),
+          });
+    CHECK(num_rows((date_dir / ("part-" + std::to_string(micros) + ".pq"))
+                       .string()) == 2);
+  }
+
+  TEST_CASE("writer_properties_t maps options to columns") {
+    const auto quote = arrow::struct_(arrow::FieldVector{
+        arrow::field("price", arrow::int64(), false),
+        arrow::field("qty", arrow::int64(), false),
+    });
+    const auto schema = arrow::schema(arrow::FieldVector{
+        arrow::field("recv_tm", arrow::int64(), false),
+        arrow::field("bids", arrow::list(quote), false),
+        arrow::field("checksum", arrow::uint64(), false),
+        arrow::field("symbol", arrow::utf8(), false),
+    });
+    const auto arrow_properties =
+        parquet::ArrowWriterProperties::Builder().store_schema()->build();
+    const auto path = [](const std::string &dot_string) {
+      return parquet::schema::ColumnPath::FromDotString(dot_string);
+    };
+
+    const auto defaults =
+        kdr::pq::writer_properties_t{}.build(*schema, *arrow_properties);
+    CHECK(defaults->compression(path("recv_tm")) ==
+          arrow::Compression::SNAPPY);
+    CHECK(defaults->dictionary_enabled(path("recv_tm")));
+    CHECK(defaults->max_row_group_length() == 64 * 1024);
+
+    auto options = kdr::pq::writer_properties_t{};
+    options.compression = "zstd:9";
+    options.column_compression = {"symbol=lz4"};
+    options.delta_encoding = true;
+    options.byte_stream_split = true;
+    options.row_group_size = 1000;
+    const auto properties = options.build(*schema, *arrow_properties);
+    CHECK(properties->max_row_group_length() == 1000);
+    CHECK(properties->compression(path("recv_tm")) ==
+          arrow::Compression::ZSTD);
+    CHECK(properties->compression_level(path("recv_tm")) == 9);
+    CHECK(properties->compression(path("symbol")) == arrow::Compression::LZ4);
+    for (const auto *column : {"recv_tm", "checksum"}) {
+      CHECK_FALSE(properties->dictionary_enabled(path(column)));
+      CHECK(properties->encoding(path(column)) ==
+            parquet::Encoding::DELTA_BINARY_PACKED);
+    }
+    for (const auto *column :
+         {"bids.list.element.price", "bids.list.element.qty"}) {
+      CHECK_FALSE(properties->dictionary_enabled(path(column)));
+      CHECK(properties->encoding(path(column)) ==
+            parquet::Encoding::BYTE_STREAM_SPLIT);
+    }
+    CHECK(properties->dictionary_enabled(path("symbol")));
+
+    options.compression = "zip";
+    CHECK_THROWS(options.build(*schema, *arrow_properties));
+    // Snappy has no levels to choose from.
+    options.compression = "snappy:3";
+    CHECK_THROWS(options.build(*schema, *arrow_properties));
+    options.compression = "none:1";
+    CHECK_THROWS(options.build(*schema, *arrow_properties));
+    options.compression = "zstd";
+    options.column_compression = {"no_such_column=zstd"};
+    CHECK_THROWS(options.build(*schema, *arrow_properties));
+  }
 }
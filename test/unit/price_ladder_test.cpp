@@ -0,0 +1,143 @@
+#include <doctest/doctest.h>
+
+#include <price_ladder.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using kdr::decimal_t;
+using kdr::model::price_ladder_t;
+
+namespace {
+
+kdr::quote_t level(const std::string &price, const std::string &qty) {
+  return {decimal_t{price}, decimal_t{qty}};
+}
+
+template <typename S> std::vector<std::string> prices(const S &side) {
+  auto result = std::vector<std::string>{};
+  for (const auto &[price, qty] : side) {
+    result.push_back(price.str());
+  }
+  return result;
+}
+
+} // namespace
+
+TEST_SUITE("price_ladder_t") {
+
+  TEST_CASE("best-first iteration, find and erase") {
+    auto bids = price_ladder_t<std::greater<kdr::price_t>>{};
+    bids.insert(level("0.014", "3"));
+    bids.insert(level("0.016", "1"));
+    bids.insert(level("0.015", "2"));
+    bids.insert(level("0.012", "4"));
+    CHECK(prices(bids) ==
+          std::vector<std::string>{"0.016", "0.015", "0.014", "0.012"});
+
+    auto it = bids.find(decimal_t{"0.015"});
+    REQUIRE(it != bids.end());
+    CHECK(it->second == decimal_t{"2"});
+    it->second = decimal_t{"5"};
+    CHECK(bids.find(decimal_t{"0.015"})->second == decimal_t{"5"});
+    CHECK(bids.find(decimal_t{"0.013"}) == bids.end());
+
+    bids.erase(bids.find(decimal_t{"0.016"}));
+    bids.erase(bids.find(decimal_t{"0.012"}));
+    CHECK(prices(bids) == std::vector<std::string>{"0.015", "0.014"});
+
+    auto asks = price_ladder_t<std::less<kdr::price_t>>{};
+    asks.insert(level("0.018", "1"));
+    asks.insert(level("0.017", "1"));
+    CHECK(prices(asks) == std::vector<std::string>{"0.017", "0.018"});
+  }
+
+  TEST_CASE("truncate") {
+    auto asks = price_ladder_t<std::less<kdr::price_t>>{};
+    // Best last, so that each level is appended and there is no dead
+    // prefix until truncate().
+    for (int px = 19; px >= 10; --px) {
+      asks.insert(level(std::to_string(px), "1"));
+    }
+    asks.truncate(6);
+    CHECK(asks.size() == 6);
+    CHECK(prices(asks) ==
+          std::vector<std::string>{"10", "11", "12", "13", "14", "15"});
+
+    // A new worst level lands in the space freed by truncation, so the
+    // live levels stay put.
+    const auto *best = &*asks.begin();
+    asks.insert(level("16", "1"));
+    CHECK(&*asks.begin() == best);
+    asks.insert(level("9", "1"));
+    CHECK(prices(asks) == std::vector<std::string>{"9", "10", "11", "12",
+                                                   "13", "14", "15", "16"});
+
+    // Truncating to less than the dead prefix reclaims it.
+    asks.truncate(2);
+    CHECK(prices(asks) == std::vector<std::string>{"9", "10"});
+    asks.insert(level("11", "1"));
+    CHECK(prices(asks) == std::vector<std::string>{"9", "10", "11"});
+
+    asks.clear();
+    CHECK(asks.empty());
+    CHECK(asks.begin() == asks.end());
+  }
+
+  TEST_CASE("best-first load") {
+    // As a snapshot arrives: each level is worse than the last.
+    auto bids = price_ladder_t<std::greater<kdr::price_t>>{};
+    auto expected = std::vector<std::string>{};
+    for (int px = 1000; px > 0; --px) {
+      bids.insert(level(std::to_string(px), "1"));
+      expected.push_back(std::to_string(px));
+    }
+    CHECK(bids.size() == 1000);
+    CHECK(prices(bids) == expected);
+
+    bids.truncate(10);
+    expected.resize(10);
+    CHECK(prices(bids) == expected);
+  }
+
+  TEST_CASE("matches std::map") {
+    auto ladder = price_ladder_t<std::greater<kdr::price_t>>{};
+    auto map =
+        std::map<kdr::price_t, kdr::qty_t, std::greater<kdr::price_t>>{};
+    auto rng = std::mt19937{42};
+    for (int step = 0; step < 10000; ++step) {
+      const auto price = decimal_t{std::to_string(rng() % 200) + ".5"};
+      const auto qty = decimal_t{std::to_string(rng() % 3)};
+      auto it = ladder.find(price);
+      if (it != ladder.end()) {
+        if (qty == decimal_t{}) {
+          ladder.erase(it);
+          map.erase(price);
+        } else {
+          it->second = qty;
+          map[price] = qty;
+        }
+      } else if (qty != decimal_t{}) {
+        ladder.insert({price, qty});
+        map.emplace(price, qty);
+      }
+      if (step % 10 == 0) {
+        ladder.truncate(25);
+        while (map.size() > 25) {
+          map.erase(std::prev(map.end()));
+        }
+      }
+      REQUIRE(ladder.size() == map.size());
+    }
+    CHECK(std::equal(ladder.begin(), ladder.end(), map.begin(), map.end(),
+                     [](const auto &lhs, const auto &rhs) {
+                       return lhs.first == rhs.first &&
+                              lhs.second == rhs.second;
+                     }));
+  }
+}
@@ -0,0 +1,82 @@
+#include <doctest/doctest.h>
+
+#include <sides.hpp>
+
+#include <string>
+
+using kdr::decimal_t;
+using kdr::model::sides_t;
+
+namespace {
+
+kdr::quote_t level(int price, const std::string &qty = "1") {
+  return {decimal_t{std::to_string(price)}, decimal_t{qty}};
+}
+
+/**
+ * A depth 25 book with bids 100, 99, ... 76 and asks 101, 102, ... 125,
+ * with its checksum bytes freshly built.
+ */
+sides_t make_sides() {
+  auto sides = sides_t{kdr::model::depth_25, 0, 0, {}, {}};
+  sides.begin(kdr::model::msg_type_gap);
+  for (int idx = 0; idx < 25; ++idx) {
+    sides.accept_bid(level(100 - idx));
+    sides.accept_ask(level(101 + idx));
+  }
+  sides.end(0);
+  static_cast<void>(sides.crc32());
+  return sides;
+}
+
+} // namespace
+
+TEST_SUITE("sides_t") {
+
+  // Only the top 10 levels of a side are checksummed, so only a change
+  // among them (or one that moves a level into them) may invalidate
+  // that side's cached bytes.
+
+  TEST_CASE("insert") {
+    auto sides = make_sides();
+    REQUIRE_FALSE(sides.bid_crc_stale());
+    REQUIRE_FALSE(sides.ask_crc_stale());
+
+    sides.accept_bid(level(50)); // below the top 10
+    CHECK_FALSE(sides.bid_crc_stale());
+    sides.accept_bid(level(101)); // new best
+    CHECK(sides.bid_crc_stale());
+    CHECK_FALSE(sides.ask_crc_stale());
+  }
+
+  TEST_CASE("replace") {
+    auto sides = make_sides();
+    sides.accept_ask(level(115, "2")); // 15th level
+    CHECK_FALSE(sides.ask_crc_stale());
+    sides.accept_ask(level(110, "2")); // 10th level
+    CHECK(sides.ask_crc_stale());
+    CHECK_FALSE(sides.bid_crc_stale());
+  }
+
+  TEST_CASE("delete") {
+    auto sides = make_sides();
+    sides.accept_bid(level(80, "0"));
+    CHECK_FALSE(sides.bid_crc_stale());
+    sides.accept_bid(level(95, "0"));
+    CHECK(sides.bid_crc_stale());
+    CHECK_FALSE(sides.ask_crc_stale());
+  }
+
+  TEST_CASE("truncate") {
+    auto sides = make_sides();
+    const auto crc32 = sides.crc32();
+    sides.begin(kdr::model::msg_type_update);
+    sides.accept_bid(level(60)); // 26th level, dropped by end()
+    sides.accept_ask(level(130));
+    sides.end(crc32);
+    CHECK(sides.bids().size() == 25);
+    CHECK(sides.asks().size() == 25);
+    CHECK_FALSE(sides.bid_crc_stale());
+    CHECK_FALSE(sides.ask_crc_stale());
+  }
+}
@@ -0,0 +1,101 @@
+#include <doctest/doctest.h>
+
+#include <msg_slot.hpp>
+#include <spsc_ring.hpp>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+
+TEST_SUITE("spsc_ring_t") {
+
+  TEST_CASE("capacity rounds up to a power of two") {
+    CHECK(kdr::spsc_ring_t<int>{1}.capacity() == 2);
+    CHECK(kdr::spsc_ring_t<int>{5}.capacity() == 8);
+    CHECK(kdr::spsc_ring_t<int>{1024}.capacity() == 1024);
+  }
+
+  TEST_CASE("fill, drain and wrap") {
+    kdr::spsc_ring_t<int> ring{4};
+    REQUIRE(ring.empty());
+    REQUIRE(ring.front() == nullptr);
+
+    for (int round = 0; round < 3; ++round) {
+      for (int i = 0; i < 4; ++i) {
+        auto *slot = ring.back();
+        REQUIRE(slot != nullptr);
+        *slot = round * 10 + i;
+        ring.push();
+      }
+      CHECK(ring.size() == 4);
+      CHECK(ring.back() == nullptr);
+
+      for (int i = 0; i < 4; ++i) {
+        const auto *slot = ring.front();
+        REQUIRE(slot != nullptr);
+        CHECK(*slot == round * 10 + i);
+        ring.pop();
+      }
+      CHECK(ring.empty());
+      CHECK(ring.front() == nullptr);
+    }
+  }
+
+  TEST_CASE("slots are reused in place") {
+    kdr::msg_ring_t ring{2};
+    const std::string big(4096, 'x');
+    const std::string small = "{}";
+
+    for (int i = 0; i < 2; ++i) {
+      ring.back()->assign(big, kdr::timestamp_t{int64_t{i}});
+      ring.push();
+      ring.pop();
+    }
+
+    auto *slot = ring.back();
+    const auto *before = slot->msg().data();
+    slot->assign(small, kdr::timestamp_t{int64_t{42}});
+    ring.push();
+
+    const auto *front = ring.front();
+    REQUIRE(front == slot);
+    CHECK(front->msg().data() == before);
+    CHECK(front->msg() == small);
+    CHECK(front->msg().capacity() >=
+          small.size() + simdjson::SIMDJSON_PADDING);
+    CHECK(front->recv_tm().micros() == 42);
+  }
+
+  TEST_CASE("preserves order across threads") {
+    constexpr uint64_t num_items = 1'000'000;
+    kdr::spsc_ring_t<uint64_t> ring{64};
+
+    std::thread producer{[&ring]() {
+      for (uint64_t i = 0; i < num_items; ++i) {
+        uint64_t *slot = nullptr;
+        while ((slot = ring.back()) == nullptr) {
+          std::this_thread::yield();
+        }
+        *slot = i;
+        ring.push();
+      }
+    }};
+
+    uint64_t expected = 0;
+    bool in_order = true;
+    while (expected < num_items) {
+      const auto *slot = ring.front();
+      if (slot == nullptr) {
+        std::this_thread::yield();
+        continue;
+      }
+      in_order = in_order && (*slot == expected);
+      ring.pop();
+      ++expected;
+    }
+    producer.join();
+
+    CHECK(in_order);
+    CHECK(ring.empty());
+  }
+}
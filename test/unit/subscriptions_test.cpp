@@ -0,0 +1,118 @@
+#include <doctest/doctest.h>
+
+#include <config.hpp>
+#include <subscriptions.hpp>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+using kdr::subscription_scheduler_t;
+using channel_t = subscription_scheduler_t::channel_t;
+
+namespace {
+
+std::vector<std::string> make_symbols(size_t num_symbols) {
+  auto result = std::vector<std::string>{};
+  for (size_t idx = 0; idx < num_symbols; ++idx) {
+    result.push_back("S" + std::to_string(idx) + "/USD");
+  }
+  return result;
+}
+
+} // namespace
+
+TEST_SUITE("subscription_scheduler_t") {
+
+  TEST_CASE("batches wait on acks") {
+    auto config = kdr::config_t{};
+    config.set_subscribe_batch_size(2);
+    config.set_subscribe_max_in_flight(1);
+    auto scheduler = subscription_scheduler_t{config};
+
+    const auto now = subscription_scheduler_t::clock_t::now();
+    scheduler.queue(channel_t::book, make_symbols(3), now);
+    CHECK(scheduler.wake_time() <= now);
+
+    const auto first = scheduler.next(now, 1);
+    REQUIRE(first);
+    CHECK(first->channel == channel_t::book);
+    CHECK(first->req_id == 1);
+    CHECK(first->symbols.size() == 2);
+    CHECK_FALSE(scheduler.next(now, 2));
+
+    scheduler.ack(1, now);
+    CHECK_FALSE(scheduler.next(now, 2));
+    scheduler.ack(42, now);
+    CHECK_FALSE(scheduler.next(now, 2));
+    scheduler.ack(1, now);
+
+    const auto second = scheduler.next(now, 2);
+    REQUIRE(second);
+    CHECK(second->symbols == std::vector<std::string>{"S2/USD"});
+    CHECK_FALSE(scheduler.idle());
+
+    scheduler.ack(2, now + std::chrono::milliseconds{5});
+    CHECK(scheduler.idle());
+    CHECK_FALSE(scheduler.wake_time());
+    CHECK(scheduler.last_cycle() == std::chrono::milliseconds{5});
+  }
+
+  TEST_CASE("priority pairs first, channels alternate") {
+    auto config = kdr::config_t{};
+    config.set_subscribe_batch_size(1);
+    config.set_priority_pairs({"S2/USD", "S1/USD"});
+    auto scheduler = subscription_scheduler_t{config};
+
+    const auto now = subscription_scheduler_t::clock_t::now();
+    scheduler.queue(channel_t::book, make_symbols(3), now);
+    scheduler.queue(channel_t::trade, make_symbols(3), now);
+
+    auto sent = std::vector<std::pair<channel_t, std::string>>{};
+    kdr::req_id_t req_id = 0;
+    while (auto batch = scheduler.next(now, ++req_id)) {
+      sent.emplace_back(batch->channel, batch->symbols.front());
+    }
+    const auto expected = std::vector<std::pair<channel_t, std::string>>{
+        {channel_t::book, "S2/USD"},  {channel_t::trade, "S2/USD"},
+        {channel_t::book, "S1/USD"},  {channel_t::trade, "S1/USD"},
+        {channel_t::book, "S0/USD"},  {channel_t::trade, "S0/USD"},
+    };
+    CHECK(sent == expected);
+  }
+
+  TEST_CASE("rate limit and timeout") {
+    auto config = kdr::config_t{};
+    config.set_subscribe_batch_size(1);
+    config.set_subscribe_rate(10);
+    config.set_subscribe_timeout_secs(1);
+    auto scheduler = subscription_scheduler_t{config};
+
+    const auto now = subscription_scheduler_t::clock_t::now();
+    scheduler.queue(channel_t::trade, make_symbols(2), now);
+    REQUIRE(scheduler.next(now, 1));
+    CHECK_FALSE(scheduler.next(now, 2));
+
+    const auto later = now + std::chrono::milliseconds{100};
+    CHECK(scheduler.wake_time() == later);
+    REQUIRE(scheduler.next(later, 2));
+
+    const auto deadline = now + std::chrono::seconds{1};
+    CHECK(scheduler.wake_time() == deadline);
+    CHECK_FALSE(scheduler.next(deadline, 3));
+    CHECK(scheduler.num_timeouts() == 1);
+
+    scheduler.ack(2, later);
+    CHECK(scheduler.idle());
+  }
+
+  TEST_CASE("clear") {
+    auto scheduler = subscription_scheduler_t{kdr::config_t{}};
+    const auto now = subscription_scheduler_t::clock_t::now();
+    scheduler.queue(channel_t::book, make_symbols(300), now);
+    REQUIRE(scheduler.next(now, 1));
+    scheduler.clear();
+    CHECK(scheduler.idle());
+    CHECK_FALSE(scheduler.next(now, 2));
+  }
+}
@@ -0,0 +1,48 @@
+#include <doctest/doctest.h>
+
+#include <symbols.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using kdr::model::symbol_table_t;
+
+TEST_SUITE("symbol_table_t") {
+
+  TEST_CASE("dense ids in order of first appearance") {
+    symbol_table_t symbols;
+    CHECK(symbols.intern("BTC/USD") == 0);
+    CHECK(symbols.intern("ETH/USD") == 1);
+    CHECK(symbols.intern("BTC/USD") == 0);
+    CHECK(symbols.size() == 2);
+
+    CHECK(symbols.find("ETH/USD") == 1);
+    CHECK_FALSE(symbols.find("SOL/USD"));
+    CHECK(symbols.id(std::string{"BTC/USD"}) == 0);
+    CHECK_THROWS_WITH(symbols.id("SOL/USD"), "unknown symbol: SOL/USD");
+
+    CHECK(symbols.symbol(1) == "ETH/USD");
+    CHECK_THROWS(symbols.symbol(2));
+  }
+
+  TEST_CASE("concurrent interning") {
+    symbol_table_t symbols;
+    const auto intern_all = [&symbols]() {
+      for (int idx = 0; idx < 1000; ++idx) {
+        symbols.intern("S" + std::to_string(idx) + "/USD");
+      }
+    };
+    auto threads = std::vector<std::thread>{};
+    for (int idx = 0; idx < 4; ++idx) {
+      threads.emplace_back(intern_all);
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    REQUIRE(symbols.size() == 1000);
+    for (kdr::symbol_id_t id = 0; id < symbols.size(); ++id) {
+      CHECK(symbols.id(symbols.symbol(id)) == id);
+    }
+  }
+}
@@ -0,0 +1,80 @@
+#include <doctest/doctest.h>
+
+#include <timestamp.hpp>
+
+#include <date/date.h>
+
+#include <random>
+#include <sstream>
+#include <string>
+
+using kdr::timestamp_t;
+
+namespace {
+
+// The iostream-based implementation timestamp_t replaced.
+
+int64_t date_parse(const std::string &str) {
+  std::istringstream ins{str};
+  date::sys_time<std::chrono::microseconds> tsp;
+  ins >> date::parse("%FT%TZ", tsp);
+  REQUIRE_FALSE(ins.fail());
+  return tsp.time_since_epoch().count();
+}
+
+std::string date_format(int64_t micros) {
+  const auto tsp = date::sys_time<std::chrono::microseconds>{
+      std::chrono::microseconds{micros}};
+  return date::format("%FT%TZ", tsp);
+}
+
+} // namespace
+
+TEST_SUITE("timestamp_t") {
+
+  TEST_CASE("from_iso_8601") {
+    CHECK(timestamp_t::from_iso_8601("2024-04-13T18:10:04.220677Z") ==
+          1713031804220677);
+    CHECK(timestamp_t::from_iso_8601("1970-01-01T00:00:00.000000Z") == 0);
+    CHECK(timestamp_t::from_iso_8601("2024-04-13T18:10:04Z") ==
+          1713031804000000);
+    CHECK(timestamp_t::from_iso_8601("2024-04-13T18:10:04.22Z") ==
+          1713031804220000);
+    CHECK(timestamp_t::from_iso_8601("2024-04-13T18:10:04.220677999Z") ==
+          1713031804220677);
+    CHECK(timestamp_t::from_iso_8601("2024-02-29T00:00:00Z") ==
+          1709164800000000);
+
+    CHECK_THROWS(timestamp_t::from_iso_8601(""));
+    CHECK_THROWS(timestamp_t::from_iso_8601("2024-04-13 18:10:04Z"));
+    CHECK_THROWS(timestamp_t::from_iso_8601("2024-04-13T18:10:04.Z"));
+    CHECK_THROWS(timestamp_t::from_iso_8601("2024-04-13T18:10:04.220677"));
+    CHECK_THROWS(timestamp_t::from_iso_8601("2023-02-29T00:00:00Z"));
+    CHECK_THROWS(timestamp_t::from_iso_8601("2024-13-01T00:00:00Z"));
+    CHECK_THROWS(timestamp_t::from_iso_8601("2024-04-13T24:00:00Z"));
+    CHECK_THROWS(timestamp_t::from_iso_8601("2024-04-1aT18:10:04Z"));
+  }
+
+  TEST_CASE("to_iso_8601") {
+    CHECK(timestamp_t::to_iso_8601(1713031804220677) ==
+          "2024-04-13T18:10:04.220677Z");
+    CHECK(timestamp_t::to_iso_8601(0) == "1970-01-01T00:00:00.000000Z");
+    CHECK(timestamp_t::to_iso_8601(-1) == "1969-12-31T23:59:59.999999Z");
+
+    timestamp_t::chars_t buffer;
+    CHECK(timestamp_t{1713031804220677}.to_chars(buffer) ==
+          "2024-04-13T18:10:04.220677Z");
+  }
+
+  TEST_CASE("agrees with date") {
+    auto rng = std::mt19937_64{42};
+    // 1970 through 2199.
+    auto dist = std::uniform_int_distribution<int64_t>{0, 7258118399999999};
+    for (int step = 0; step < 100000; ++step) {
+      const auto micros = dist(rng);
+      const auto str = date_format(micros);
+      REQUIRE(timestamp_t::to_iso_8601(micros) == str);
+      REQUIRE(timestamp_t::from_iso_8601(str) == date_parse(str));
+    }
+  }
+}
@@ -0,0 +1,48 @@
+#include <doctest/doctest.h>
+
+#include <tsc_clock.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+using kdr::tsc_clock_t;
+
+namespace {
+
+int64_t system_nanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+} // namespace
+
+TEST_SUITE("tsc_clock_t") {
+
+  TEST_CASE("tracks the system clock") {
+    auto clock = tsc_clock_t{};
+    // Generous, as a preempted test can land between the two reads.
+    constexpr int64_t tolerance = 5'000'000;
+    for (int step = 0; step < 20; ++step) {
+      const auto before = system_nanos();
+      const auto nanos = clock.now_nanos();
+      const auto after = system_nanos();
+      CHECK(nanos >= before - tolerance);
+      CHECK(nanos <= after + tolerance);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(std::abs(clock.now().micros() - system_nanos() / 1000) <
+          tolerance / 1000);
+  }
+
+  TEST_CASE("does not go backwards") {
+    auto clock = tsc_clock_t{};
+    auto last = clock.now_nanos();
+    for (int step = 0; step < 1000000; ++step) {
+      const auto nanos = clock.now_nanos();
+      REQUIRE(nanos >= last);
+      last = nanos;
+    }
+  }
+}